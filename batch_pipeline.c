@@ -0,0 +1,457 @@
+#include "batch_pipeline.h"
+#include "image_loader.h"
+#include "image_analysis.h"
+#include "file_prefetch.h"
+#include <dirent.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ---------------------------------------------------------------------------
+// File list
+// ---------------------------------------------------------------------------
+
+static bool has_image_extension(const char* name) {
+    static const char* extensions[] = { "png", "jpg", "jpeg", "bmp", "gif", "tif", "tiff" };
+
+    const char* dot = strrchr(name, '.');
+    if (!dot) {
+        return false;
+    }
+    dot++;
+
+    for (size_t i = 0; i < sizeof(extensions) / sizeof(extensions[0]); i++) {
+        const char* a = dot;
+        const char* b = extensions[i];
+        while (*a && *b && tolower((unsigned char)*a) == *b) {
+            a++;
+            b++;
+        }
+        if (*a == '\0' && *b == '\0') {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool append_path(BatchFileList* list, const char* path) {
+    if (list->count == list->capacity) {
+        int new_capacity = list->capacity ? list->capacity * 2 : 16;
+        char** paths = realloc(list->paths, (size_t)new_capacity * sizeof(char*));
+        if (!paths) {
+            return false;
+        }
+        list->paths = paths;
+        list->capacity = new_capacity;
+    }
+
+    size_t path_len = strlen(path) + 1;
+    char* copy = malloc(path_len);
+    if (!copy) {
+        return false;
+    }
+    memcpy(copy, path, path_len);
+    list->paths[list->count++] = copy;
+    return true;
+}
+
+static int compare_paths(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+bool batch_add_path(BatchFileList* list, const char* path) {
+    if (!list || !path) {
+        return false;
+    }
+
+    DIR* dir = opendir(path);
+    if (!dir) {
+        // Not a directory, take it as an image file
+        return append_path(list, path);
+    }
+
+    int first = list->count;
+    bool ok = true;
+    struct dirent* entry;
+
+    while (ok && (entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.' || !has_image_extension(entry->d_name)) {
+            continue;
+        }
+
+        size_t len = strlen(path);
+        const char* sep = (len > 0 && path[len - 1] == '/') ? "" : "/";
+        size_t full_len = len + strlen(sep) + strlen(entry->d_name) + 1;
+        char* full = malloc(full_len);
+        if (!full) {
+            ok = false;
+            break;
+        }
+        snprintf(full, full_len, "%s%s%s", path, sep, entry->d_name);
+        ok = append_path(list, full);
+        free(full);
+    }
+    closedir(dir);
+
+    // readdir order is arbitrary, keep runs reproducible
+    qsort(list->paths + first, (size_t)(list->count - first), sizeof(char*), compare_paths);
+    return ok;
+}
+
+void free_batch_file_list(BatchFileList* list) {
+    if (!list) {
+        return;
+    }
+
+    for (int i = 0; i < list->count; i++) {
+        free(list->paths[i]);
+    }
+    free(list->paths);
+
+    list->paths = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
+
+// ---------------------------------------------------------------------------
+// Bounded queue between stages
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    void** items;
+    int capacity;
+    int head;
+    int count;
+    bool closed;
+    SDL_mutex* mutex;
+    SDL_cond* not_empty;
+    SDL_cond* not_full;
+} BoundedQueue;
+
+static bool queue_init(BoundedQueue* queue, int capacity) {
+    memset(queue, 0, sizeof(BoundedQueue));
+    queue->capacity = capacity;
+    queue->items = calloc((size_t)capacity, sizeof(void*));
+    queue->mutex = SDL_CreateMutex();
+    queue->not_empty = SDL_CreateCond();
+    queue->not_full = SDL_CreateCond();
+    return queue->items && queue->mutex && queue->not_empty && queue->not_full;
+}
+
+static void queue_destroy(BoundedQueue* queue) {
+    if (queue->not_full) {
+        SDL_DestroyCond(queue->not_full);
+    }
+    if (queue->not_empty) {
+        SDL_DestroyCond(queue->not_empty);
+    }
+    if (queue->mutex) {
+        SDL_DestroyMutex(queue->mutex);
+    }
+    free(queue->items);
+    memset(queue, 0, sizeof(BoundedQueue));
+}
+
+// Blocks while the queue is full
+static void queue_push(BoundedQueue* queue, void* item) {
+    SDL_LockMutex(queue->mutex);
+    while (queue->count == queue->capacity) {
+        SDL_CondWait(queue->not_full, queue->mutex);
+    }
+    queue->items[(queue->head + queue->count) % queue->capacity] = item;
+    queue->count++;
+    SDL_CondSignal(queue->not_empty);
+    SDL_UnlockMutex(queue->mutex);
+}
+
+// Blocks while the queue is empty; returns NULL once closed and drained
+static void* queue_pop(BoundedQueue* queue) {
+    SDL_LockMutex(queue->mutex);
+    while (queue->count == 0 && !queue->closed) {
+        SDL_CondWait(queue->not_empty, queue->mutex);
+    }
+
+    void* item = NULL;
+    if (queue->count > 0) {
+        item = queue->items[queue->head];
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->count--;
+        SDL_CondSignal(queue->not_full);
+    }
+    SDL_UnlockMutex(queue->mutex);
+    return item;
+}
+
+static void queue_close(BoundedQueue* queue) {
+    SDL_LockMutex(queue->mutex);
+    queue->closed = true;
+    SDL_CondBroadcast(queue->not_empty);
+    SDL_UnlockMutex(queue->mutex);
+}
+
+// ---------------------------------------------------------------------------
+// Pipeline stages
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    const char* path;
+    ImageData image;
+    ImageAnalysis analysis;
+    GrayscaleImage grayscale;
+    ProfileReport profile;  // Follows the image across the stage threads
+} BatchItem;
+
+typedef struct {
+    const BatchFileList* list;
+    bool quiet;
+    bool profile;
+    int prefetch_depth;     // Files read ahead of decoding (0 = read while decoding)
+    BoundedQueue decoded;
+    BoundedQueue converted;
+    BatchReport* report;
+} BatchPipeline;
+
+static double seconds_since(Uint64 start) {
+    return (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+}
+
+static void decode_stage(BatchPipeline* pipeline) {
+    BatchStageStats* stats = &pipeline->report->decode;
+    ImageLoaderContext loader;
+    FilePrefetcher* prefetcher = NULL;
+
+    // The stage owns its loader context; failures are reported below
+    image_loader_context_init(&loader, false);
+
+    // Files are read on a separate thread ahead of decoding, so read latency
+    // overlaps with the decoding of the previous files
+    if (pipeline->prefetch_depth > 0) {
+        prefetcher = file_prefetcher_create((const char* const*)pipeline->list->paths,
+                                            pipeline->list->count, pipeline->prefetch_depth);
+        if (!prefetcher) {
+            fprintf(stderr, "  Leitura antecipada indisponivel, lendo na decodificacao\n");
+        }
+    }
+
+    for (int i = 0; i < pipeline->list->count; i++) {
+        PrefetchedFile file;
+        if (prefetcher && !file_prefetcher_next(prefetcher, &file)) {
+            break;
+        }
+
+        BatchItem* item = calloc(1, sizeof(BatchItem));
+        if (!item) {
+            stats->failures++;
+            if (prefetcher) {
+                file_prefetcher_release(prefetcher, &file);
+            }
+            continue;
+        }
+        item->path = pipeline->list->paths[i];
+
+        profile_begin_image(&item->profile);
+        ImageLoadError result;
+        int read_error = 0;
+        Uint64 start = SDL_GetPerformanceCounter();
+        if (prefetcher) {
+            // The read happened on the prefetch thread, charge it to this image
+            PROFILE_ADD(PROFILE_STAGE_FILE_IO, file.read_ticks, file.size);
+            pipeline->report->read_seconds += (double)file.read_ticks / (double)SDL_GetPerformanceFrequency();
+            pipeline->report->bytes_read += file.size;
+
+            if (file.error) {
+                read_error = file.error;
+                result = IMG_ERROR_FILE_NOT_FOUND;
+            } else {
+                result = load_image_from_memory(&loader, file.data, file.size, item->path, &item->image);
+            }
+            file_prefetcher_release(prefetcher, &file);
+        } else {
+            result = load_image_with_context(&loader, item->path, &item->image);
+        }
+        stats->busy_seconds += seconds_since(start);
+        profile_end_image();
+
+        if (result != IMG_SUCCESS) {
+            fprintf(stderr, "  Erro ao carregar %s: %s (%s)\n", item->path, get_image_error_string(result),
+                    read_error ? strerror(read_error) : get_loader_error_message(&loader));
+            stats->failures++;
+            free(item);
+            continue;
+        }
+
+        stats->items++;
+        stats->pixels += (Uint64)item->image.width * item->image.height;
+        queue_push(&pipeline->decoded, item);
+    }
+
+    file_prefetcher_destroy(prefetcher);
+    queue_close(&pipeline->decoded);
+}
+
+static int convert_stage(void* data) {
+    BatchPipeline* pipeline = (BatchPipeline*)data;
+    BatchStageStats* stats = &pipeline->report->convert;
+    BatchItem* item;
+
+    while ((item = queue_pop(&pipeline->decoded)) != NULL) {
+        profile_resume_image(&item->profile);
+        Uint64 start = SDL_GetPerformanceCounter();
+        bool ok = analyze_and_convert_image(&item->image, &item->analysis, &item->grayscale);
+        free_image_data(&item->image);
+        stats->busy_seconds += seconds_since(start);
+        profile_end_image();
+
+        if (!ok) {
+            fprintf(stderr, "  Erro ao converter %s\n", item->path);
+            stats->failures++;
+            free(item);
+            continue;
+        }
+
+        stats->items++;
+        stats->pixels += item->grayscale.data_size;
+        queue_push(&pipeline->converted, item);
+    }
+
+    queue_close(&pipeline->converted);
+    return 0;
+}
+
+static int encode_stage(void* data) {
+    BatchPipeline* pipeline = (BatchPipeline*)data;
+    BatchStageStats* stats = &pipeline->report->encode;
+    BatchItem* item;
+
+    while ((item = queue_pop(&pipeline->converted)) != NULL) {
+        char output_filename[256];
+        bool ok = false;
+
+        profile_resume_image(&item->profile);
+        Uint64 start = SDL_GetPerformanceCounter();
+        if (generate_grayscale_filename(item->path, output_filename, sizeof(output_filename))) {
+            ok = save_grayscale_image(&item->grayscale, output_filename);
+        }
+        stats->busy_seconds += seconds_since(start);
+        profile_end_image();
+
+        if (ok) {
+            stats->items++;
+            stats->pixels += item->grayscale.data_size;
+            if (!pipeline->quiet) {
+                printf("  %s -> %s (media %.1f, contraste %d)\n", item->path, output_filename,
+                       item->analysis.avg_intensity,
+                       item->analysis.max_intensity - item->analysis.min_intensity);
+                if (pipeline->profile) {
+                    print_profile_report(item->path, &item->profile);
+                }
+            }
+        } else {
+            fprintf(stderr, "  Erro ao salvar %s\n", item->path);
+            stats->failures++;
+        }
+
+        free_grayscale_image(&item->grayscale);
+        free(item);
+    }
+    return 0;
+}
+
+bool run_batch(const BatchFileList* list, const BatchOptions* options, BatchReport* report) {
+    if (!list || !report) {
+        return false;
+    }
+
+    memset(report, 0, sizeof(BatchReport));
+    report->decode.name = "Decodificacao";
+    report->convert.name = "Conversao";
+    report->encode.name = "Codificacao";
+    report->files_total = list->count;
+
+    int queue_depth = (options && options->queue_depth > 0) ? options->queue_depth : BATCH_DEFAULT_QUEUE_DEPTH;
+
+    BatchPipeline pipeline;
+    memset(&pipeline, 0, sizeof(BatchPipeline));
+    pipeline.list = list;
+    pipeline.quiet = options ? options->quiet : false;
+    pipeline.profile = options ? options->profile : false;
+    if (!options || !options->no_prefetch) {
+        pipeline.prefetch_depth = (options && options->prefetch_depth > 0) ? options->prefetch_depth
+                                                                          : FILE_PREFETCH_DEFAULT_DEPTH;
+    }
+    pipeline.report = report;
+
+    if (!queue_init(&pipeline.decoded, queue_depth) || !queue_init(&pipeline.converted, queue_depth)) {
+        queue_destroy(&pipeline.decoded);
+        queue_destroy(&pipeline.converted);
+        return false;
+    }
+
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    SDL_Thread* convert_thread = SDL_CreateThread(convert_stage, "batch_convert", &pipeline);
+    SDL_Thread* encode_thread = convert_thread ? SDL_CreateThread(encode_stage, "batch_encode", &pipeline) : NULL;
+
+    if (!convert_thread || !encode_thread) {
+        fprintf(stderr, "Could not create pipeline threads: %s\n", SDL_GetError());
+
+        // Unblock and drain whatever started, then give up
+        queue_close(&pipeline.decoded);
+        if (convert_thread) {
+            SDL_WaitThread(convert_thread, NULL);
+        }
+        queue_destroy(&pipeline.decoded);
+        queue_destroy(&pipeline.converted);
+        return false;
+    }
+
+    // Decoding runs on the calling thread
+    decode_stage(&pipeline);
+
+    SDL_WaitThread(convert_thread, NULL);
+    SDL_WaitThread(encode_thread, NULL);
+
+    report->wall_seconds = seconds_since(start);
+    report->files_succeeded = report->encode.items;
+    report->files_failed = report->files_total - report->files_succeeded;
+
+    queue_destroy(&pipeline.decoded);
+    queue_destroy(&pipeline.converted);
+
+    return report->files_failed == 0;
+}
+
+static void print_stage(const BatchStageStats* stats) {
+    double images_per_second = stats->busy_seconds > 0 ? stats->items / stats->busy_seconds : 0.0;
+    double mpixels_per_second = stats->busy_seconds > 0 ? stats->pixels / stats->busy_seconds / 1e6 : 0.0;
+
+    printf("%-14s %5d ok %5d falhas %9.3f s %9.2f img/s %9.2f Mpix/s\n",
+           stats->name, stats->items, stats->failures, stats->busy_seconds,
+           images_per_second, mpixels_per_second);
+}
+
+void print_batch_report(const BatchReport* report) {
+    if (!report) {
+        return;
+    }
+
+    printf("\n=== Relatorio do Processamento em Lote ===\n");
+    printf("Arquivos: %d (%d ok, %d falhas)\n", report->files_total, report->files_succeeded, report->files_failed);
+    printf("Tempo total: %.3f s", report->wall_seconds);
+    if (report->wall_seconds > 0) {
+        printf(" (%.2f img/s)", report->files_succeeded / report->wall_seconds);
+    }
+    printf("\n");
+    if (report->bytes_read > 0) {
+        printf("Leitura antecipada: %.1f MB em %.3f s", report->bytes_read / 1e6, report->read_seconds);
+        if (report->read_seconds > 0) {
+            printf(" (%.1f MB/s)", report->bytes_read / 1e6 / report->read_seconds);
+        }
+        printf("\n");
+    }
+    print_stage(&report->decode);
+    print_stage(&report->convert);
+    print_stage(&report->encode);
+    printf("==========================================\n");
+}
@@ -0,0 +1,85 @@
+#ifndef BATCH_PIPELINE_H
+#define BATCH_PIPELINE_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include "profiler.h"
+
+// Default number of images each queue between stages can hold
+#define BATCH_DEFAULT_QUEUE_DEPTH 2
+
+// List of image files to process
+typedef struct {
+    char** paths;
+    int count;
+    int capacity;
+} BatchFileList;
+
+// Options for a batch run
+typedef struct {
+    int queue_depth;        // Images buffered between stages (0 = default)
+    bool quiet;             // Suppress per-image output
+    bool profile;           // Print a per-stage profile for each image
+    int prefetch_depth;     // Files read ahead of decoding (0 = default)
+    bool no_prefetch;       // Read each file inside the decode stage instead
+} BatchOptions;
+
+// Counters for one pipeline stage
+typedef struct {
+    const char* name;
+    int items;              // Images that went through the stage
+    int failures;           // Images dropped by the stage
+    Uint64 pixels;          // Pixels processed by the stage
+    double busy_seconds;    // Time spent working (excludes waiting on queues)
+} BatchStageStats;
+
+// Results of a batch run
+typedef struct {
+    int files_total;
+    int files_succeeded;
+    int files_failed;
+    double wall_seconds;
+    Uint64 bytes_read;      // Bytes read ahead of decoding (0 without prefetching)
+    double read_seconds;    // Time the prefetch thread spent reading
+    BatchStageStats decode;
+    BatchStageStats convert;
+    BatchStageStats encode;
+} BatchReport;
+
+/**
+ * Add an input path to a batch file list
+ * Directories are expanded (non-recursively) to the supported image files they
+ * contain, in name order; other paths are added as they are
+ * @param list File list (zero-initialized before first use)
+ * @param path File or directory path
+ * @return true on success, false if the path cannot be read or memory runs out
+ */
+bool batch_add_path(BatchFileList* list, const char* path);
+
+/**
+ * Free memory allocated for a batch file list
+ * @param list File list to free
+ */
+void free_batch_file_list(BatchFileList* list);
+
+/**
+ * Process every file of the list through a decode -> convert -> encode pipeline
+ * Each stage runs on its own thread; stages are connected by bounded queues so
+ * at most queue_depth images wait between two stages, whatever the list size.
+ * Unless disabled, files are read by a file prefetcher prefetch_depth files
+ * ahead of the decode stage, which decodes them from memory.
+ * Outputs go to grayscale_images/ as named by generate_grayscale_filename
+ * @param list Files to process
+ * @param options Batch options (NULL for defaults)
+ * @param report Pointer to store per-stage counters and timings
+ * @return true if every file was processed, false if any failed
+ */
+bool run_batch(const BatchFileList* list, const BatchOptions* options, BatchReport* report);
+
+/**
+ * Print per-stage throughput of a batch run
+ * @param report Batch results to print
+ */
+void print_batch_report(const BatchReport* report);
+
+#endif // BATCH_PIPELINE_H
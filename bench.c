@@ -0,0 +1,921 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "image_loader.h"
+#include "image_analysis.h"
+#include "grayscale_simd.h"
+#include "batch_pipeline.h"
+#include "gray_tiles.h"
+#include "convolution.h"
+#include "integral_image.h"
+#include "point_ops.h"
+#include "gray_loader.h"
+#include "gray_pyramid.h"
+#include "file_prefetch.h"
+#include "image_probe.h"
+#include "gray_png.h"
+#include "gray_view.h"
+
+// Benchmark harness for the image_analysis.h passes (built by `make bench`)
+// Timings go to stderr as a table and to a JSON file; the library's own
+// progress messages still go to stdout
+
+#define BENCH_DEFAULT_WARMUP 2
+#define BENCH_DEFAULT_REPS 10
+#define BENCH_MAX_REPS 1000
+#define BENCH_DEFAULT_JSON "bench_results.json"
+#define BENCH_DEFAULT_CORPUS "images"
+#define BENCH_TMP_OUTPUT "bench_output.png"
+
+// Extra bytes at the end of each row for the padded-pitch variants
+#define BENCH_PITCH_PADDING 3
+
+// Filter sizes for the convolution benchmarks
+#define BENCH_BLUR_SIGMA 2.0
+#define BENCH_BOX_RADIUS 6
+
+// Region queries per integral image benchmark call (each a 1/4 x 1/4 rectangle)
+#define BENCH_REGION_QUERIES 1000
+
+typedef struct {
+    const char* name;
+    Uint32 format;
+    int channels;
+} BenchFormat;
+
+typedef struct {
+    int width;
+    int height;
+} BenchSize;
+
+static const BenchFormat g_formats[] = {
+    { "gray8", SDL_PIXELFORMAT_INDEX8, 1 },
+    { "rgb24", SDL_PIXELFORMAT_RGB24, 3 },
+    { "rgba32", SDL_PIXELFORMAT_RGBA32, 4 },
+};
+
+// The odd width gives odd pitches for 1 and 3 channels even without padding
+static const BenchSize g_sizes[] = {
+    { 640, 480 },
+    { 1921, 1081 },
+    { 4096, 3072 },
+};
+
+typedef struct {
+    int warmup;
+    int reps;
+    const char* json_path;
+    const char* corpus;
+} BenchOptions;
+
+typedef struct {
+    char function[48];
+    char variant[96];
+    int width;
+    int height;
+    int pitch;
+    Uint64 pixels;
+    int reps;
+    double median_ms;
+    double p99_ms;
+    double median_mpix_s;
+    double p99_mpix_s;
+} BenchResult;
+
+typedef struct {
+    BenchResult* items;
+    int count;
+    int capacity;
+} BenchResultList;
+
+// State shared by the benchmarked calls
+typedef struct {
+    ImageData* image;
+    GrayscaleImage* gray;
+    TiledGrayscaleImage* tiled;
+    IntegralImage* integral;
+    GrayPyramid* pyramid;
+    const char* path;
+    BufferPool* read_pool;
+    const PrefetchedFile* file;     // Contents of path, for decoding from memory
+    Uint64 checksum;        // Keeps pixel reads from being optimized away
+} BenchContext;
+
+typedef void (*BenchFunc)(BenchContext* context);
+
+// ---------------------------------------------------------------------------
+// Timing
+// ---------------------------------------------------------------------------
+
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static bool add_result(BenchResultList* list, const BenchResult* result) {
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 64;
+        BenchResult* items = realloc(list->items, (size_t)capacity * sizeof(BenchResult));
+        if (!items) {
+            return false;
+        }
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = *result;
+    return true;
+}
+
+// Run func warmup + reps times and record the median and p99 of the timed reps
+static void run_bench(BenchResultList* list, const BenchOptions* options, const char* function,
+                      const char* variant, int width, int height, int pitch,
+                      BenchFunc func, BenchContext* context) {
+    double samples[BENCH_MAX_REPS];
+    double frequency = (double)SDL_GetPerformanceFrequency();
+
+    for (int i = 0; i < options->warmup; i++) {
+        func(context);
+    }
+
+    for (int i = 0; i < options->reps; i++) {
+        Uint64 start = SDL_GetPerformanceCounter();
+        func(context);
+        samples[i] = (double)(SDL_GetPerformanceCounter() - start) / frequency;
+    }
+
+    qsort(samples, (size_t)options->reps, sizeof(double), compare_double);
+
+    // Nearest-rank percentiles
+    double median = samples[(options->reps - 1) / 2];
+    int p99_index = (int)ceil(0.99 * options->reps) - 1;
+    double p99 = samples[p99_index < 0 ? 0 : p99_index];
+
+    BenchResult result;
+    memset(&result, 0, sizeof(result));
+    snprintf(result.function, sizeof(result.function), "%s", function);
+    snprintf(result.variant, sizeof(result.variant), "%s", variant);
+    result.width = width;
+    result.height = height;
+    result.pitch = pitch;
+    result.pixels = (Uint64)width * height;
+    result.reps = options->reps;
+    result.median_ms = median * 1000.0;
+    result.p99_ms = p99 * 1000.0;
+    result.median_mpix_s = median > 0.0 ? result.pixels / median / 1e6 : 0.0;
+    result.p99_mpix_s = p99 > 0.0 ? result.pixels / p99 / 1e6 : 0.0;
+
+    fprintf(stderr, "  %-30s %-28s %9.3f ms  %9.3f ms  %9.1f Mpix/s  %9.1f Mpix/s\n",
+            result.function, result.variant, result.median_ms, result.p99_ms,
+            result.median_mpix_s, result.p99_mpix_s);
+
+    add_result(list, &result);
+}
+
+// ---------------------------------------------------------------------------
+// Benchmarked calls
+// ---------------------------------------------------------------------------
+
+static void bench_analyze_image(BenchContext* context) {
+    ImageAnalysis analysis;
+    analyze_image(context->image, &analysis);
+}
+
+static void bench_is_image_grayscale(BenchContext* context) {
+    context->checksum += is_image_grayscale(context->image, GRAYSCALE_DEFAULT_TOLERANCE, true);
+}
+
+static void bench_convert_to_grayscale(BenchContext* context) {
+    GrayscaleImage gray;
+    if (convert_to_grayscale(context->image, &gray)) {
+        free_grayscale_image(&gray);
+    }
+}
+
+static void bench_extract_grayscale(BenchContext* context) {
+    GrayscaleImage gray;
+    if (extract_grayscale(context->image, &gray)) {
+        free_grayscale_image(&gray);
+    }
+}
+
+static void bench_get_grayscale_image(BenchContext* context) {
+    GrayscaleImage gray;
+    if (get_grayscale_image(context->image, &gray)) {
+        free_grayscale_image(&gray);
+    }
+}
+
+static void bench_analyze_and_convert(BenchContext* context) {
+    ImageAnalysis analysis;
+    GrayscaleImage gray;
+    if (analyze_and_convert_image(context->image, &analysis, &gray)) {
+        free_grayscale_image(&gray);
+    }
+}
+
+static void bench_calculate_stats(BenchContext* context) {
+    ImageAnalysis analysis;
+    memset(&analysis, 0, sizeof(analysis));
+    calculate_grayscale_stats(context->gray, &analysis);
+}
+
+static void bench_calculate_histogram(BenchContext* context) {
+    GrayscaleHistogram histogram;
+    calculate_grayscale_histogram(context->gray, &histogram);
+    context->checksum += histogram.total;
+}
+
+static void bench_convert_to_grayscale_tiled(BenchContext* context) {
+    TiledGrayscaleImage tiled;
+    if (convert_to_grayscale_tiled(context->image, &tiled, GRAY_TILE_SIZE, 0)) {
+        free_tiled_image(&tiled);
+    }
+}
+
+static void bench_tile_grayscale(BenchContext* context) {
+    TiledGrayscaleImage tiled;
+    if (tile_grayscale_image(context->gray, &tiled, GRAY_TILE_SIZE, 0)) {
+        free_tiled_image(&tiled);
+    }
+}
+
+static void bench_untile_grayscale(BenchContext* context) {
+    GrayscaleImage gray;
+    if (untile_grayscale_image(context->tiled, &gray)) {
+        free_grayscale_image(&gray);
+    }
+}
+
+static void bench_calculate_tiled_histogram(BenchContext* context) {
+    GrayscaleHistogram histogram;
+    calculate_tiled_histogram(context->tiled, &histogram);
+    context->checksum += histogram.total;
+}
+
+static void bench_gaussian_blur(BenchContext* context) {
+    GrayscaleImage blurred;
+    if (gaussian_blur(context->gray, &blurred, BENCH_BLUR_SIGMA, CONVOLUTION_BORDER_CLAMP, 0)) {
+        context->checksum += blurred.pixels[0];
+        free_grayscale_image(&blurred);
+    }
+}
+
+// Reference for bench_gaussian_blur: the same kernel applied as a full 2D
+// (2r+1)^2 convolution, one pixel at a time
+static void bench_naive_convolution_2d(BenchContext* context) {
+    const GrayscaleImage* gray = context->gray;
+    ConvolutionKernel kernel;
+    if (!make_gaussian_kernel(&kernel, BENCH_BLUR_SIGMA)) {
+        return;
+    }
+
+    Uint8* out = malloc(gray->data_size);
+    if (!out) {
+        return;
+    }
+
+    int radius = kernel.radius;
+    int shift = 2 * CONVOLUTION_WEIGHT_BITS;
+    for (int y = 0; y < gray->height; y++) {
+        for (int x = 0; x < gray->width; x++) {
+            Sint64 sum = (Sint64)1 << (shift - 1);
+            for (int j = -radius; j <= radius; j++) {
+                int sy = y + j < 0 ? 0 : (y + j >= gray->height ? gray->height - 1 : y + j);
+                const Uint8* row = gray->pixels + (size_t)sy * gray->width;
+                for (int i = -radius; i <= radius; i++) {
+                    int sx = x + i < 0 ? 0 : (x + i >= gray->width ? gray->width - 1 : x + i);
+                    sum += (Sint64)kernel.weights[j + radius] * kernel.weights[i + radius] * row[sx];
+                }
+            }
+            sum >>= shift;
+            out[(size_t)y * gray->width + x] = (Uint8)(sum < 0 ? 0 : (sum > 255 ? 255 : sum));
+        }
+    }
+
+    context->checksum += out[0];
+    free(out);
+}
+
+static void bench_box_blur(BenchContext* context) {
+    GrayscaleImage blurred;
+    if (box_blur(context->gray, &blurred, BENCH_BOX_RADIUS, CONVOLUTION_BORDER_CLAMP, 0)) {
+        context->checksum += blurred.pixels[0];
+        free_grayscale_image(&blurred);
+    }
+}
+
+static void bench_build_integral_image(BenchContext* context) {
+    IntegralImage integral;
+    if (build_integral_image(context->gray, &integral, true)) {
+        free_integral_image(&integral);
+    }
+}
+
+// Rectangles sweep the image diagonally, so the scan and the lookup versions
+// cover the same pixels
+static void bench_region_rect(const GrayscaleImage* gray, int query, int* x, int* y, int* width, int* height) {
+    *width = gray->width / 4 > 0 ? gray->width / 4 : 1;
+    *height = gray->height / 4 > 0 ? gray->height / 4 : 1;
+    *x = (int)((Sint64)query * (gray->width - *width) / BENCH_REGION_QUERIES);
+    *y = (int)((Sint64)query * (gray->height - *height) / BENCH_REGION_QUERIES);
+}
+
+static void bench_region_stats(BenchContext* context) {
+    for (int q = 0; q < BENCH_REGION_QUERIES; q++) {
+        int x, y, width, height;
+        RegionStats stats;
+        bench_region_rect(context->gray, q, &x, &y, &width, &height);
+        if (get_region_stats(context->integral, x, y, width, height, &stats)) {
+            context->checksum += stats.sum + stats.sum_squares;
+        }
+    }
+}
+
+// Reference for bench_region_stats: rescan the pixels of every rectangle
+static void bench_region_stats_scan(BenchContext* context) {
+    const GrayscaleImage* gray = context->gray;
+    for (int q = 0; q < BENCH_REGION_QUERIES; q++) {
+        int x, y, width, height;
+        Uint64 sum = 0;
+        Uint64 sum_squares = 0;
+        bench_region_rect(gray, q, &x, &y, &width, &height);
+        for (int row = y; row < y + height; row++) {
+            const Uint8* pixels = gray->pixels + (size_t)row * gray->width + x;
+            for (int col = 0; col < width; col++) {
+                sum += pixels[col];
+                sum_squares += (Uint32)pixels[col] * pixels[col];
+            }
+        }
+        context->checksum += sum + sum_squares;
+    }
+}
+
+static void bench_build_gray_pyramid(BenchContext* context) {
+    GrayPyramid pyramid;
+    if (build_gray_pyramid(context->gray, &pyramid, 0)) {
+        free_gray_pyramid(&pyramid);
+    }
+}
+
+// Statistics from the level closest to 64K pixels of a prebuilt pyramid
+static void bench_estimate_pyramid_stats(BenchContext* context) {
+    ImageAnalysis analysis;
+    estimate_pyramid_stats(context->pyramid, select_pyramid_level(context->pyramid, 65536), &analysis);
+    context->checksum += (Uint64)analysis.avg_intensity;
+}
+
+// Point operation benchmarks modify context->gray in place (on a copy)
+static void bench_apply_point_lut(BenchContext* context) {
+    PointLut lut;
+    lut_gamma(&lut, 0.8);
+    apply_point_lut(context->gray, &lut);
+}
+
+static void bench_point_op_chain(BenchContext* context) {
+    PointOpChain chain = {0};
+    point_op_chain_add(&chain, POINT_OP_STRETCH, 0.0);
+    point_op_chain_add(&chain, POINT_OP_GAMMA, 0.8);
+    point_op_chain_add(&chain, POINT_OP_EQUALIZE, 0.0);
+    apply_point_op_chain(context->gray, &chain);
+}
+
+// Reference for bench_point_op_chain: one pixel pass per operation
+static void bench_point_ops_separate(BenchContext* context) {
+    GrayscaleHistogram histogram;
+    HistogramStats stats;
+    PointLut lut;
+
+    calculate_grayscale_histogram(context->gray, &histogram);
+    histogram_get_stats(&histogram, &stats);
+    lut_contrast_stretch(&lut, stats.min, stats.max);
+    apply_point_lut(context->gray, &lut);
+    lut_gamma(&lut, 0.8);
+    apply_point_lut(context->gray, &lut);
+    calculate_grayscale_histogram(context->gray, &histogram);
+    lut_equalize(&lut, &histogram);
+    apply_point_lut(context->gray, &lut);
+}
+
+static void bench_get_pixel(BenchContext* context) {
+    const GrayscaleImage* gray = context->gray;
+    Uint64 sum = 0;
+    for (int y = 0; y < gray->height; y++) {
+        for (int x = 0; x < gray->width; x++) {
+            sum += get_grayscale_pixel(gray, x, y);
+        }
+    }
+    context->checksum += sum;
+}
+
+static void bench_set_pixel(BenchContext* context) {
+    GrayscaleImage* gray = context->gray;
+    for (int y = 0; y < gray->height; y++) {
+        for (int x = 0; x < gray->width; x++) {
+            set_grayscale_pixel(gray, x, y, (Uint8)(x ^ y));
+        }
+    }
+}
+
+static void bench_gray_image_at(BenchContext* context) {
+    const GrayscaleImage* gray = context->gray;
+    Uint64 sum = 0;
+    for (int y = 0; y < gray->height; y++) {
+        for (int x = 0; x < gray->width; x++) {
+            sum += gray_image_at(gray, x, y);
+        }
+    }
+    context->checksum += sum;
+}
+
+static void bench_gray_image_put(BenchContext* context) {
+    GrayscaleImage* gray = context->gray;
+    for (int y = 0; y < gray->height; y++) {
+        for (int x = 0; x < gray->width; x++) {
+            gray_image_put(gray, x, y, (Uint8)(x ^ y));
+        }
+    }
+}
+
+static void bench_gray_image_row(BenchContext* context) {
+    const GrayscaleImage* gray = context->gray;
+    Uint64 sum = 0;
+    for (int y = 0; y < gray->height; y++) {
+        const Uint8* row = gray_image_row(gray, y);
+        for (int x = 0; x < gray->width; x++) {
+            sum += row[x];
+        }
+    }
+    context->checksum += sum;
+}
+
+// Statistics of the central quarter through a view, with no crop copy
+static void bench_crop_view_stats(BenchContext* context) {
+    const GrayscaleImage* gray = context->gray;
+    GrayView view;
+    ImageAnalysis analysis;
+    if (gray_image_subview(gray, gray->width / 4, gray->height / 4, gray->width / 2, gray->height / 2, &view) &&
+        calculate_gray_view_stats(&view, &analysis)) {
+        context->checksum += (Uint64)analysis.median_intensity;
+    }
+}
+
+// Same statistics copying the crop into a new image first
+static void bench_crop_copy_stats(BenchContext* context) {
+    const GrayscaleImage* gray = context->gray;
+    GrayView view;
+    GrayscaleImage crop;
+    ImageAnalysis analysis;
+    if (gray_image_subview(gray, gray->width / 4, gray->height / 4, gray->width / 2, gray->height / 2, &view) &&
+        gray_view_to_image(&view, &crop)) {
+        if (calculate_grayscale_stats(&crop, &analysis)) {
+            context->checksum += (Uint64)analysis.median_intensity;
+        }
+        free_grayscale_image(&crop);
+    }
+}
+
+static void bench_save_grayscale(BenchContext* context) {
+    save_grayscale_image(context->gray, BENCH_TMP_OUTPUT);
+}
+
+static void bench_write_gray_png_fast(BenchContext* context) {
+    GrayPngOptions png_options;
+    gray_png_fast_options(&png_options);
+    write_gray_png_with_options(BENCH_TMP_OUTPUT, context->gray->pixels, context->gray->width,
+                                context->gray->height, (size_t)context->gray->width, &png_options);
+}
+
+static void bench_img_load(BenchContext* context) {
+    SDL_Surface* surface = IMG_Load(context->path);
+    if (surface) {
+        SDL_FreeSurface(surface);
+    }
+}
+
+static void bench_img_save_png(BenchContext* context) {
+    IMG_SavePNG(context->image->surface, BENCH_TMP_OUTPUT);
+}
+
+static void bench_load_image(BenchContext* context) {
+    ImageData image;
+    if (load_image(context->path, &image) == IMG_SUCCESS) {
+        free_image_data(&image);
+    }
+}
+
+static void bench_read_file(BenchContext* context) {
+    PrefetchedFile file;
+    if (read_file_to_buffer(context->read_pool, context->path, &file)) {
+        context->checksum += file.data[file.size / 2];
+        buffer_pool_release(context->read_pool, file.data);
+    }
+}
+
+static void bench_load_from_memory(BenchContext* context) {
+    ImageLoaderContext loader;
+    ImageData image;
+    image_loader_context_init(&loader, false);
+    if (load_image_from_memory(&loader, context->file->data, context->file->size, context->path, &image) == IMG_SUCCESS) {
+        free_image_data(&image);
+    }
+}
+
+static void bench_probe_image(BenchContext* context) {
+    ImageProbe probe;
+    if (probe_image(context->path, &probe) == IMG_SUCCESS) {
+        context->checksum += (Uint64)probe.width * probe.height;
+    }
+}
+
+// load_image + convert_to_grayscale, the path load_grayscale_image replaces for JPEGs
+static void bench_load_and_convert(BenchContext* context) {
+    ImageData image;
+    if (load_image(context->path, &image) == IMG_SUCCESS) {
+        GrayscaleImage gray;
+        if (convert_to_grayscale(&image, &gray)) {
+            free_grayscale_image(&gray);
+        }
+        free_image_data(&image);
+    }
+}
+
+static void bench_load_grayscale(BenchContext* context) {
+    GrayscaleImage gray;
+    if (load_grayscale_image(context->path, 1, &gray, NULL) == IMG_SUCCESS) {
+        free_grayscale_image(&gray);
+    }
+}
+
+static void bench_load_grayscale_thumbnail(BenchContext* context) {
+    GrayscaleImage gray;
+    if (load_grayscale_image(context->path, GRAY_LOAD_MAX_SCALE, &gray, NULL) == IMG_SUCCESS) {
+        free_grayscale_image(&gray);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Synthetic surfaces
+// ---------------------------------------------------------------------------
+
+// Deterministic noise over a gradient; pixels are neutral (R = G = B) so the
+// grayscale check scans the whole image instead of stopping at the first row
+static void fill_surface(SDL_Surface* surface, int channels) {
+    Uint32 state = 0x9E3779B9u;
+    Uint8* pixels = (Uint8*)surface->pixels;
+
+    for (int y = 0; y < surface->h; y++) {
+        Uint8* row = pixels + (size_t)y * surface->pitch;
+        for (int x = 0; x < surface->w; x++) {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            Uint8 value = (Uint8)(((x + y) & 0xFF) ^ (state & 0x0F));
+
+            if (channels == 1) {
+                row[x] = value;
+            } else {
+                Uint8* p = row + x * channels;
+                p[0] = value;
+                p[1] = value;
+                p[2] = value;
+                if (channels == 4) {
+                    p[3] = 255;
+                }
+            }
+        }
+    }
+}
+
+// Create a surface over a caller-owned buffer with the given row padding
+static SDL_Surface* create_surface(const BenchFormat* format, int width, int height, int padding, Uint8** buffer) {
+    int pitch = width * format->channels + padding;
+    *buffer = malloc((size_t)pitch * height);
+    if (!*buffer) {
+        return NULL;
+    }
+
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormatFrom(*buffer, width, height, format->channels * 8,
+                                                              pitch, format->format);
+    if (!surface) {
+        free(*buffer);
+        *buffer = NULL;
+        return NULL;
+    }
+
+    // Indexed surfaces get a gray ramp palette
+    if (surface->format->palette) {
+        SDL_Color colors[256];
+        for (int i = 0; i < 256; i++) {
+            colors[i].r = colors[i].g = colors[i].b = (Uint8)i;
+            colors[i].a = 255;
+        }
+        SDL_SetPaletteColors(surface->format->palette, colors, 0, 256);
+    }
+
+    fill_surface(surface, format->channels);
+    return surface;
+}
+
+static void bench_synthetic(BenchResultList* list, const BenchOptions* options) {
+    int num_sizes = sizeof(g_sizes) / sizeof(g_sizes[0]);
+    int num_formats = sizeof(g_formats) / sizeof(g_formats[0]);
+
+    for (int s = 0; s < num_sizes; s++) {
+        int width = g_sizes[s].width;
+        int height = g_sizes[s].height;
+        GrayscaleImage gray;
+        memset(&gray, 0, sizeof(gray));
+
+        for (int f = 0; f < num_formats; f++) {
+            for (int padded = 0; padded <= 1; padded++) {
+                const BenchFormat* format = &g_formats[f];
+                Uint8* buffer = NULL;
+                SDL_Surface* surface = create_surface(format, width, height, padded ? BENCH_PITCH_PADDING : 0, &buffer);
+                if (!surface) {
+                    fprintf(stderr, "Could not create %s surface %dx%d\n", format->name, width, height);
+                    continue;
+                }
+
+                ImageData image;
+                image.surface = surface;
+                image.width = width;
+                image.height = height;
+                image.channels = format->channels;
+                image.filename = NULL;
+
+                BenchContext context;
+                memset(&context, 0, sizeof(context));
+                context.image = &image;
+
+                char variant[96];
+                snprintf(variant, sizeof(variant), "%s %dx%d pitch %d", format->name, width, height, surface->pitch);
+                fprintf(stderr, "\n%s\n", variant);
+
+                run_bench(list, options, "analyze_image", variant, width, height, surface->pitch, bench_analyze_image, &context);
+                run_bench(list, options, "is_image_grayscale", variant, width, height, surface->pitch, bench_is_image_grayscale, &context);
+                run_bench(list, options, "convert_to_grayscale", variant, width, height, surface->pitch, bench_convert_to_grayscale, &context);
+                if (format->channels == 1) {
+                    run_bench(list, options, "extract_grayscale", variant, width, height, surface->pitch, bench_extract_grayscale, &context);
+                }
+                run_bench(list, options, "get_grayscale_image", variant, width, height, surface->pitch, bench_get_grayscale_image, &context);
+                run_bench(list, options, "analyze_and_convert_image", variant, width, height, surface->pitch, bench_analyze_and_convert, &context);
+                run_bench(list, options, "convert_to_grayscale_tiled", variant, width, height, surface->pitch, bench_convert_to_grayscale_tiled, &context);
+
+                // Keep one converted image per size for the grayscale passes
+                if (!gray.pixels) {
+                    convert_to_grayscale(&image, &gray);
+                }
+
+                SDL_FreeSurface(surface);
+                free(buffer);
+            }
+        }
+
+        if (!gray.pixels) {
+            continue;
+        }
+
+        // Passes over GrayscaleImage do not depend on the source format
+        BenchContext context;
+        memset(&context, 0, sizeof(context));
+        context.gray = &gray;
+
+        char variant[96];
+        snprintf(variant, sizeof(variant), "gray %dx%d", width, height);
+        fprintf(stderr, "\n%s\n", variant);
+
+        run_bench(list, options, "calculate_grayscale_stats", variant, width, height, width, bench_calculate_stats, &context);
+        run_bench(list, options, "calculate_grayscale_histogram", variant, width, height, width, bench_calculate_histogram, &context);
+        
+        TiledGrayscaleImage tiled;
+        if (tile_grayscale_image(&gray, &tiled, GRAY_TILE_SIZE, 0)) {
+            context.tiled = &tiled;
+            run_bench(list, options, "tile_grayscale_image", variant, width, height, width, bench_tile_grayscale, &context);
+            run_bench(list, options, "untile_grayscale_image", variant, width, height, width, bench_untile_grayscale, &context);
+            run_bench(list, options, "calculate_tiled_histogram", variant, width, height, width, bench_calculate_tiled_histogram, &context);
+            free_tiled_image(&tiled);
+        }
+        run_bench(list, options, "gaussian_blur", variant, width, height, width, bench_gaussian_blur, &context);
+        run_bench(list, options, "naive_convolution_2d", variant, width, height, width, bench_naive_convolution_2d, &context);
+        run_bench(list, options, "box_blur", variant, width, height, width, bench_box_blur, &context);
+
+        IntegralImage integral;
+        if (build_integral_image(&gray, &integral, true)) {
+            context.integral = &integral;
+            run_bench(list, options, "build_integral_image", variant, width, height, width, bench_build_integral_image, &context);
+            run_bench(list, options, "get_region_stats", variant, width, height, width, bench_region_stats, &context);
+            run_bench(list, options, "region_stats_scan", variant, width, height, width, bench_region_stats_scan, &context);
+            free_integral_image(&integral);
+        }
+
+        GrayPyramid pyramid;
+        if (build_gray_pyramid(&gray, &pyramid, 0)) {
+            context.pyramid = &pyramid;
+            run_bench(list, options, "build_gray_pyramid", variant, width, height, width, bench_build_gray_pyramid, &context);
+            run_bench(list, options, "estimate_pyramid_stats", variant, width, height, width, bench_estimate_pyramid_stats, &context);
+            free_gray_pyramid(&pyramid);
+        }
+
+        GrayscaleImage scratch = gray;
+        scratch.pixels = malloc(gray.data_size);
+        scratch.pool = NULL;
+        scratch.source_filename = NULL;
+        if (scratch.pixels) {
+            BenchContext scratch_context = context;
+            memcpy(scratch.pixels, gray.pixels, gray.data_size);
+            scratch_context.gray = &scratch;
+            run_bench(list, options, "apply_point_lut", variant, width, height, width, bench_apply_point_lut, &scratch_context);
+            run_bench(list, options, "apply_point_op_chain", variant, width, height, width, bench_point_op_chain, &scratch_context);
+            run_bench(list, options, "point_ops_separate", variant, width, height, width, bench_point_ops_separate, &scratch_context);
+            free(scratch.pixels);
+        }
+        run_bench(list, options, "get_grayscale_pixel", variant, width, height, width, bench_get_pixel, &context);
+        run_bench(list, options, "set_grayscale_pixel", variant, width, height, width, bench_set_pixel, &context);
+        run_bench(list, options, "gray_image_at", variant, width, height, width, bench_gray_image_at, &context);
+        run_bench(list, options, "gray_image_put", variant, width, height, width, bench_gray_image_put, &context);
+        run_bench(list, options, "gray_image_row", variant, width, height, width, bench_gray_image_row, &context);
+        run_bench(list, options, "crop_view_stats", variant, width, height, width, bench_crop_view_stats, &context);
+        run_bench(list, options, "crop_copy_stats", variant, width, height, width, bench_crop_copy_stats, &context);
+        run_bench(list, options, "save_grayscale_image", variant, width, height, width, bench_save_grayscale, &context);
+        run_bench(list, options, "write_gray_png_fast", variant, width, height, width, bench_write_gray_png_fast, &context);
+
+        free_grayscale_image(&gray);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Corpus (end to end)
+// ---------------------------------------------------------------------------
+
+static void bench_corpus(BenchResultList* list, const BenchOptions* options) {
+    BatchFileList files = {0};
+    if (!batch_add_path(&files, options->corpus)) {
+        fprintf(stderr, "\nCorpus not found: %s\n", options->corpus);
+        return;
+    }
+
+    for (int i = 0; i < files.count; i++) {
+        ImageData image;
+        if (load_image(files.paths[i], &image) != IMG_SUCCESS) {
+            continue;
+        }
+
+        BenchContext context;
+        memset(&context, 0, sizeof(context));
+        context.image = &image;
+        context.path = files.paths[i];
+
+        int width = image.width;
+        int height = image.height;
+        int pitch = image.surface->pitch;
+        fprintf(stderr, "\n%s\n", files.paths[i]);
+
+        run_bench(list, options, "IMG_Load", files.paths[i], width, height, pitch, bench_img_load, &context);
+        run_bench(list, options, "load_image", files.paths[i], width, height, pitch, bench_load_image, &context);
+        run_bench(list, options, "probe_image", files.paths[i], width, height, pitch, bench_probe_image, &context);
+
+        // The two halves of a prefetched load: the read and the decode from memory
+        PrefetchedFile file;
+        context.read_pool = buffer_pool_create(0);
+        if (context.read_pool && read_file_to_buffer(context.read_pool, files.paths[i], &file)) {
+            context.file = &file;
+            run_bench(list, options, "read_file_to_buffer", files.paths[i], width, height, pitch, bench_read_file, &context);
+            run_bench(list, options, "load_image_from_memory", files.paths[i], width, height, pitch, bench_load_from_memory, &context);
+            buffer_pool_release(context.read_pool, file.data);
+            context.file = NULL;
+        }
+        buffer_pool_destroy(context.read_pool);
+        context.read_pool = NULL;
+        run_bench(list, options, "load_and_convert", files.paths[i], width, height, pitch, bench_load_and_convert, &context);
+        run_bench(list, options, "load_grayscale_image", files.paths[i], width, height, pitch, bench_load_grayscale, &context);
+        run_bench(list, options, "load_grayscale_image_1_8", files.paths[i], width, height, pitch, bench_load_grayscale_thumbnail, &context);
+        run_bench(list, options, "IMG_SavePNG", files.paths[i], width, height, pitch, bench_img_save_png, &context);
+
+        GrayscaleImage gray;
+        if (convert_to_grayscale(&image, &gray)) {
+            context.gray = &gray;
+            run_bench(list, options, "save_grayscale_image", files.paths[i], width, height, width, bench_save_grayscale, &context);
+            run_bench(list, options, "write_gray_png_fast", files.paths[i], width, height, width, bench_write_gray_png_fast, &context);
+            free_grayscale_image(&gray);
+        }
+
+        free_image_data(&image);
+    }
+
+    free_batch_file_list(&files);
+}
+
+// ---------------------------------------------------------------------------
+// Output
+// ---------------------------------------------------------------------------
+
+static void write_json_string(FILE* file, const char* text) {
+    fputc('"', file);
+    for (const char* c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            fputc('\\', file);
+        }
+        fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+static bool write_json(const BenchResultList* list, const BenchOptions* options, const char* path) {
+    FILE* file = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"threads\": %d,\n", get_analysis_thread_count());
+    fprintf(file, "  \"kernel_isa\": ");
+    write_json_string(file, get_grayscale_kernel_isa());
+    fprintf(file, ",\n  \"warmup\": %d,\n  \"reps\": %d,\n", options->warmup, options->reps);
+    fprintf(file, "  \"results\": [\n");
+
+    for (int i = 0; i < list->count; i++) {
+        const BenchResult* r = &list->items[i];
+        fprintf(file, "    {\"function\": ");
+        write_json_string(file, r->function);
+        fprintf(file, ", \"variant\": ");
+        write_json_string(file, r->variant);
+        fprintf(file, ", \"width\": %d, \"height\": %d, \"pitch\": %d, \"pixels\": %llu, \"reps\": %d, "
+                      "\"median_ms\": %.4f, \"p99_ms\": %.4f, \"median_mpix_s\": %.2f, \"p99_mpix_s\": %.2f}%s\n",
+                r->width, r->height, r->pitch, (unsigned long long)r->pixels, r->reps,
+                r->median_ms, r->p99_ms, r->median_mpix_s, r->p99_mpix_s,
+                i + 1 < list->count ? "," : "");
+    }
+
+    fprintf(file, "  ]\n}\n");
+
+    if (file != stdout) {
+        fclose(file);
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    options.warmup = BENCH_DEFAULT_WARMUP;
+    options.reps = BENCH_DEFAULT_REPS;
+    options.json_path = BENCH_DEFAULT_JSON;
+    options.corpus = BENCH_DEFAULT_CORPUS;
+    bool run_corpus = true;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            options.reps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            options.warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            options.json_path = argv[++i];
+        } else if (strcmp(argv[i], "--corpus") == 0 && i + 1 < argc) {
+            options.corpus = argv[++i];
+        } else if (strcmp(argv[i], "--no-corpus") == 0) {
+            run_corpus = false;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            if (!set_analysis_thread_count(atoi(argv[++i]))) {
+                fprintf(stderr, "Invalid thread count: %s\n", argv[i]);
+                return 1;
+            }
+        } else {
+            fprintf(stderr, "Usage: %s [--reps N] [--warmup N] [--threads N] [--json FILE|-] [--corpus DIR] [--no-corpus]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (options.reps < 1 || options.reps > BENCH_MAX_REPS || options.warmup < 0) {
+        fprintf(stderr, "Repetitions must be between 1 and %d\n", BENCH_MAX_REPS);
+        return 1;
+    }
+
+    if (!image_loader_init()) {
+        fprintf(stderr, "Failed to initialize image loader\n");
+        return 1;
+    }
+
+    fprintf(stderr, "Benchmark: %d warmup, %d reps, %d threads, %s kernels\n",
+            options.warmup, options.reps, get_analysis_thread_count(), get_grayscale_kernel_isa());
+    fprintf(stderr, "  %-30s %-28s %12s  %12s  %16s  %16s\n", "function", "variant", "median", "p99", "median", "p99");
+
+    BenchResultList results = {0};
+    bench_synthetic(&results, &options);
+    if (run_corpus) {
+        bench_corpus(&results, &options);
+    }
+    remove(BENCH_TMP_OUTPUT);
+
+    bool ok = write_json(&results, &options, options.json_path);
+    if (ok && strcmp(options.json_path, "-") != 0) {
+        fprintf(stderr, "\nResults written to %s\n", options.json_path);
+    } else if (!ok) {
+        fprintf(stderr, "\nCould not write %s\n", options.json_path);
+    }
+
+    free(results.items);
+    shutdown_analysis_threads();
+    image_loader_cleanup();
+    return ok ? 0 : 1;
+}
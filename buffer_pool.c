@@ -0,0 +1,209 @@
+#include "buffer_pool.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Capacity classes: 2^k, 1.25 * 2^k, 1.5 * 2^k and 1.75 * 2^k for every k
+// from log2(BUFFER_POOL_MIN_CAPACITY) up
+#define MIN_CAPACITY_SHIFT 12
+#define CLASS_STEPS 4
+#define CLASS_COUNT ((int)(sizeof(size_t) * 8 - MIN_CAPACITY_SHIFT) * CLASS_STEPS)
+
+// Bookkeeping stored in front of every buffer (within the alignment padding)
+typedef struct BufferHeader {
+    void* block;                // Start of the malloc'ed block
+    BufferPool* owner;
+    struct BufferHeader* next;  // Next cached buffer of the same class
+    size_t capacity;
+    int class_index;
+} BufferHeader;
+
+struct BufferPool {
+    SDL_SpinLock lock;
+    size_t max_cached_bytes;
+    BufferHeader* free_lists[CLASS_COUNT];  // Cached buffers, most recently released first
+    BufferPoolStats stats;
+};
+
+static int highest_bit(size_t value) {
+    int bit = 0;
+    while (value >>= 1) {
+        bit++;
+    }
+    return bit;
+}
+
+// Smallest class holding size bytes, and its capacity
+static int capacity_class(size_t size, size_t* capacity) {
+    if (size <= BUFFER_POOL_MIN_CAPACITY) {
+        *capacity = BUFFER_POOL_MIN_CAPACITY;
+        return 0;
+    }
+
+    int k = highest_bit(size - 1);
+    size_t base = (size_t)1 << k;
+    size_t step = base / CLASS_STEPS;
+    size_t q = (size - base + step - 1) / step;
+    if (q == CLASS_STEPS) {
+        k++;
+        base <<= 1;
+        q = 0;
+    }
+
+    *capacity = base + q * (base / CLASS_STEPS);
+    return (k - MIN_CAPACITY_SHIFT) * CLASS_STEPS + (int)q;
+}
+
+static BufferHeader* get_header(const void* buffer) {
+    return (BufferHeader*)((const Uint8*)buffer - sizeof(BufferHeader));
+}
+
+static void* header_buffer(BufferHeader* header) {
+    return (Uint8*)header + sizeof(BufferHeader);
+}
+
+static BufferHeader* allocate_buffer(BufferPool* pool, size_t capacity, int class_index) {
+    size_t overhead = sizeof(BufferHeader) + BUFFER_POOL_ALIGNMENT - 1;
+    if (capacity > SIZE_MAX - overhead) {
+        return NULL;
+    }
+
+    void* block = malloc(capacity + overhead);
+    if (!block) {
+        return NULL;
+    }
+
+    uintptr_t start = (uintptr_t)block + sizeof(BufferHeader);
+    uintptr_t aligned = (start + BUFFER_POOL_ALIGNMENT - 1) & ~(uintptr_t)(BUFFER_POOL_ALIGNMENT - 1);
+
+    BufferHeader* header = (BufferHeader*)(aligned - sizeof(BufferHeader));
+    header->block = block;
+    header->owner = pool;
+    header->next = NULL;
+    header->capacity = capacity;
+    header->class_index = class_index;
+    return header;
+}
+
+BufferPool* buffer_pool_create(size_t max_cached_bytes) {
+    BufferPool* pool = calloc(1, sizeof(BufferPool));
+    if (!pool) {
+        return NULL;
+    }
+    pool->max_cached_bytes = max_cached_bytes > 0 ? max_cached_bytes : BUFFER_POOL_DEFAULT_MAX_CACHED;
+    return pool;
+}
+
+void buffer_pool_destroy(BufferPool* pool) {
+    if (!pool) {
+        return;
+    }
+
+    buffer_pool_trim(pool);
+    if (pool->stats.outstanding > 0) {
+        fprintf(stderr, "buffer_pool_destroy: %zu buffer(s) still in use\n", pool->stats.outstanding);
+    }
+    free(pool);
+}
+
+void* buffer_pool_acquire(BufferPool* pool, size_t size) {
+    if (!pool) {
+        return NULL;
+    }
+
+    size_t capacity;
+    int class_index = capacity_class(size, &capacity);
+
+    SDL_AtomicLock(&pool->lock);
+    BufferHeader* header = pool->free_lists[class_index];
+    if (header) {
+        pool->free_lists[class_index] = header->next;
+        pool->stats.cached_bytes -= header->capacity;
+        pool->stats.reuses++;
+    }
+    pool->stats.acquires++;
+    pool->stats.outstanding++;
+    SDL_AtomicUnlock(&pool->lock);
+
+    if (!header) {
+        header = allocate_buffer(pool, capacity, class_index);
+        if (!header) {
+            SDL_AtomicLock(&pool->lock);
+            pool->stats.acquires--;
+            pool->stats.outstanding--;
+            SDL_AtomicUnlock(&pool->lock);
+            return NULL;
+        }
+    }
+
+    header->next = NULL;
+    return header_buffer(header);
+}
+
+void buffer_pool_release(BufferPool* pool, void* buffer) {
+    if (!pool || !buffer) {
+        return;
+    }
+
+    BufferHeader* header = get_header(buffer);
+    if (header->owner != pool) {
+        fprintf(stderr, "buffer_pool_release: buffer does not belong to this pool\n");
+        return;
+    }
+
+    bool keep;
+    SDL_AtomicLock(&pool->lock);
+    pool->stats.releases++;
+    pool->stats.outstanding--;
+    keep = pool->stats.cached_bytes + header->capacity <= pool->max_cached_bytes;
+    if (keep) {
+        header->next = pool->free_lists[header->class_index];
+        pool->free_lists[header->class_index] = header;
+        pool->stats.cached_bytes += header->capacity;
+    } else {
+        pool->stats.discards++;
+    }
+    SDL_AtomicUnlock(&pool->lock);
+
+    if (!keep) {
+        free(header->block);
+    }
+}
+
+size_t buffer_pool_get_capacity(const void* buffer) {
+    return buffer ? get_header(buffer)->capacity : 0;
+}
+
+void buffer_pool_trim(BufferPool* pool) {
+    if (!pool) {
+        return;
+    }
+
+    BufferHeader* lists[CLASS_COUNT];
+
+    SDL_AtomicLock(&pool->lock);
+    memcpy(lists, pool->free_lists, sizeof(lists));
+    memset(pool->free_lists, 0, sizeof(pool->free_lists));
+    pool->stats.cached_bytes = 0;
+    SDL_AtomicUnlock(&pool->lock);
+
+    for (int i = 0; i < CLASS_COUNT; i++) {
+        BufferHeader* header = lists[i];
+        while (header) {
+            BufferHeader* next = header->next;
+            free(header->block);
+            header = next;
+        }
+    }
+}
+
+void buffer_pool_get_stats(BufferPool* pool, BufferPoolStats* stats) {
+    if (!pool || !stats) {
+        return;
+    }
+
+    SDL_AtomicLock(&pool->lock);
+    *stats = pool->stats;
+    SDL_AtomicUnlock(&pool->lock);
+}
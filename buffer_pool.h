@@ -0,0 +1,83 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Alignment of every buffer handed out by a pool (one cache line, and enough
+// for aligned AVX2/AVX-512 loads)
+#define BUFFER_POOL_ALIGNMENT 64
+
+// Smallest capacity class; smaller requests are rounded up to it
+#define BUFFER_POOL_MIN_CAPACITY 4096
+
+// Default bound on the bytes a pool keeps cached for reuse
+#define BUFFER_POOL_DEFAULT_MAX_CACHED ((size_t)256 * 1024 * 1024)
+
+typedef struct BufferPool BufferPool;
+
+// Usage counters of a pool
+typedef struct {
+    Uint64 acquires;        // Buffers handed out
+    Uint64 reuses;          // Acquires served from the cache
+    Uint64 releases;        // Buffers given back
+    Uint64 discards;        // Releases freed because the cache was full
+    size_t cached_bytes;    // Capacity currently cached for reuse
+    size_t outstanding;     // Buffers handed out and not yet released
+} BufferPoolStats;
+
+/**
+ * Create a pool of reusable, aligned buffers
+ * Requests are rounded up to capacity classes (powers of two split into four
+ * steps, so at most 25% is wasted); released buffers are kept per class and
+ * handed out again to requests of the same class. Thread-safe
+ * @param max_cached_bytes Capacity kept cached at most (0 = default)
+ * @return New pool, or NULL on failure
+ */
+BufferPool* buffer_pool_create(size_t max_cached_bytes);
+
+/**
+ * Free the cached buffers and the pool
+ * Every buffer must have been released first
+ * @param pool Pool to destroy (may be NULL)
+ */
+void buffer_pool_destroy(BufferPool* pool);
+
+/**
+ * Get a buffer of at least size bytes, aligned to BUFFER_POOL_ALIGNMENT
+ * Contents are undefined (a reused buffer keeps its previous data)
+ * @param pool Buffer pool
+ * @param size Bytes needed
+ * @return Buffer, or NULL if memory runs out
+ */
+void* buffer_pool_acquire(BufferPool* pool, size_t size);
+
+/**
+ * Give a buffer back to the pool it came from
+ * @param pool Pool that handed out the buffer
+ * @param buffer Buffer from buffer_pool_acquire (may be NULL)
+ */
+void buffer_pool_release(BufferPool* pool, void* buffer);
+
+/**
+ * Get the usable capacity of a pooled buffer
+ * @param buffer Buffer from buffer_pool_acquire
+ * @return Capacity in bytes (at least the size requested)
+ */
+size_t buffer_pool_get_capacity(const void* buffer);
+
+/**
+ * Free every cached buffer; outstanding buffers are unaffected
+ * @param pool Buffer pool (may be NULL)
+ */
+void buffer_pool_trim(BufferPool* pool);
+
+/**
+ * Get the usage counters of a pool
+ * @param pool Buffer pool
+ * @param stats Pointer to store the counters
+ */
+void buffer_pool_get_stats(BufferPool* pool, BufferPoolStats* stats);
+
+#endif // BUFFER_POOL_H
@@ -0,0 +1,320 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "image_loader.h"
+#include "image_analysis.h"
+#include "grayscale_simd.h"
+#include "batch_pipeline.h"
+#include "cpu_features.h"
+
+// Exactness check for the grayscale row kernels (built by `make check`)
+// Every instruction set the CPU supports is compared with the original double
+// expression on all 2^24 RGB triples and on the images/ corpus
+
+#define CHECK_DEFAULT_CORPUS "images"
+
+// Triples are numbered R << 16 | G << 8 | B and laid out in order, so 2^24
+// triples are 4096 rows of 4096 pixels
+#define CHECK_ROW_WIDTH 4096
+#define CHECK_ROWS ((1 << 24) / CHECK_ROW_WIDTH)
+
+// Each row is converted in two calls split at row % CHECK_SPLIT_PERIOD, so
+// the kernels also see short rows, vector tails and unaligned starts
+#define CHECK_SPLIT_PERIOD 97
+
+// Mismatches printed per format before the rest are only counted
+#define CHECK_MAX_REPORTS 5
+
+typedef struct {
+    const char* name;
+    Uint32 format;
+} CheckFormat;
+
+// The packed formats that get SIMD kernels (see init_grayscale_converter)
+static const CheckFormat g_formats[] = {
+    { "RGB24", SDL_PIXELFORMAT_RGB24 },
+    { "BGR24", SDL_PIXELFORMAT_BGR24 },
+    { "ARGB8888", SDL_PIXELFORMAT_ARGB8888 },
+    { "ABGR8888", SDL_PIXELFORMAT_ABGR8888 },
+    { "RGBA8888", SDL_PIXELFORMAT_RGBA8888 },
+    { "BGRA8888", SDL_PIXELFORMAT_BGRA8888 },
+    { "RGB888", SDL_PIXELFORMAT_RGB888 },
+    { "BGR888", SDL_PIXELFORMAT_BGR888 },
+};
+
+// Expected luminance of every triple, indexed by R << 16 | G << 8 | B
+static Uint8* g_expected = NULL;
+
+static Uint8 reference_luminance(Uint8 r, Uint8 g, Uint8 b) {
+    return (Uint8)(0.2125 * r + 0.7154 * g + 0.0721 * b + 0.5);
+}
+
+static bool build_expected_table(void) {
+    g_expected = (Uint8*)malloc((size_t)1 << 24);
+    if (!g_expected) {
+        fprintf(stderr, "Could not allocate the reference table\n");
+        return false;
+    }
+
+    for (Uint32 i = 0; i < (1u << 24); i++) {
+        g_expected[i] = reference_luminance((Uint8)(i >> 16), (Uint8)(i >> 8), (Uint8)i);
+    }
+    return true;
+}
+
+// Same byte order SDL uses for a pixel value of the given size
+static void write_pixel_value(Uint8* p, int bytes_per_pixel, Uint32 value) {
+    if (bytes_per_pixel == 3) {
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+        p[0] = (Uint8)value;
+        p[1] = (Uint8)(value >> 8);
+        p[2] = (Uint8)(value >> 16);
+#else
+        p[0] = (Uint8)(value >> 16);
+        p[1] = (Uint8)(value >> 8);
+        p[2] = (Uint8)value;
+#endif
+    } else {
+        memcpy(p, &value, 4);
+    }
+}
+
+static Uint32 read_pixel_value(const Uint8* p, int bytes_per_pixel) {
+    switch (bytes_per_pixel) {
+        case 1:
+            return p[0];
+        case 2: {
+            Uint16 value;
+            memcpy(&value, p, 2);
+            return value;
+        }
+        case 3:
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+            return (Uint32)p[0] | ((Uint32)p[1] << 8) | ((Uint32)p[2] << 16);
+#else
+            return ((Uint32)p[0] << 16) | ((Uint32)p[1] << 8) | (Uint32)p[2];
+#endif
+        default: {
+            Uint32 value;
+            memcpy(&value, p, 4);
+            return value;
+        }
+    }
+}
+
+static void report_mismatch(const char* what, const char* isa, Uint8 r, Uint8 g, Uint8 b, Uint8 got, Uint8 expected) {
+    fprintf(stderr, "  MISMATCH %s [%s]: RGB(%u, %u, %u) -> %u, expected %u\n",
+            what, isa, r, g, b, got, expected);
+}
+
+// ---------------------------------------------------------------------------
+// All 2^24 triples
+// ---------------------------------------------------------------------------
+
+// The scalar helper used by the generic and palette paths
+static Uint64 check_luminance_helper(void) {
+    Uint64 mismatches = 0;
+
+    for (Uint32 i = 0; i < (1u << 24); i++) {
+        Uint8 r = (Uint8)(i >> 16), g = (Uint8)(i >> 8), b = (Uint8)i;
+        Uint8 got = luminance_from_rgb(r, g, b);
+        if (got != g_expected[i]) {
+            if (mismatches < CHECK_MAX_REPORTS) {
+                report_mismatch("luminance_from_rgb", "scalar", r, g, b, got, g_expected[i]);
+            }
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+static Uint64 check_triples(const CheckFormat* check_format, const char* isa) {
+    SDL_PixelFormat* format = SDL_AllocFormat(check_format->format);
+    if (!format) {
+        fprintf(stderr, "  Could not allocate format %s: %s\n", check_format->name, SDL_GetError());
+        return 1;
+    }
+
+    GrayscaleConverter converter;
+    int bpp = format->BytesPerPixel;
+    Uint8* src = (Uint8*)malloc((size_t)CHECK_ROW_WIDTH * bpp);
+    Uint8* dst = (Uint8*)malloc(CHECK_ROW_WIDTH);
+    if (!src || !dst || !init_grayscale_converter(&converter, format)) {
+        fprintf(stderr, "  Could not prepare %s\n", check_format->name);
+        free(src);
+        free(dst);
+        SDL_FreeFormat(format);
+        return 1;
+    }
+
+    // Bits outside R, G and B (alpha or padding) get a varying pattern, so a
+    // kernel reading the wrong byte shows up
+    Uint32 other_mask = ~(format->Rmask | format->Gmask | format->Bmask);
+    if (bpp == 3) {
+        other_mask &= 0xFFFFFF;
+    }
+
+    Uint64 mismatches = 0;
+    for (int row = 0; row < CHECK_ROWS; row++) {
+        Uint32 first = (Uint32)row * CHECK_ROW_WIDTH;
+
+        for (int x = 0; x < CHECK_ROW_WIDTH; x++) {
+            Uint32 i = first + (Uint32)x;
+            Uint32 r = i >> 16, g = (i >> 8) & 0xFF, b = i & 0xFF;
+            Uint32 value = (r << format->Rshift) | (g << format->Gshift) | (b << format->Bshift) |
+                           ((i * 0x9E3779B1u) & other_mask);
+            write_pixel_value(src + x * bpp, bpp, value);
+        }
+
+        int split = row % CHECK_SPLIT_PERIOD;
+        memset(dst, 0, CHECK_ROW_WIDTH);
+        converter.kernel(&converter, src, dst, split);
+        converter.kernel(&converter, src + split * bpp, dst + split, CHECK_ROW_WIDTH - split);
+
+        for (int x = 0; x < CHECK_ROW_WIDTH; x++) {
+            Uint32 i = first + (Uint32)x;
+            if (dst[x] != g_expected[i]) {
+                if (mismatches < CHECK_MAX_REPORTS) {
+                    report_mismatch(check_format->name, isa, (Uint8)(i >> 16), (Uint8)(i >> 8), (Uint8)i,
+                                    dst[x], g_expected[i]);
+                }
+                mismatches++;
+            }
+        }
+    }
+
+    free(src);
+    free(dst);
+    SDL_FreeFormat(format);
+    return mismatches;
+}
+
+// ---------------------------------------------------------------------------
+// Corpus
+// ---------------------------------------------------------------------------
+
+// convert_to_grayscale on a decoded image against the reference of each pixel
+static Uint64 check_image(const ImageData* image, const char* isa) {
+    GrayscaleImage gray;
+    if (!convert_to_grayscale(image, &gray)) {
+        fprintf(stderr, "  Could not convert %s [%s]\n", image->filename, isa);
+        return 1;
+    }
+
+    SDL_Surface* surface = image->surface;
+    int bpp = surface->format->BytesPerPixel;
+    Uint64 mismatches = 0;
+
+    SDL_LockSurface(surface);
+    for (int y = 0; y < surface->h; y++) {
+        const Uint8* row = (const Uint8*)surface->pixels + (size_t)y * surface->pitch;
+        const Uint8* gray_row = gray.pixels + (size_t)y * gray.width;
+
+        for (int x = 0; x < surface->w; x++) {
+            Uint8 r, g, b;
+            SDL_GetRGB(read_pixel_value(row + x * bpp, bpp), surface->format, &r, &g, &b);
+            Uint8 expected = reference_luminance(r, g, b);
+            if (gray_row[x] != expected) {
+                if (mismatches < CHECK_MAX_REPORTS) {
+                    report_mismatch(image->filename, isa, r, g, b, gray_row[x], expected);
+                }
+                mismatches++;
+            }
+        }
+    }
+    SDL_UnlockSurface(surface);
+
+    free_grayscale_image(&gray);
+    return mismatches;
+}
+
+static Uint64 check_corpus(const char* corpus) {
+    BatchFileList files = {0};
+    if (!batch_add_path(&files, corpus)) {
+        fprintf(stderr, "\nCorpus not found: %s\n", corpus);
+        return 0;
+    }
+
+    Uint64 total = 0;
+    CpuIsa supported = get_cpu_isa_supported();
+    for (int i = 0; i < files.count; i++) {
+        ImageData image;
+        if (load_image(files.paths[i], &image) != IMG_SUCCESS) {
+            continue;
+        }
+
+        for (int isa = CPU_ISA_SCALAR; isa <= (int)supported; isa++) {
+            set_cpu_isa_limit((CpuIsa)isa);
+            const char* name = get_cpu_isa_name((CpuIsa)isa);
+            Uint64 mismatches = check_image(&image, name);
+            fprintf(stderr, "  %-40s %-8s %s\n", files.paths[i], name, mismatches ? "FAIL" : "ok");
+            total += mismatches;
+        }
+
+        free_image_data(&image);
+    }
+    set_cpu_isa_limit(CPU_ISA_AVX2);
+
+    free_batch_file_list(&files);
+    return total;
+}
+
+int main(int argc, char* argv[]) {
+    const char* corpus = CHECK_DEFAULT_CORPUS;
+    bool run_corpus = true;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--corpus") == 0 && i + 1 < argc) {
+            corpus = argv[++i];
+        } else if (strcmp(argv[i], "--no-corpus") == 0) {
+            run_corpus = false;
+        } else {
+            fprintf(stderr, "Usage: %s [--corpus DIR] [--no-corpus]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (!image_loader_init()) {
+        fprintf(stderr, "Failed to initialize image loader\n");
+        return 1;
+    }
+    if (!build_expected_table()) {
+        image_loader_cleanup();
+        return 1;
+    }
+
+    CpuIsa supported = get_cpu_isa_supported();
+    fprintf(stderr, "Kernel check: scalar through %s\n", get_cpu_isa_name(supported));
+
+    Uint64 total = check_luminance_helper();
+    fprintf(stderr, "  %-40s %-8s %s\n", "luminance_from_rgb", "scalar", total ? "FAIL" : "ok");
+
+    fprintf(stderr, "\nAll 2^24 RGB triples\n");
+    for (int isa = CPU_ISA_SCALAR; isa <= (int)supported; isa++) {
+        set_cpu_isa_limit((CpuIsa)isa);
+        const char* name = get_cpu_isa_name((CpuIsa)isa);
+
+        for (size_t f = 0; f < sizeof(g_formats) / sizeof(g_formats[0]); f++) {
+            Uint64 mismatches = check_triples(&g_formats[f], name);
+            fprintf(stderr, "  %-40s %-8s %s\n", g_formats[f].name, name, mismatches ? "FAIL" : "ok");
+            total += mismatches;
+        }
+    }
+    set_cpu_isa_limit(CPU_ISA_AVX2);
+
+    if (run_corpus) {
+        fprintf(stderr, "\nCorpus: %s\n", corpus);
+        total += check_corpus(corpus);
+    }
+
+    if (total > 0) {
+        fprintf(stderr, "\n%llu mismatches\n", (unsigned long long)total);
+    } else {
+        fprintf(stderr, "\nAll kernels match the reference\n");
+    }
+
+    free(g_expected);
+    shutdown_analysis_threads();
+    image_loader_cleanup();
+    return total > 0 ? 1 : 0;
+}
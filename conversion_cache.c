@@ -0,0 +1,533 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+#ifdef __APPLE__
+#define _DARWIN_C_SOURCE    // st_mtimespec
+#endif
+
+#include "conversion_cache.h"
+#include "gray_raw.h"
+#include "hash64.h"
+#include "profiler.h"
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+#define CACHE_META_MAGIC "GRAYMTA"
+#define CACHE_SOURCE_MAGIC "GRAYSRC"
+#define CACHE_VERSION 2       // 2: XXH64 keys, source size, sub-second mtime
+
+// Bytes read per step while hashing a source file
+#define CACHE_HASH_CHUNK (1024 * 1024)
+
+// Seeds keeping content keys and path keys apart
+#define CACHE_CONTENT_SEED 0
+#define CACHE_PATH_SEED 0x67726179737263ULL
+
+// <hash>.meta: the analysis stored with the pixels
+typedef struct {
+    char magic[8];
+    Uint32 version;
+    Uint32 analysis_size;   // sizeof(ImageAnalysis) of the writer
+    Uint64 source_size;     // Length of the source file, checked with the hash
+    ImageAnalysis analysis;
+} CacheMeta;
+
+// <path hash>.src: last known size/mtime of a source path and its content hash
+// The path itself follows the record so hash collisions are detected
+typedef struct {
+    char magic[8];
+    Uint32 version;
+    Uint32 path_length;
+    Uint64 size;
+    Sint64 mtime;
+    Sint64 mtime_nsec;      // Sub-second part (0 where the platform has none)
+    Sint64 recorded_at;     // Time the source was hashed
+    Uint64 content_hash;
+} CacheSourceRecord;
+
+// Cache file found while scanning for eviction
+typedef struct {
+    Uint64 hash;
+    Uint64 size;
+    Sint64 mtime;
+} CacheEntryInfo;
+
+// ---------------------------------------------------------------------------
+// Helpers
+// ---------------------------------------------------------------------------
+
+static Sint64 get_mtime_nsec(const struct stat* st) {
+#if defined(_WIN32)
+    (void)st;
+    return 0;
+#elif defined(__APPLE__)
+    return (Sint64)st->st_mtimespec.tv_nsec;
+#else
+    return (Sint64)st->st_mtim.tv_nsec;
+#endif
+}
+
+// XXH64 of the file bytes; the length is part of the hash and is returned
+// too so lookups can check it
+static bool hash_file(const char* path, Uint64* hash, Uint64* size) {
+    PROFILE_START(io_start);
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+
+    Uint8* buffer = malloc(CACHE_HASH_CHUNK);
+    if (!buffer) {
+        fclose(file);
+        return false;
+    }
+
+    Hash64State state;
+    Uint64 total = 0;
+    size_t read_size;
+
+    hash64_init(&state, CACHE_CONTENT_SEED);
+    while ((read_size = fread(buffer, 1, CACHE_HASH_CHUNK, file)) > 0) {
+        hash64_update(&state, buffer, read_size);
+        total += read_size;
+    }
+
+    bool ok = !ferror(file);
+    free(buffer);
+    fclose(file);
+    PROFILE_STOP(PROFILE_STAGE_FILE_IO, io_start, total);
+
+    *hash = hash64_final(&state);
+    *size = total;
+    return ok;
+}
+
+static void entry_path(const ConversionCache* cache, Uint64 hash, const char* extension, char* buffer, size_t size) {
+    snprintf(buffer, size, "%s/%016llx.%s", cache->directory, (unsigned long long)hash, extension);
+}
+
+static bool make_directory(const char* path) {
+#ifdef _WIN32
+    int result = _mkdir(path);
+#else
+    int result = mkdir(path, 0755);
+#endif
+    return result == 0 || errno == EEXIST;
+}
+
+// Create a directory and any missing parents
+static bool make_directories(const char* path) {
+    char buffer[512];
+    size_t length = strlen(path);
+    if (length == 0 || length >= sizeof(buffer)) {
+        return false;
+    }
+    memcpy(buffer, path, length + 1);
+
+    for (size_t i = 1; i < length; i++) {
+        if (buffer[i] == '/') {
+            buffer[i] = '\0';
+            if (!make_directory(buffer)) {
+                return false;
+            }
+            buffer[i] = '/';
+        }
+    }
+    return make_directory(buffer);
+}
+
+// ---------------------------------------------------------------------------
+// Source records
+// ---------------------------------------------------------------------------
+
+static bool read_source_record(const ConversionCache* cache, const char* source_path, Uint64 path_hash,
+                               CacheSourceRecord* record) {
+    char path[600];
+    entry_path(cache, path_hash, "src", path, sizeof(path));
+
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+
+    size_t path_length = strlen(source_path);
+    char stored_path[512];
+    bool ok = fread(record, sizeof(CacheSourceRecord), 1, file) == 1 &&
+              memcmp(record->magic, CACHE_SOURCE_MAGIC, sizeof(CACHE_SOURCE_MAGIC)) == 0 &&
+              record->version == CACHE_VERSION &&
+              record->path_length == path_length && path_length < sizeof(stored_path) &&
+              fread(stored_path, 1, path_length, file) == path_length &&
+              memcmp(stored_path, source_path, path_length) == 0;
+    fclose(file);
+    return ok;
+}
+
+static void write_source_record(const ConversionCache* cache, const char* source_path, Uint64 path_hash,
+                                const CacheSourceRecord* record) {
+    char path[600];
+    entry_path(cache, path_hash, "src", path, sizeof(path));
+
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        return;
+    }
+
+    bool ok = fwrite(record, sizeof(CacheSourceRecord), 1, file) == 1 &&
+              fwrite(source_path, 1, record->path_length, file) == record->path_length;
+    if (fclose(file) != 0 || !ok) {
+        remove(path);
+    }
+}
+
+// Get the content hash and size of a source, rehashing only if size or
+// mtime changed
+// A record is also not trusted when the file was modified in the second it
+// was hashed: a rewrite later in that second may keep the same timestamp on
+// file systems without sub-second times
+static bool get_content_hash(const ConversionCache* cache, const char* source_path, ConversionCacheKey* key) {
+    struct stat st;
+    if (stat(source_path, &st) != 0) {
+        return false;
+    }
+
+    Uint64 path_hash = hash64(source_path, strlen(source_path), CACHE_PATH_SEED);
+    Sint64 mtime_nsec = get_mtime_nsec(&st);
+
+    CacheSourceRecord record;
+    if (read_source_record(cache, source_path, path_hash, &record) &&
+        record.size == (Uint64)st.st_size && record.mtime == (Sint64)st.st_mtime &&
+        record.mtime_nsec == mtime_nsec && record.mtime < record.recorded_at) {
+        key->content_hash = record.content_hash;
+        key->content_size = record.size;
+        return true;
+    }
+
+    Sint64 recorded_at = (Sint64)time(NULL);
+    if (!hash_file(source_path, &key->content_hash, &key->content_size)) {
+        return false;
+    }
+
+    // The file changed while it was read: use the hash, but do not remember it
+    if (key->content_size != (Uint64)st.st_size) {
+        return true;
+    }
+
+    memset(&record, 0, sizeof(record));
+    memcpy(record.magic, CACHE_SOURCE_MAGIC, sizeof(CACHE_SOURCE_MAGIC));
+    record.version = CACHE_VERSION;
+    record.path_length = (Uint32)strlen(source_path);
+    record.size = (Uint64)st.st_size;
+    record.mtime = (Sint64)st.st_mtime;
+    record.mtime_nsec = mtime_nsec;
+    record.recorded_at = recorded_at;
+    record.content_hash = key->content_hash;
+    write_source_record(cache, source_path, path_hash, &record);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Eviction
+// ---------------------------------------------------------------------------
+
+static int compare_entry_age(const void* a, const void* b) {
+    const CacheEntryInfo* entry_a = (const CacheEntryInfo*)a;
+    const CacheEntryInfo* entry_b = (const CacheEntryInfo*)b;
+    if (entry_a->mtime != entry_b->mtime) {
+        return entry_a->mtime < entry_b->mtime ? -1 : 1;
+    }
+    return 0;
+}
+
+static int compare_hash(const void* a, const void* b) {
+    Uint64 hash_a = *(const Uint64*)a;
+    Uint64 hash_b = *(const Uint64*)b;
+    return hash_a < hash_b ? -1 : hash_a > hash_b ? 1 : 0;
+}
+
+static bool append_hash(Uint64** hashes, int* count, int* capacity, Uint64 hash) {
+    if (*count == *capacity) {
+        int new_capacity = *capacity ? *capacity * 2 : 32;
+        Uint64* grown = realloc(*hashes, (size_t)new_capacity * sizeof(Uint64));
+        if (!grown) {
+            return false;
+        }
+        *hashes = grown;
+        *capacity = new_capacity;
+    }
+    (*hashes)[(*count)++] = hash;
+    return true;
+}
+
+// Remove the source records that point to no stored entry (their entry was
+// evicted, or the conversion was never stored); kept is sorted
+static void evict_source_records(const ConversionCache* cache, const Uint64* sources, int source_count,
+                                 const Uint64* kept, int kept_count) {
+    for (int i = 0; i < source_count; i++) {
+        char path[600];
+        entry_path(cache, sources[i], "src", path, sizeof(path));
+
+        CacheSourceRecord record;
+        FILE* file = fopen(path, "rb");
+        if (!file) {
+            continue;
+        }
+        bool valid = fread(&record, sizeof(record), 1, file) == 1 &&
+                     memcmp(record.magic, CACHE_SOURCE_MAGIC, sizeof(CACHE_SOURCE_MAGIC)) == 0 &&
+                     record.version == CACHE_VERSION;
+        fclose(file);
+
+        if (!valid || !bsearch(&record.content_hash, kept, (size_t)kept_count, sizeof(Uint64), compare_hash)) {
+            remove(path);
+        }
+    }
+}
+
+// Remove least recently used entries until the cache fits its limit, then
+// the source records of the removed entries
+// keep_hash is never evicted (the entry just stored)
+static void evict_entries(ConversionCache* cache, Uint64 keep_hash) {
+    DIR* dir = opendir(cache->directory);
+    if (!dir) {
+        return;
+    }
+
+    CacheEntryInfo* entries = NULL;
+    int count = 0;
+    int capacity = 0;
+    Uint64* sources = NULL;
+    int source_count = 0;
+    int source_capacity = 0;
+    Uint64 total = 0;
+    struct dirent* item;
+
+    while ((item = readdir(dir)) != NULL) {
+        unsigned long long hash;
+        char extension[8];
+        if (sscanf(item->d_name, "%16llx.%7s", &hash, extension) != 2) {
+            continue;
+        }
+        if (strcmp(extension, "src") == 0) {
+            append_hash(&sources, &source_count, &source_capacity, (Uint64)hash);
+            continue;
+        }
+        if (strcmp(extension, "gray") != 0) {
+            continue;
+        }
+
+        char path[600];
+        struct stat st;
+        entry_path(cache, (Uint64)hash, "gray", path, sizeof(path));
+        if (stat(path, &st) != 0) {
+            continue;
+        }
+
+        if (count == capacity) {
+            int new_capacity = capacity ? capacity * 2 : 32;
+            CacheEntryInfo* grown = realloc(entries, (size_t)new_capacity * sizeof(CacheEntryInfo));
+            if (!grown) {
+                break;
+            }
+            entries = grown;
+            capacity = new_capacity;
+        }
+
+        entries[count].hash = (Uint64)hash;
+        entries[count].size = (Uint64)st.st_size + sizeof(CacheMeta);
+        entries[count].mtime = (Sint64)st.st_mtime;
+        total += entries[count].size;
+        count++;
+    }
+    closedir(dir);
+
+    if (total > cache->max_bytes && count > 0) {
+        qsort(entries, (size_t)count, sizeof(CacheEntryInfo), compare_entry_age);
+
+        // Hashes of the entries that stay, to match the source records against
+        Uint64* kept = malloc((size_t)count * sizeof(Uint64));
+        int kept_count = 0;
+
+        for (int i = 0; i < count; i++) {
+            if (total <= cache->max_bytes || entries[i].hash == keep_hash) {
+                if (kept) {
+                    kept[kept_count++] = entries[i].hash;
+                }
+                continue;
+            }
+
+            char path[600];
+            entry_path(cache, entries[i].hash, "meta", path, sizeof(path));
+            remove(path);
+            entry_path(cache, entries[i].hash, "gray", path, sizeof(path));
+            remove(path);
+
+            total -= entries[i].size;
+            cache->evictions++;
+        }
+
+        if (kept) {
+            qsort(kept, (size_t)kept_count, sizeof(Uint64), compare_hash);
+            evict_source_records(cache, sources, source_count, kept, kept_count);
+            free(kept);
+        }
+    }
+
+    free(sources);
+    free(entries);
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+bool conversion_cache_open(ConversionCache* cache, const char* directory, Uint64 max_bytes) {
+    if (!cache) {
+        return false;
+    }
+
+    memset(cache, 0, sizeof(ConversionCache));
+    if (!directory) {
+        directory = CONVERSION_CACHE_DEFAULT_DIR;
+    }
+
+    size_t length = strlen(directory);
+    if (length == 0 || length >= sizeof(cache->directory)) {
+        return false;
+    }
+    memcpy(cache->directory, directory, length + 1);
+    cache->max_bytes = max_bytes ? max_bytes : CONVERSION_CACHE_DEFAULT_MAX_BYTES;
+
+    if (!make_directories(cache->directory)) {
+        printf("Erro ao criar diretorio de cache: %s\n", cache->directory);
+        return false;
+    }
+    return true;
+}
+
+bool conversion_cache_lookup(ConversionCache* cache, const char* source_path, ConversionCacheKey* key,
+                             ImageAnalysis* analysis, GrayscaleImage* grayscale_image) {
+    if (!cache || !source_path || !key || !analysis || !grayscale_image) {
+        return false;
+    }
+
+    memset(key, 0, sizeof(ConversionCacheKey));
+
+    if (!get_content_hash(cache, source_path, key)) {
+        cache->misses++;
+        return false;
+    }
+    key->valid = true;
+
+    char path[600];
+    entry_path(cache, key->content_hash, "meta", path, sizeof(path));
+
+    CacheMeta meta;
+    FILE* file = fopen(path, "rb");
+    bool meta_ok = file && fread(&meta, sizeof(meta), 1, file) == 1 &&
+                   memcmp(meta.magic, CACHE_META_MAGIC, sizeof(CACHE_META_MAGIC)) == 0 &&
+                   meta.version == CACHE_VERSION && meta.analysis_size == sizeof(ImageAnalysis) &&
+                   meta.source_size == key->content_size;
+    if (file) {
+        fclose(file);
+    }
+    if (!meta_ok) {
+        cache->misses++;
+        return false;
+    }
+
+    // Header and size are validated on load; the payload checksum is skipped
+    // so a hit does not have to read every page up front
+    entry_path(cache, key->content_hash, "gray", path, sizeof(path));
+    if (!is_grayscale_raw_file(path) || !load_grayscale_raw(path, grayscale_image, false)) {
+        cache->misses++;
+        return false;
+    }
+
+    if (grayscale_image->width != meta.analysis.width || grayscale_image->height != meta.analysis.height) {
+        free_grayscale_image(grayscale_image);
+        cache->misses++;
+        return false;
+    }
+
+    // Refresh the entry's age for least-recently-used eviction
+    utime(path, NULL);
+
+    // Report the original source rather than the cache file
+    size_t filename_len = strlen(source_path) + 1;
+    char* source_filename = malloc(filename_len);
+    if (source_filename) {
+        memcpy(source_filename, source_path, filename_len);
+        free(grayscale_image->source_filename);
+        grayscale_image->source_filename = source_filename;
+    }
+
+    *analysis = meta.analysis;
+    cache->hits++;
+    return true;
+}
+
+bool conversion_cache_store(ConversionCache* cache, const ConversionCacheKey* key,
+                            const ImageAnalysis* analysis, const GrayscaleImage* grayscale_image) {
+    if (!cache || !key || !key->valid || !analysis || !grayscale_image || !grayscale_image->pixels) {
+        return false;
+    }
+
+    // Pixels first, metadata last: a lookup needs both, so an interrupted
+    // store is seen as a miss
+    char gray_path[600];
+    char meta_path[600];
+    entry_path(cache, key->content_hash, "gray", gray_path, sizeof(gray_path));
+    entry_path(cache, key->content_hash, "meta", meta_path, sizeof(meta_path));
+
+    if (!save_grayscale_raw(grayscale_image, gray_path)) {
+        return false;
+    }
+
+    CacheMeta meta;
+    memset(&meta, 0, sizeof(meta));
+    memcpy(meta.magic, CACHE_META_MAGIC, sizeof(CACHE_META_MAGIC));
+    meta.version = CACHE_VERSION;
+    meta.analysis_size = sizeof(ImageAnalysis);
+    meta.source_size = key->content_size;
+    meta.analysis = *analysis;
+
+    FILE* file = fopen(meta_path, "wb");
+    bool ok = file && fwrite(&meta, sizeof(meta), 1, file) == 1;
+    if (file && fclose(file) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        remove(meta_path);
+        remove(gray_path);
+        return false;
+    }
+
+    cache->stores++;
+    evict_entries(cache, key->content_hash);
+    return true;
+}
+
+void print_conversion_cache_stats(const ConversionCache* cache) {
+    if (!cache) {
+        return;
+    }
+
+    printf("\n=== Cache de Conversao ===\n");
+    printf("Diretorio: %s\n", cache->directory);
+    printf("Acertos: %d\n", cache->hits);
+    printf("Faltas: %d\n", cache->misses);
+    printf("Entradas gravadas: %d\n", cache->stores);
+    printf("Entradas removidas: %d\n", cache->evictions);
+    printf("==========================\n");
+}
@@ -0,0 +1,73 @@
+#ifndef CONVERSION_CACHE_H
+#define CONVERSION_CACHE_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include "image_analysis.h"
+
+// Default cache location and size limit
+#define CONVERSION_CACHE_DEFAULT_DIR "grayscale_images/.cache"
+#define CONVERSION_CACHE_DEFAULT_MAX_BYTES (512ULL * 1024 * 1024)
+
+// On-disk cache of conversion results, addressed by a hash of the source bytes
+// Each entry holds the grayscale pixels (raw container, see gray_raw.h) and the
+// ImageAnalysis; a per-path record of size/mtime avoids rehashing unchanged files
+typedef struct {
+    char directory[512];
+    Uint64 max_bytes;       // Total size of entries kept before evicting
+    int hits;
+    int misses;
+    int stores;
+    int evictions;
+} ConversionCache;
+
+// Identifies the source of a lookup so a miss can be stored afterwards
+typedef struct {
+    Uint64 content_hash;    // Hash of the source file bytes (XXH64)
+    Uint64 content_size;    // Length of the source file
+    bool valid;             // false if the source could not be read
+} ConversionCacheKey;
+
+/**
+ * Open (and create if needed) a cache directory
+ * @param cache Cache to initialize
+ * @param directory Cache directory (NULL for CONVERSION_CACHE_DEFAULT_DIR)
+ * @param max_bytes Size limit for stored entries (0 for CONVERSION_CACHE_DEFAULT_MAX_BYTES)
+ * @return true on success, false if the directory cannot be created
+ */
+bool conversion_cache_open(ConversionCache* cache, const char* directory, Uint64 max_bytes);
+
+/**
+ * Look up the conversion result of a source file
+ * The file is only hashed when its size or modification time changed since it
+ * was last seen. On a hit the grayscale image is mapped from the cache (free it
+ * with free_grayscale_image) and the stored analysis is returned.
+ * @param cache Open cache
+ * @param source_path Source image file
+ * @param key Pointer to store the key for a later conversion_cache_store
+ * @param analysis Pointer to store the cached analysis
+ * @param grayscale_image Pointer to store the cached grayscale image
+ * @return true on a hit, false on a miss
+ */
+bool conversion_cache_lookup(ConversionCache* cache, const char* source_path, ConversionCacheKey* key,
+                             ImageAnalysis* analysis, GrayscaleImage* grayscale_image);
+
+/**
+ * Store a conversion result and evict the least recently used entries when
+ * the cache grows past its size limit
+ * @param cache Open cache
+ * @param key Key returned by the lookup that missed
+ * @param analysis Analysis to store
+ * @param grayscale_image Grayscale image to store
+ * @return true on success, false on failure (the cache is left consistent)
+ */
+bool conversion_cache_store(ConversionCache* cache, const ConversionCacheKey* key,
+                            const ImageAnalysis* analysis, const GrayscaleImage* grayscale_image);
+
+/**
+ * Print hit/miss/store/eviction counters
+ * @param cache Cache to describe
+ */
+void print_conversion_cache_stats(const ConversionCache* cache);
+
+#endif // CONVERSION_CACHE_H
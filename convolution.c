@@ -0,0 +1,585 @@
+#include "convolution.h"
+#include "cpu_features.h"
+#include "profiler.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_TAPS (2 * CONVOLUTION_MAX_RADIUS + 1)
+#define MAX_TAP_PAIRS ((MAX_TAPS + 1) / 2)
+
+// Row filtering turns 8-bit pixels into Q6 intermediates (pixel * 64), column
+// filtering turns those back into pixels: Q6 * Q14 weights = Q20
+#define ROW_SHIFT (CONVOLUTION_WEIGHT_BITS - 6)
+#define COLUMN_SHIFT (CONVOLUTION_WEIGHT_BITS + 6)
+
+// Vector loads may read this many bytes past the end of a padded row
+#define ROW_SLACK 32
+
+// Each pair of taps is packed in one 32-bit word (low tap in the low half)
+// so the vector kernels can feed it straight to pmaddwd
+typedef void (*RowFilterFunc)(const Uint8* padded, Sint16* out, int width, const Sint32* pairs, int taps);
+typedef void (*ColumnFilterFunc)(const Sint16* const* rows, Uint8* out, int width, const Sint32* pairs, int taps);
+
+// ---------------------------------------------------------------------------
+// Kernels
+// ---------------------------------------------------------------------------
+
+bool make_convolution_kernel(ConvolutionKernel* kernel, const float* weights, int radius) {
+    if (!kernel || !weights || radius < 0 || radius > CONVOLUTION_MAX_RADIUS) {
+        return false;
+    }
+
+    int taps = 2 * radius + 1;
+    double sum = 0.0;
+    double abs_sum = 0.0;
+    for (int k = 0; k < taps; k++) {
+        sum += weights[k];
+        abs_sum += fabs(weights[k]);
+    }
+    if (abs_sum > 2.0 + 1e-6) {
+        return false;
+    }
+
+    const double one = (double)(1 << CONVOLUTION_WEIGHT_BITS);
+    long fixed_sum = 0;
+    memset(kernel, 0, sizeof(ConvolutionKernel));
+    kernel->radius = radius;
+    for (int k = 0; k < taps; k++) {
+        kernel->weights[k] = (Sint16)lround(weights[k] * one);
+        fixed_sum += kernel->weights[k];
+    }
+
+    long center = kernel->weights[radius] + (lround(sum * one) - fixed_sum);
+    if (center < -32767 || center > 32767) {
+        return false;
+    }
+    kernel->weights[radius] = (Sint16)center;
+    return true;
+}
+
+bool make_gaussian_kernel(ConvolutionKernel* kernel, double sigma) {
+    if (!kernel || !(sigma > 0.0)) {
+        return false;
+    }
+
+    int radius = (int)ceil(CONVOLUTION_GAUSSIAN_EXTENT * sigma);
+    if (radius > CONVOLUTION_MAX_RADIUS) {
+        return false;
+    }
+
+    float weights[MAX_TAPS];
+    double total = 0.0;
+    for (int k = -radius; k <= radius; k++) {
+        double w = exp(-(double)(k * k) / (2.0 * sigma * sigma));
+        weights[k + radius] = (float)w;
+        total += w;
+    }
+    for (int k = 0; k < 2 * radius + 1; k++) {
+        weights[k] = (float)(weights[k] / total);
+    }
+    return make_convolution_kernel(kernel, weights, radius);
+}
+
+static int pack_tap_pairs(const ConvolutionKernel* kernel, Sint32* pairs) {
+    int taps = 2 * kernel->radius + 1;
+    for (int k = 0; k < taps; k += 2) {
+        Uint16 low = (Uint16)kernel->weights[k];
+        Uint16 high = (k + 1 < taps) ? (Uint16)kernel->weights[k + 1] : 0;
+        pairs[k / 2] = (Sint32)(((Uint32)high << 16) | low);
+    }
+    return taps;
+}
+
+static Sint16 pair_weight(const Sint32* pairs, int k) {
+    return (Sint16)(Uint16)((Uint32)pairs[k / 2] >> ((k & 1) * 16));
+}
+
+bool parse_convolution_border(const char* name, ConvolutionBorder* border) {
+    static const struct {
+        const char* name;
+        ConvolutionBorder border;
+    } modes[] = {
+        { "clamp", CONVOLUTION_BORDER_CLAMP },
+        { "mirror", CONVOLUTION_BORDER_MIRROR },
+        { "wrap", CONVOLUTION_BORDER_WRAP },
+        { "constant", CONVOLUTION_BORDER_CONSTANT }
+    };
+
+    if (!name || !border) {
+        return false;
+    }
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+        if (strcmp(name, modes[i].name) == 0) {
+            *border = modes[i].border;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Index of the pixel read for position i of a line of n pixels, or -1 for
+// the constant border value
+static int map_border_index(int i, int n, ConvolutionBorder border) {
+    if (i >= 0 && i < n) {
+        return i;
+    }
+
+    switch (border) {
+        case CONVOLUTION_BORDER_MIRROR: {
+            if (n == 1) {
+                return 0;
+            }
+            int period = 2 * n - 2;
+            i %= period;
+            if (i < 0) {
+                i += period;
+            }
+            return (i < n) ? i : period - i;
+        }
+        case CONVOLUTION_BORDER_WRAP:
+            i %= n;
+            return (i < 0) ? i + n : i;
+        case CONVOLUTION_BORDER_CONSTANT:
+            return -1;
+        case CONVOLUTION_BORDER_CLAMP:
+        default:
+            return (i < 0) ? 0 : n - 1;
+    }
+}
+
+// Copy a row with radius border pixels on each side
+static void fill_padded_row(const Uint8* row, int width, int radius, ConvolutionBorder border,
+                            Uint8 border_value, Uint8* padded) {
+    memcpy(padded + radius, row, (size_t)width);
+    for (int i = 1; i <= radius; i++) {
+        int left = map_border_index(-i, width, border);
+        int right = map_border_index(width - 1 + i, width, border);
+        padded[radius - i] = (left < 0) ? border_value : row[left];
+        padded[radius + width - 1 + i] = (right < 0) ? border_value : row[right];
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Scalar filters
+// ---------------------------------------------------------------------------
+
+static void filter_row_scalar(const Uint8* padded, Sint16* out, int width, const Sint32* pairs, int taps) {
+    for (int x = 0; x < width; x++) {
+        Sint32 sum = 1 << (ROW_SHIFT - 1);
+        for (int k = 0; k < taps; k++) {
+            sum += pair_weight(pairs, k) * padded[x + k];
+        }
+        out[x] = (Sint16)(sum >> ROW_SHIFT);
+    }
+}
+
+static void filter_column_scalar(const Sint16* const* rows, Uint8* out, int width, const Sint32* pairs, int taps) {
+    for (int x = 0; x < width; x++) {
+        Sint32 sum = 1 << (COLUMN_SHIFT - 1);
+        for (int k = 0; k < taps; k++) {
+            sum += pair_weight(pairs, k) * rows[k][x];
+        }
+        sum >>= COLUMN_SHIFT;
+        out[x] = (Uint8)(sum < 0 ? 0 : (sum > 255 ? 255 : sum));
+    }
+}
+
+#ifdef CPU_FEATURES_X86
+
+// ---------------------------------------------------------------------------
+// Vector filters
+// Two taps are applied at once: the 16-bit inputs of tap k and k+1 are
+// interleaved and pmaddwd multiplies them by the packed weight pair, leaving
+// 32-bit partial sums (no overflow while the absolute weights add up to 2.0)
+// ---------------------------------------------------------------------------
+
+TARGET_SSE2
+static void filter_row_sse2(const Uint8* padded, Sint16* out, int width, const Sint32* pairs, int taps) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(1 << (ROW_SHIFT - 1));
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m128i lo = round;
+        __m128i hi = round;
+        for (int k = 0; k < taps; k += 2) {
+            __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(padded + x + k)), zero);
+            __m128i b = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(padded + x + k + 1)), zero);
+            __m128i w = _mm_set1_epi32(pairs[k / 2]);
+            lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w));
+            hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w));
+        }
+        __m128i result = _mm_packs_epi32(_mm_srai_epi32(lo, ROW_SHIFT), _mm_srai_epi32(hi, ROW_SHIFT));
+        _mm_storeu_si128((__m128i*)(out + x), result);
+    }
+
+    filter_row_scalar(padded + x, out + x, width - x, pairs, taps);
+}
+
+TARGET_SSE2
+static void filter_column_sse2(const Sint16* const* rows, Uint8* out, int width, const Sint32* pairs, int taps) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(1 << (COLUMN_SHIFT - 1));
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m128i lo = round;
+        __m128i hi = round;
+        for (int k = 0; k < taps; k += 2) {
+            __m128i a = _mm_loadu_si128((const __m128i*)(rows[k] + x));
+            __m128i b = (k + 1 < taps) ? _mm_loadu_si128((const __m128i*)(rows[k + 1] + x)) : zero;
+            __m128i w = _mm_set1_epi32(pairs[k / 2]);
+            lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w));
+            hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w));
+        }
+        __m128i words = _mm_packs_epi32(_mm_srai_epi32(lo, COLUMN_SHIFT), _mm_srai_epi32(hi, COLUMN_SHIFT));
+        _mm_storel_epi64((__m128i*)(out + x), _mm_packus_epi16(words, words));
+    }
+
+    const Sint16* tail[MAX_TAPS];
+    for (int k = 0; k < taps; k++) {
+        tail[k] = rows[k] + x;
+    }
+    filter_column_scalar(tail, out + x, width - x, pairs, taps);
+}
+
+// In-lane unpacks split 16 inputs as 0-3/8-11 and 4-7/12-15, and the in-lane
+// pack puts them back in order, so no cross-lane shuffle is needed until the
+// final narrowing to bytes
+TARGET_AVX2
+static void filter_row_avx2(const Uint8* padded, Sint16* out, int width, const Sint32* pairs, int taps) {
+    const __m256i round = _mm256_set1_epi32(1 << (ROW_SHIFT - 1));
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16) {
+        __m256i lo = round;
+        __m256i hi = round;
+        for (int k = 0; k < taps; k += 2) {
+            __m256i a = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(padded + x + k)));
+            __m256i b = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(padded + x + k + 1)));
+            __m256i w = _mm256_set1_epi32(pairs[k / 2]);
+            lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), w));
+            hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), w));
+        }
+        __m256i result = _mm256_packs_epi32(_mm256_srai_epi32(lo, ROW_SHIFT), _mm256_srai_epi32(hi, ROW_SHIFT));
+        _mm256_storeu_si256((__m256i*)(out + x), result);
+    }
+
+    filter_row_scalar(padded + x, out + x, width - x, pairs, taps);
+}
+
+TARGET_AVX2
+static void filter_column_avx2(const Sint16* const* rows, Uint8* out, int width, const Sint32* pairs, int taps) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i round = _mm256_set1_epi32(1 << (COLUMN_SHIFT - 1));
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16) {
+        __m256i lo = round;
+        __m256i hi = round;
+        for (int k = 0; k < taps; k += 2) {
+            __m256i a = _mm256_loadu_si256((const __m256i*)(rows[k] + x));
+            __m256i b = (k + 1 < taps) ? _mm256_loadu_si256((const __m256i*)(rows[k + 1] + x)) : zero;
+            __m256i w = _mm256_set1_epi32(pairs[k / 2]);
+            lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), w));
+            hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), w));
+        }
+        __m256i words = _mm256_packs_epi32(_mm256_srai_epi32(lo, COLUMN_SHIFT), _mm256_srai_epi32(hi, COLUMN_SHIFT));
+        __m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(words, words), 0x08);
+        _mm_storeu_si128((__m128i*)(out + x), _mm256_castsi256_si128(bytes));
+    }
+
+    const Sint16* tail[MAX_TAPS];
+    for (int k = 0; k < taps; k++) {
+        tail[k] = rows[k] + x;
+    }
+    filter_column_scalar(tail, out + x, width - x, pairs, taps);
+}
+
+#endif // CPU_FEATURES_X86
+
+// Pick the widest filters the CPU supports
+static void select_filters(RowFilterFunc* row_filter, ColumnFilterFunc* column_filter) {
+    CpuIsa isa = get_cpu_isa();
+
+    *row_filter = filter_row_scalar;
+    *column_filter = filter_column_scalar;
+#ifdef CPU_FEATURES_X86
+    if (isa == CPU_ISA_AVX2) {
+        *row_filter = filter_row_avx2;
+        *column_filter = filter_column_avx2;
+    } else if (isa == CPU_ISA_SSE2) {
+        *row_filter = filter_row_sse2;
+        *column_filter = filter_column_sse2;
+    }
+#endif
+    (void)isa;
+}
+
+// ---------------------------------------------------------------------------
+// Output images
+// ---------------------------------------------------------------------------
+
+static bool init_filtered_image(const GrayscaleImage* src, GrayscaleImage* dst) {
+    return create_grayscale_image(dst, src->width, src->height, src->source_filename);
+}
+
+static bool valid_filter_images(const GrayscaleImage* src, const GrayscaleImage* dst) {
+    return src && src->pixels && dst && dst != src && src->width > 0 && src->height > 0;
+}
+
+// ---------------------------------------------------------------------------
+// Separable convolution
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    const GrayscaleImage* src;
+    GrayscaleImage* dst;
+    int row_radius;
+    int column_radius;
+    Sint32 row_pairs[MAX_TAP_PAIRS];
+    Sint32 column_pairs[MAX_TAP_PAIRS];
+    RowFilterFunc row_filter;
+    ColumnFilterFunc column_filter;
+    ConvolutionBorder border;
+    Uint8 border_value;
+    const Uint8* constant_row;      // Row of border_value (constant border only)
+    SDL_atomic_t failed;            // Set if a band could not get its buffers
+} ConvolveJob;
+
+// Row-filter image row i (border-mapped) into out
+static void filter_source_row(const ConvolveJob* job, int i, Uint8* padded, Sint16* out) {
+    const GrayscaleImage* src = job->src;
+    int index = map_border_index(i, src->height, job->border);
+    const Uint8* row = (index < 0) ? job->constant_row : src->pixels + (size_t)index * src->width;
+
+    fill_padded_row(row, src->width, job->row_radius, job->border, job->border_value, padded);
+    job->row_filter(padded, out, src->width, job->row_pairs, 2 * job->row_radius + 1);
+}
+
+// Each band keeps the row-filtered rows its column taps need in a ring of
+// 2 * column_radius + 1 rows; every output row filters one new source row
+static void convolve_band(void* context, int band, int row_begin, int row_end) {
+    ConvolveJob* job = (ConvolveJob*)context;
+    int width = job->src->width;
+    int radius = job->column_radius;
+    int window = 2 * radius + 1;
+    int first = row_begin - radius;    // Logical row held by ring slot 0
+    (void)band;
+
+    Uint8* padded = malloc((size_t)width + 2 * job->row_radius + ROW_SLACK);
+    Sint16* ring = malloc((size_t)window * width * sizeof(Sint16));
+    if (!padded || !ring) {
+        SDL_AtomicSet(&job->failed, 1);
+        free(padded);
+        free(ring);
+        return;
+    }
+
+    for (int i = first; i < row_begin + radius; i++) {
+        filter_source_row(job, i, padded, ring + (size_t)(i - first) * width);
+    }
+
+    const Sint16* taps[MAX_TAPS];
+    for (int y = row_begin; y < row_end; y++) {
+        int newest = y + radius;
+        filter_source_row(job, newest, padded, ring + (size_t)((newest - first) % window) * width);
+
+        for (int k = 0; k < window; k++) {
+            taps[k] = ring + (size_t)((y - radius + k - first) % window) * width;
+        }
+        job->column_filter(taps, job->dst->pixels + (size_t)y * width, width, job->column_pairs, window);
+    }
+
+    free(padded);
+    free(ring);
+}
+
+bool convolve_separable(const GrayscaleImage* src, GrayscaleImage* dst,
+                        const ConvolutionKernel* row_kernel, const ConvolutionKernel* column_kernel,
+                        ConvolutionBorder border, Uint8 border_value) {
+    if (!valid_filter_images(src, dst) || !row_kernel || !column_kernel ||
+        row_kernel->radius < 0 || row_kernel->radius > CONVOLUTION_MAX_RADIUS ||
+        column_kernel->radius < 0 || column_kernel->radius > CONVOLUTION_MAX_RADIUS) {
+        return false;
+    }
+
+    ConvolveJob* job = malloc(sizeof(ConvolveJob));
+    Uint8* constant_row = (border == CONVOLUTION_BORDER_CONSTANT) ? malloc((size_t)src->width) : NULL;
+    if (!job || (border == CONVOLUTION_BORDER_CONSTANT && !constant_row) || !init_filtered_image(src, dst)) {
+        free(job);
+        free(constant_row);
+        return false;
+    }
+    if (constant_row) {
+        memset(constant_row, border_value, (size_t)src->width);
+    }
+
+    job->src = src;
+    job->dst = dst;
+    job->row_radius = row_kernel->radius;
+    job->column_radius = column_kernel->radius;
+    pack_tap_pairs(row_kernel, job->row_pairs);
+    pack_tap_pairs(column_kernel, job->column_pairs);
+    select_filters(&job->row_filter, &job->column_filter);
+    job->border = border;
+    job->border_value = border_value;
+    job->constant_row = constant_row;
+    SDL_AtomicSet(&job->failed, 0);
+
+    PROFILE_START(filter_start);
+    thread_pool_run_bands(get_analysis_pool(), src->height, convolve_band, job);
+    PROFILE_STOP(PROFILE_STAGE_FILTER, filter_start, src->data_size);
+
+    bool ok = !SDL_AtomicGet(&job->failed);
+    free(job);
+    free(constant_row);
+    if (!ok) {
+        free_grayscale_image(dst);
+    }
+    return ok;
+}
+
+bool gaussian_blur(const GrayscaleImage* src, GrayscaleImage* dst, double sigma,
+                   ConvolutionBorder border, Uint8 border_value) {
+    ConvolutionKernel kernel;
+    if (!make_gaussian_kernel(&kernel, sigma)) {
+        return false;
+    }
+    return convolve_separable(src, dst, &kernel, &kernel, border, border_value);
+}
+
+// ---------------------------------------------------------------------------
+// Box blur
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    const GrayscaleImage* src;
+    GrayscaleImage* dst;
+    int radius;
+    Uint64 reciprocal;              // 2^40 / area, rounded up
+    ConvolutionBorder border;
+    Uint8 border_value;
+    const Uint8* constant_row;
+    SDL_atomic_t failed;
+} BoxJob;
+
+#define BOX_RECIPROCAL_SHIFT 40
+
+// Running horizontal window sums of image row i (border-mapped)
+static void box_row_sums(const BoxJob* job, int i, Uint8* padded, Uint16* out) {
+    const GrayscaleImage* src = job->src;
+    int width = src->width;
+    int window = 2 * job->radius + 1;
+    int index = map_border_index(i, src->height, job->border);
+    const Uint8* row = (index < 0) ? job->constant_row : src->pixels + (size_t)index * width;
+
+    fill_padded_row(row, width, job->radius, job->border, job->border_value, padded);
+
+    Uint32 sum = 0;
+    for (int k = 0; k < window; k++) {
+        sum += padded[k];
+    }
+    out[0] = (Uint16)sum;
+    for (int x = 1; x < width; x++) {
+        sum += padded[x + window - 1];
+        sum -= padded[x - 1];
+        out[x] = (Uint16)sum;
+    }
+}
+
+// Column sums slide down the band: each output row adds the row entering the
+// window and subtracts the one leaving it
+static void box_band(void* context, int band, int row_begin, int row_end) {
+    BoxJob* job = (BoxJob*)context;
+    int width = job->src->width;
+    int radius = job->radius;
+    int window = 2 * radius + 1;
+    int first = row_begin - radius;
+    Uint32 half = (Uint32)(window * window) / 2;
+    (void)band;
+
+    Uint8* padded = malloc((size_t)width + 2 * radius);
+    Uint16* ring = malloc((size_t)window * width * sizeof(Uint16));
+    Uint32* columns = calloc((size_t)width, sizeof(Uint32));
+    if (!padded || !ring || !columns) {
+        SDL_AtomicSet(&job->failed, 1);
+        free(padded);
+        free(ring);
+        free(columns);
+        return;
+    }
+
+    for (int i = first; i <= row_begin + radius; i++) {
+        Uint16* sums = ring + (size_t)(i - first) * width;
+        box_row_sums(job, i, padded, sums);
+        for (int x = 0; x < width; x++) {
+            columns[x] += sums[x];
+        }
+    }
+
+    for (int y = row_begin; y < row_end; y++) {
+        Uint8* out = job->dst->pixels + (size_t)y * width;
+        for (int x = 0; x < width; x++) {
+            out[x] = (Uint8)(((Uint64)(columns[x] + half) * job->reciprocal) >> BOX_RECIPROCAL_SHIFT);
+        }
+
+        if (y + 1 < row_end) {
+            // Row y - radius leaves the window and y + radius + 1 takes its slot
+            Uint16* sums = ring + (size_t)((y - radius - first) % window) * width;
+            for (int x = 0; x < width; x++) {
+                columns[x] -= sums[x];
+            }
+            box_row_sums(job, y + radius + 1, padded, sums);
+            for (int x = 0; x < width; x++) {
+                columns[x] += sums[x];
+            }
+        }
+    }
+
+    free(padded);
+    free(ring);
+    free(columns);
+}
+
+bool box_blur(const GrayscaleImage* src, GrayscaleImage* dst, int radius,
+              ConvolutionBorder border, Uint8 border_value) {
+    if (!valid_filter_images(src, dst) || radius < 0 || radius > CONVOLUTION_MAX_RADIUS) {
+        return false;
+    }
+
+    Uint8* constant_row = (border == CONVOLUTION_BORDER_CONSTANT) ? malloc((size_t)src->width) : NULL;
+    if ((border == CONVOLUTION_BORDER_CONSTANT && !constant_row) || !init_filtered_image(src, dst)) {
+        free(constant_row);
+        return false;
+    }
+    if (constant_row) {
+        memset(constant_row, border_value, (size_t)src->width);
+    }
+
+    // Exact rounded division by the area for every sum up to 255 * area
+    Uint32 area = (Uint32)(2 * radius + 1) * (Uint32)(2 * radius + 1);
+
+    BoxJob job;
+    job.src = src;
+    job.dst = dst;
+    job.radius = radius;
+    job.reciprocal = ((Uint64)1 << BOX_RECIPROCAL_SHIFT) / area + 1;
+    job.border = border;
+    job.border_value = border_value;
+    job.constant_row = constant_row;
+    SDL_AtomicSet(&job.failed, 0);
+
+    PROFILE_START(filter_start);
+    thread_pool_run_bands(get_analysis_pool(), src->height, box_band, &job);
+    PROFILE_STOP(PROFILE_STAGE_FILTER, filter_start, src->data_size);
+
+    free(constant_row);
+    if (SDL_AtomicGet(&job.failed)) {
+        free_grayscale_image(dst);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,103 @@
+#ifndef CONVOLUTION_H
+#define CONVOLUTION_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include "image_analysis.h"
+
+// Largest kernel radius (taps = 2 * radius + 1)
+#define CONVOLUTION_MAX_RADIUS 64
+
+// Kernel weights are fixed point with this many fraction bits (1.0 = 16384)
+#define CONVOLUTION_WEIGHT_BITS 14
+
+// Gaussian kernels extend to this many standard deviations
+#define CONVOLUTION_GAUSSIAN_EXTENT 3.0
+
+// How pixels outside the image are read
+typedef enum {
+    CONVOLUTION_BORDER_CLAMP = 0,   // Repeat the edge pixel (aaa|abcd|ddd)
+    CONVOLUTION_BORDER_MIRROR,      // Reflect around the edge pixel (cb|abcd|cb)
+    CONVOLUTION_BORDER_WRAP,        // Tile the image (cd|abcd|ab)
+    CONVOLUTION_BORDER_CONSTANT     // Use a fixed value (vv|abcd|vv)
+} ConvolutionBorder;
+
+// One-dimensional kernel of a separable filter
+typedef struct {
+    int radius;                                         // Taps run from -radius to +radius
+    Sint16 weights[2 * CONVOLUTION_MAX_RADIUS + 1];    // Fixed-point weights, weights[radius] is the center
+} ConvolutionKernel;
+
+/**
+ * Build a kernel from floating point weights
+ * Weights are rounded to fixed point; the center absorbs the rounding so the
+ * fixed-point sum matches the rounded sum of the weights (exactly 1.0 for a
+ * normalized kernel). The absolute weights may add up to at most 2.0, which
+ * covers smoothing and mild sharpening/derivative kernels
+ * @param kernel Kernel to fill
+ * @param weights 2 * radius + 1 weights, center in the middle
+ * @param radius Kernel radius (0 to CONVOLUTION_MAX_RADIUS)
+ * @return true on success, false if the radius or weights are out of range
+ */
+bool make_convolution_kernel(ConvolutionKernel* kernel, const float* weights, int radius);
+
+/**
+ * Build a normalized Gaussian kernel
+ * @param kernel Kernel to fill
+ * @param sigma Standard deviation in pixels (radius = ceil(3 * sigma))
+ * @return true on success, false if sigma is not positive or too large
+ */
+bool make_gaussian_kernel(ConvolutionKernel* kernel, double sigma);
+
+/**
+ * Convolve an image with a separable filter (row kernel, then column kernel)
+ * Rows are filtered into 16-bit fixed-point intermediates kept in a small
+ * per-band ring of rows, so the image is read once; inner loops use SSE2/AVX2
+ * when available. Rows are split in bands over the analysis thread pool
+ * @param src Source image
+ * @param dst Pointer to store the filtered image (free with free_grayscale_image)
+ * @param row_kernel Horizontal kernel
+ * @param column_kernel Vertical kernel
+ * @param border Border handling
+ * @param border_value Value outside the image for CONVOLUTION_BORDER_CONSTANT
+ * @return true on success, false on failure
+ */
+bool convolve_separable(const GrayscaleImage* src, GrayscaleImage* dst,
+                        const ConvolutionKernel* row_kernel, const ConvolutionKernel* column_kernel,
+                        ConvolutionBorder border, Uint8 border_value);
+
+/**
+ * Gaussian blur (separable convolution with make_gaussian_kernel)
+ * @param src Source image
+ * @param dst Pointer to store the blurred image
+ * @param sigma Standard deviation in pixels
+ * @param border Border handling
+ * @param border_value Value outside the image for CONVOLUTION_BORDER_CONSTANT
+ * @return true on success, false on failure
+ */
+bool gaussian_blur(const GrayscaleImage* src, GrayscaleImage* dst, double sigma,
+                   ConvolutionBorder border, Uint8 border_value);
+
+/**
+ * Box blur (mean of the (2 * radius + 1)^2 neighborhood)
+ * Uses running sums along rows and columns, so the cost per pixel does not
+ * depend on the radius
+ * @param src Source image
+ * @param dst Pointer to store the blurred image
+ * @param radius Neighborhood radius (0 to CONVOLUTION_MAX_RADIUS)
+ * @param border Border handling
+ * @param border_value Value outside the image for CONVOLUTION_BORDER_CONSTANT
+ * @return true on success, false on failure
+ */
+bool box_blur(const GrayscaleImage* src, GrayscaleImage* dst, int radius,
+              ConvolutionBorder border, Uint8 border_value);
+
+/**
+ * Parse a border mode name ("clamp", "mirror", "wrap" or "constant")
+ * @param name Mode name
+ * @param border Pointer to store the mode
+ * @return true if the name is known
+ */
+bool parse_convolution_border(const char* name, ConvolutionBorder* border);
+
+#endif // CONVOLUTION_H
@@ -0,0 +1,41 @@
+#include "cpu_features.h"
+
+// -1 until detected; detection gives the same answer on every thread, so a
+// race only repeats it
+static int g_supported = -1;
+static int g_limit = CPU_ISA_AVX2;
+
+CpuIsa get_cpu_isa_supported(void) {
+    if (g_supported < 0) {
+        int detected = CPU_ISA_SCALAR;
+#ifdef CPU_FEATURES_X86
+        if (SDL_HasAVX2()) {
+            detected = CPU_ISA_AVX2;
+        } else if (SDL_HasSSE2()) {
+            detected = CPU_ISA_SSE2;
+        }
+#endif
+        g_supported = detected;
+    }
+    return (CpuIsa)g_supported;
+}
+
+CpuIsa get_cpu_isa(void) {
+    CpuIsa supported = get_cpu_isa_supported();
+    return (int)supported < g_limit ? supported : (CpuIsa)g_limit;
+}
+
+void set_cpu_isa_limit(CpuIsa limit) {
+    g_limit = limit < CPU_ISA_SCALAR ? CPU_ISA_SCALAR : limit > CPU_ISA_AVX2 ? CPU_ISA_AVX2 : limit;
+}
+
+const char* get_cpu_isa_name(CpuIsa isa) {
+    switch (isa) {
+        case CPU_ISA_AVX2:
+            return "avx2";
+        case CPU_ISA_SSE2:
+            return "sse2";
+        default:
+            return "scalar";
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+#include <SDL2/SDL.h>
+
+// Vector kernels are compiled for x86 with GCC/Clang target attributes, so
+// one binary carries every variant and picks one at run time
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define CPU_FEATURES_X86 1
+#include <immintrin.h>
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// Instruction sets the kernels are specialized for, in increasing order
+typedef enum {
+    CPU_ISA_SCALAR = 0,
+    CPU_ISA_SSE2,
+    CPU_ISA_AVX2
+} CpuIsa;
+
+/**
+ * Get the widest instruction set to use for kernels
+ * Detected on the first call (SSE2/AVX2 on x86 builds, scalar elsewhere) and
+ * capped by set_cpu_isa_limit
+ * @return Instruction set
+ */
+CpuIsa get_cpu_isa(void);
+
+/**
+ * Cap the instruction set returned by get_cpu_isa (e.g. to compare kernels)
+ * Kernels are picked when a pass starts, so call it between passes, not
+ * while other threads run one
+ * @param limit Widest instruction set allowed (CPU_ISA_AVX2 for no cap)
+ */
+void set_cpu_isa_limit(CpuIsa limit);
+
+/**
+ * Get the widest instruction set the CPU supports, ignoring the limit
+ * @return Instruction set
+ */
+CpuIsa get_cpu_isa_supported(void);
+
+/**
+ * Get the name of an instruction set
+ * @param isa Instruction set
+ * @return "avx2", "sse2" or "scalar"
+ */
+const char* get_cpu_isa_name(CpuIsa isa);
+
+#endif // CPU_FEATURES_H
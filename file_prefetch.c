@@ -0,0 +1,349 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "file_prefetch.h"
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+struct FilePrefetcher {
+    const char* const* paths;
+    int count;
+    int depth;
+    BufferPool* pool;
+
+    // Files read and not yet returned, in list order (ring of depth slots)
+    PrefetchedFile* ready;
+    int head;
+    int ready_count;
+    bool finished;          // The reader went through the whole list
+    bool stopping;          // Destroy asked the reader to stop
+
+    SDL_mutex* mutex;
+    SDL_cond* changed;      // Signaled when ready_count, finished or stopping change
+    SDL_Thread* thread;
+};
+
+// ---------------------------------------------------------------------------
+// Reading
+// ---------------------------------------------------------------------------
+
+// Replace *buffer by a twice larger one keeping the first size bytes
+static bool grow_buffer(BufferPool* pool, Uint8** buffer, size_t* capacity, size_t size) {
+    if (*capacity > SIZE_MAX / 2) {
+        return false;
+    }
+
+    Uint8* larger = buffer_pool_acquire(pool, *capacity * 2);
+    if (!larger) {
+        return false;
+    }
+
+    memcpy(larger, *buffer, size);
+    buffer_pool_release(pool, *buffer);
+    *buffer = larger;
+    *capacity = buffer_pool_get_capacity(larger);
+    return true;
+}
+
+#ifdef _WIN32
+
+typedef FILE* FileHandle;
+
+static bool open_for_reading(const char* path, FileHandle* handle, size_t* expected_size) {
+    *handle = fopen(path, "rb");
+    if (!*handle) {
+        return false;
+    }
+
+    // Reads are already large, stdio buffering would only add a copy
+    setvbuf(*handle, NULL, _IONBF, 0);
+
+    *expected_size = 0;
+    if (fseek(*handle, 0, SEEK_END) == 0) {
+        long end = ftell(*handle);
+        if (end > 0) {
+            *expected_size = (size_t)end;
+        }
+    }
+    rewind(*handle);
+    return true;
+}
+
+static long read_chunk(FileHandle handle, Uint8* destination, size_t size) {
+    size_t read = fread(destination, 1, size, handle);
+    if (read == 0 && ferror(handle)) {
+        errno = EIO;
+        return -1;
+    }
+    return (long)read;
+}
+
+static void close_file(FileHandle handle) {
+    fclose(handle);
+}
+
+static void hint_will_need(const char* path) {
+    (void)path;
+}
+
+#else
+
+typedef int FileHandle;
+
+static bool open_for_reading(const char* path, FileHandle* handle, size_t* expected_size) {
+    *handle = open(path, O_RDONLY);
+    if (*handle < 0) {
+        return false;
+    }
+
+    struct stat st;
+    *expected_size = 0;
+    if (fstat(*handle, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 &&
+        (Uint64)st.st_size <= (Uint64)SIZE_MAX) {
+        *expected_size = (size_t)st.st_size;
+    }
+
+#ifdef POSIX_FADV_SEQUENTIAL
+    // Larger kernel readahead window for the front-to-back read
+    posix_fadvise(*handle, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    return true;
+}
+
+static long read_chunk(FileHandle handle, Uint8* destination, size_t size) {
+    ssize_t read_bytes;
+    do {
+        read_bytes = read(handle, destination, size);
+    } while (read_bytes < 0 && errno == EINTR);
+    return (long)read_bytes;
+}
+
+static void close_file(FileHandle handle) {
+    close(handle);
+}
+
+// Ask the kernel to start reading a whole file in the background
+static void hint_will_need(const char* path) {
+#ifdef POSIX_FADV_WILLNEED
+    int fd = open(path, O_RDONLY);
+    if (fd >= 0) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+        close(fd);
+    }
+#else
+    (void)path;
+#endif
+}
+
+#endif
+
+bool read_file_to_buffer(BufferPool* pool, const char* path, PrefetchedFile* file) {
+    if (!file) {
+        return false;
+    }
+
+    memset(file, 0, sizeof(PrefetchedFile));
+    file->path = path;
+    if (!pool || !path) {
+        file->error = EINVAL;
+        return false;
+    }
+
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    FileHandle handle;
+    size_t expected_size;
+    if (!open_for_reading(path, &handle, &expected_size)) {
+        file->error = errno ? errno : ENOENT;
+        file->read_ticks = SDL_GetPerformanceCounter() - start;
+        return false;
+    }
+
+    // Sized from the file so a regular file is read with no reallocation;
+    // other files (pipes, devices) grow as they go
+    size_t capacity = expected_size > 0 ? expected_size : FILE_PREFETCH_READ_CHUNK;
+    Uint8* buffer = buffer_pool_acquire(pool, capacity);
+    size_t size = 0;
+    int error = buffer ? 0 : ENOMEM;
+    if (buffer) {
+        capacity = buffer_pool_get_capacity(buffer);
+    }
+
+    while (!error && (expected_size == 0 || size < expected_size)) {
+        if (size == capacity && !grow_buffer(pool, &buffer, &capacity, size)) {
+            error = ENOMEM;
+            break;
+        }
+
+        size_t request = capacity - size < FILE_PREFETCH_READ_CHUNK ? capacity - size : FILE_PREFETCH_READ_CHUNK;
+        long read_bytes = read_chunk(handle, buffer + size, request);
+        if (read_bytes < 0) {
+            error = errno ? errno : EIO;
+        } else if (read_bytes == 0) {
+            break;
+        } else {
+            size += (size_t)read_bytes;
+        }
+    }
+    close_file(handle);
+
+    file->read_ticks = SDL_GetPerformanceCounter() - start;
+    if (error) {
+        buffer_pool_release(pool, buffer);
+        file->error = error;
+        return false;
+    }
+
+    file->data = buffer;
+    file->size = size;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Prefetcher
+// ---------------------------------------------------------------------------
+
+static int reader_main(void* data) {
+    FilePrefetcher* prefetcher = (FilePrefetcher*)data;
+    int hinted = 0;
+
+    for (int i = 0; i < prefetcher->count; i++) {
+        SDL_LockMutex(prefetcher->mutex);
+        while (prefetcher->ready_count == prefetcher->depth && !prefetcher->stopping) {
+            SDL_CondWait(prefetcher->changed, prefetcher->mutex);
+        }
+        bool stopping = prefetcher->stopping;
+        SDL_UnlockMutex(prefetcher->mutex);
+        if (stopping) {
+            break;
+        }
+
+        // Keep the kernel working on the files that will be read next while
+        // this one is read (file i itself was hinted earlier, except the first)
+        int hint_end = i + prefetcher->depth < prefetcher->count ? i + prefetcher->depth : prefetcher->count;
+        for (hinted = hinted > i + 1 ? hinted : i + 1; hinted < hint_end; hinted++) {
+            hint_will_need(prefetcher->paths[hinted]);
+        }
+
+        PrefetchedFile file;
+        read_file_to_buffer(prefetcher->pool, prefetcher->paths[i], &file);
+
+        SDL_LockMutex(prefetcher->mutex);
+        prefetcher->ready[(prefetcher->head + prefetcher->ready_count) % prefetcher->depth] = file;
+        prefetcher->ready_count++;
+        SDL_CondBroadcast(prefetcher->changed);
+        SDL_UnlockMutex(prefetcher->mutex);
+    }
+
+    SDL_LockMutex(prefetcher->mutex);
+    prefetcher->finished = true;
+    SDL_CondBroadcast(prefetcher->changed);
+    SDL_UnlockMutex(prefetcher->mutex);
+    return 0;
+}
+
+FilePrefetcher* file_prefetcher_create(const char* const* paths, int count, int depth) {
+    if ((!paths && count > 0) || count < 0 || depth < 0) {
+        fprintf(stderr, "Invalid parameters passed to file_prefetcher_create\n");
+        return NULL;
+    }
+
+    FilePrefetcher* prefetcher = calloc(1, sizeof(FilePrefetcher));
+    if (!prefetcher) {
+        return NULL;
+    }
+
+    prefetcher->paths = paths;
+    prefetcher->count = count;
+    prefetcher->depth = depth > 0 ? depth : FILE_PREFETCH_DEFAULT_DEPTH;
+    prefetcher->ready = calloc((size_t)prefetcher->depth, sizeof(PrefetchedFile));
+    prefetcher->pool = buffer_pool_create(0);
+    prefetcher->mutex = SDL_CreateMutex();
+    prefetcher->changed = SDL_CreateCond();
+
+    if (!prefetcher->ready || !prefetcher->pool || !prefetcher->mutex || !prefetcher->changed) {
+        file_prefetcher_destroy(prefetcher);
+        return NULL;
+    }
+
+    prefetcher->thread = SDL_CreateThread(reader_main, "file_prefetch", prefetcher);
+    if (!prefetcher->thread) {
+        fprintf(stderr, "Could not create prefetch thread: %s\n", SDL_GetError());
+        file_prefetcher_destroy(prefetcher);
+        return NULL;
+    }
+
+    return prefetcher;
+}
+
+bool file_prefetcher_next(FilePrefetcher* prefetcher, PrefetchedFile* file) {
+    if (!prefetcher || !file) {
+        return false;
+    }
+
+    SDL_LockMutex(prefetcher->mutex);
+    while (prefetcher->ready_count == 0 && !prefetcher->finished) {
+        SDL_CondWait(prefetcher->changed, prefetcher->mutex);
+    }
+
+    bool available = prefetcher->ready_count > 0;
+    if (available) {
+        *file = prefetcher->ready[prefetcher->head];
+        prefetcher->head = (prefetcher->head + 1) % prefetcher->depth;
+        prefetcher->ready_count--;
+        SDL_CondBroadcast(prefetcher->changed);
+    }
+    SDL_UnlockMutex(prefetcher->mutex);
+
+    return available;
+}
+
+void file_prefetcher_release(FilePrefetcher* prefetcher, PrefetchedFile* file) {
+    if (!prefetcher || !file) {
+        return;
+    }
+
+    buffer_pool_release(prefetcher->pool, file->data);
+    file->data = NULL;
+    file->size = 0;
+}
+
+void file_prefetcher_destroy(FilePrefetcher* prefetcher) {
+    if (!prefetcher) {
+        return;
+    }
+
+    if (prefetcher->thread) {
+        SDL_LockMutex(prefetcher->mutex);
+        prefetcher->stopping = true;
+        SDL_CondBroadcast(prefetcher->changed);
+        SDL_UnlockMutex(prefetcher->mutex);
+        SDL_WaitThread(prefetcher->thread, NULL);
+    }
+
+    // Files read but never returned
+    for (int i = 0; i < prefetcher->ready_count; i++) {
+        PrefetchedFile* file = &prefetcher->ready[(prefetcher->head + i) % prefetcher->depth];
+        buffer_pool_release(prefetcher->pool, file->data);
+    }
+
+    if (prefetcher->changed) {
+        SDL_DestroyCond(prefetcher->changed);
+    }
+    if (prefetcher->mutex) {
+        SDL_DestroyMutex(prefetcher->mutex);
+    }
+    buffer_pool_destroy(prefetcher->pool);
+    free(prefetcher->ready);
+    free(prefetcher);
+}
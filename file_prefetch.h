@@ -0,0 +1,76 @@
+#ifndef FILE_PREFETCH_H
+#define FILE_PREFETCH_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "buffer_pool.h"
+
+// Default number of files read ahead of the consumer
+#define FILE_PREFETCH_DEFAULT_DEPTH 4
+
+// Bytes requested per read call (large sequential reads keep network and
+// spinning volumes streaming instead of paying a round trip per small block)
+#define FILE_PREFETCH_READ_CHUNK ((size_t)4 * 1024 * 1024)
+
+// Whole contents of one file
+typedef struct {
+    const char* path;       // Path as given (not copied)
+    Uint8* data;            // Contents, from the reader's buffer pool (NULL on error)
+    size_t size;            // Bytes in data
+    int error;              // 0 on success, errno value of the failed open/read
+    Uint64 read_ticks;      // Performance counter ticks spent opening and reading
+} PrefetchedFile;
+
+typedef struct FilePrefetcher FilePrefetcher;
+
+/**
+ * Read a whole file with large sequential reads
+ * @param pool Pool the buffer is taken from
+ * @param path File to read
+ * @param file Pointer to store the contents (release with buffer_pool_release)
+ * @return true on success, false if the file cannot be opened or read (file->error)
+ */
+bool read_file_to_buffer(BufferPool* pool, const char* path, PrefetchedFile* file);
+
+/**
+ * Start reading a list of files in order on a background thread
+ *
+ * The reader stays at most depth files ahead of file_prefetcher_next, so
+ * memory is bounded whatever the list size; buffers come from a pool of the
+ * prefetcher and are reused once released. Where posix_fadvise exists, the
+ * kernel is also asked to start reading the files queued after the one being
+ * read (POSIX_FADV_WILLNEED), so several reads are in flight on volumes with
+ * high latency
+ *
+ * @param paths Files to read (must stay valid until the prefetcher is destroyed)
+ * @param count Number of files
+ * @param depth Files read ahead (0 = FILE_PREFETCH_DEFAULT_DEPTH)
+ * @return New prefetcher, or NULL on failure
+ */
+FilePrefetcher* file_prefetcher_create(const char* const* paths, int count, int depth);
+
+/**
+ * Get the next file of the list, waiting for it to be read if needed
+ * Files come back in list order, including the ones that failed (file->error)
+ * @param prefetcher File prefetcher
+ * @param file Pointer to store the file (give back with file_prefetcher_release)
+ * @return true if a file was returned, false once the list is exhausted
+ */
+bool file_prefetcher_next(FilePrefetcher* prefetcher, PrefetchedFile* file);
+
+/**
+ * Give a file's buffer back for reuse
+ * @param prefetcher Prefetcher that returned the file
+ * @param file File from file_prefetcher_next
+ */
+void file_prefetcher_release(FilePrefetcher* prefetcher, PrefetchedFile* file);
+
+/**
+ * Stop reading and free the prefetcher
+ * Files not yet returned are discarded; returned files must be released first
+ * @param prefetcher Prefetcher to destroy (may be NULL)
+ */
+void file_prefetcher_destroy(FilePrefetcher* prefetcher);
+
+#endif // FILE_PREFETCH_H
@@ -0,0 +1,195 @@
+#include "gray_loader.h"
+#include "profiler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <jpeglib.h>
+
+// Scanlines requested from libjpeg per call
+#define JPEG_ROWS_PER_READ 16
+
+typedef struct {
+    struct jpeg_error_mgr pub;
+    jmp_buf jump;
+} JpegErrorManager;
+
+static void jpeg_error_exit(j_common_ptr cinfo) {
+    JpegErrorManager* error = (JpegErrorManager*)cinfo->err;
+    char message[JMSG_LENGTH_MAX];
+
+    (*cinfo->err->format_message)(cinfo, message);
+    fprintf(stderr, "Erro JPEG: %s\n", message);
+    longjmp(error->jump, 1);
+}
+
+static bool has_jpeg_signature(FILE* file) {
+    unsigned char header[3];
+    size_t read = fread(header, 1, sizeof(header), file);
+    rewind(file);
+    return read == sizeof(header) && header[0] == 0xFF && header[1] == 0xD8 && header[2] == 0xFF;
+}
+
+bool is_jpeg_file(const char* filename) {
+    FILE* file = filename ? fopen(filename, "rb") : NULL;
+    if (!file) {
+        return false;
+    }
+
+    bool jpeg = has_jpeg_signature(file);
+    fclose(file);
+    return jpeg;
+}
+
+// Decode the luminance of a JPEG into grayscale_image; *fallback is set when
+// the color space has no Y channel to read (CMYK, YCCK)
+static ImageLoadError decode_jpeg_luma(FILE* file, const char* filename, int scale,
+                                       GrayscaleImage* grayscale_image, bool* fallback) {
+    struct jpeg_decompress_struct jpeg;
+    JpegErrorManager jpeg_error;
+
+    memset(&jpeg, 0, sizeof(jpeg));
+    memset(grayscale_image, 0, sizeof(GrayscaleImage));
+    *fallback = false;
+
+    jpeg.err = jpeg_std_error(&jpeg_error.pub);
+    jpeg_error.pub.error_exit = jpeg_error_exit;
+    if (setjmp(jpeg_error.jump)) {
+        jpeg_destroy_decompress(&jpeg);
+        free_grayscale_image(grayscale_image);
+        return IMG_ERROR_INVALID_FORMAT;
+    }
+
+    jpeg_create_decompress(&jpeg);
+    jpeg_stdio_src(&jpeg, file);
+    jpeg_read_header(&jpeg, TRUE);
+
+    if (jpeg.jpeg_color_space != JCS_GRAYSCALE && jpeg.jpeg_color_space != JCS_YCbCr) {
+        jpeg_destroy_decompress(&jpeg);
+        *fallback = true;
+        return IMG_ERROR_INVALID_FORMAT;
+    }
+
+    // Only the Y component is decoded; the scale picks a reduced IDCT size
+    jpeg.out_color_space = JCS_GRAYSCALE;
+    jpeg.scale_num = 1;
+    jpeg.scale_denom = (unsigned int)scale;
+    jpeg_start_decompress(&jpeg);
+
+    int width = (int)jpeg.output_width;
+    int height = (int)jpeg.output_height;
+    if (!create_grayscale_image(grayscale_image, width, height, filename)) {
+        jpeg_destroy_decompress(&jpeg);
+        return IMG_ERROR_MEMORY_ALLOCATION;
+    }
+
+    // Scanlines go straight into the image rows
+    while (jpeg.output_scanline < jpeg.output_height) {
+        JSAMPROW rows[JPEG_ROWS_PER_READ];
+        int first = (int)jpeg.output_scanline;
+        int count = height - first < JPEG_ROWS_PER_READ ? height - first : JPEG_ROWS_PER_READ;
+        for (int i = 0; i < count; i++) {
+            rows[i] = grayscale_image->pixels + (size_t)(first + i) * width;
+        }
+        jpeg_read_scanlines(&jpeg, rows, (JDIMENSION)count);
+    }
+
+    jpeg_finish_decompress(&jpeg);
+    jpeg_destroy_decompress(&jpeg);
+    return IMG_SUCCESS;
+}
+
+// Average scale x scale blocks (partial blocks on the right/bottom edges
+// average the pixels they have)
+static bool downscale_box(const GrayscaleImage* src, int scale, GrayscaleImage* dst) {
+    int width = (src->width + scale - 1) / scale;
+    int height = (src->height + scale - 1) / scale;
+    Uint32* sums = calloc((size_t)width, sizeof(Uint32));
+    if (!sums || !create_grayscale_image(dst, width, height, src->source_filename)) {
+        free(sums);
+        return false;
+    }
+
+    for (int y = 0; y < height; y++) {
+        int row_begin = y * scale;
+        int rows = src->height - row_begin < scale ? src->height - row_begin : scale;
+
+        memset(sums, 0, (size_t)width * sizeof(Uint32));
+        for (int r = 0; r < rows; r++) {
+            const Uint8* row = src->pixels + (size_t)(row_begin + r) * src->width;
+            for (int x = 0; x < src->width; x++) {
+                sums[x / scale] += row[x];
+            }
+        }
+
+        Uint8* out = dst->pixels + (size_t)y * width;
+        for (int x = 0; x < width; x++) {
+            int columns = src->width - x * scale < scale ? src->width - x * scale : scale;
+            Uint32 count = (Uint32)(rows * columns);
+            out[x] = (Uint8)((sums[x] + count / 2) / count);
+        }
+    }
+
+    free(sums);
+    return true;
+}
+
+// Load through SDL_image and the luminance formula
+static ImageLoadError load_converted(const char* filename, int scale, GrayscaleImage* grayscale_image) {
+    ImageData image;
+    ImageLoadError result = load_image(filename, &image);
+    if (result != IMG_SUCCESS) {
+        return result;
+    }
+
+    GrayscaleImage full;
+    bool converted = get_grayscale_image(&image, &full);
+    free_image_data(&image);
+    if (!converted) {
+        return IMG_ERROR_MEMORY_ALLOCATION;
+    }
+
+    if (scale == 1) {
+        *grayscale_image = full;
+        return IMG_SUCCESS;
+    }
+
+    bool scaled = downscale_box(&full, scale, grayscale_image);
+    free_grayscale_image(&full);
+    return scaled ? IMG_SUCCESS : IMG_ERROR_MEMORY_ALLOCATION;
+}
+
+ImageLoadError load_grayscale_image(const char* filename, int scale, GrayscaleImage* grayscale_image, bool* used_luma) {
+    if (!filename || !grayscale_image || (scale != 1 && scale != 2 && scale != 4 && scale != 8)) {
+        fprintf(stderr, "Invalid parameters passed to load_grayscale_image\n");
+        return IMG_ERROR_UNKNOWN;
+    }
+
+    memset(grayscale_image, 0, sizeof(GrayscaleImage));
+    if (used_luma) {
+        *used_luma = false;
+    }
+
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        fprintf(stderr, "File not found: %s\n", filename);
+        return IMG_ERROR_FILE_NOT_FOUND;
+    }
+
+    if (has_jpeg_signature(file)) {
+        bool fallback;
+        PROFILE_START(decode_start);
+        ImageLoadError result = decode_jpeg_luma(file, filename, scale, grayscale_image, &fallback);
+        PROFILE_STOP(PROFILE_STAGE_DECODE, decode_start, grayscale_image->data_size);
+        if (!fallback) {
+            fclose(file);
+            if (used_luma) {
+                *used_luma = (result == IMG_SUCCESS);
+            }
+            return result;
+        }
+    }
+
+    fclose(file);
+    return load_converted(filename, scale, grayscale_image);
+}
@@ -0,0 +1,44 @@
+#ifndef GRAY_LOADER_H
+#define GRAY_LOADER_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include "image_loader.h"
+#include "image_analysis.h"
+
+// Largest downscale factor of load_grayscale_image (1, 2, 4 or 8)
+#define GRAY_LOAD_MAX_SCALE 8
+
+/**
+ * Check whether a file starts with the JPEG signature
+ * @param filename Path to check
+ * @return true if the file looks like a JPEG
+ */
+bool is_jpeg_file(const char* filename);
+
+/**
+ * Load an image straight to grayscale, optionally downscaled
+ *
+ * Baseline/progressive JPEGs (YCbCr or grayscale) are decoded by libjpeg
+ * with its luminance output: the Y channel stored in the file is used as is,
+ * so chroma upsampling and color conversion are skipped, and downscaling is
+ * done in the DCT domain (1/2, 1/4 or 1/8 of the coefficients are inverse
+ * transformed). Other formats, and CMYK JPEGs, go through load_image and
+ * convert_to_grayscale, then a box average for downscaling.
+ *
+ * The JPEG Y channel is the JFIF (BT.601) luma, Y = 0.299 R + 0.587 G +
+ * 0.114 B of the gamma-encoded values, while convert_to_grayscale uses
+ * 0.2125 R + 0.7154 G + 0.0721 B (BT.709 weights). Grays are identical;
+ * saturated reds and blues come out brighter and greens darker than with
+ * convert_to_grayscale (pure red 76 vs 54, green 150 vs 182, blue 29 vs 18),
+ * and small differences come from the encoder's own rounding
+ *
+ * @param filename Path to the image file
+ * @param scale Downscale factor (1, 2, 4 or 8); sizes round up
+ * @param grayscale_image Pointer to store the result (free with free_grayscale_image)
+ * @param used_luma Optional pointer set to true if the JPEG luminance path was used
+ * @return ImageLoadError code indicating success or type of error
+ */
+ImageLoadError load_grayscale_image(const char* filename, int scale, GrayscaleImage* grayscale_image, bool* used_luma);
+
+#endif // GRAY_LOADER_H
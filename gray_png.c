@@ -0,0 +1,559 @@
+#include "gray_png.h"
+#include "image_analysis.h"
+#include "thread_pool.h"
+#include <png.h>
+#include <zlib.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Rows handed to libpng per call when writing a whole buffer
+#define GRAY_PNG_ROW_BATCH 64
+
+// Deflate window: the history each parallel band is primed with
+#define GRAY_PNG_WINDOW_SIZE 32768
+
+static GrayPngOptions g_options = { -1, GRAY_PNG_FILTER_ADAPTIVE, GRAY_PNG_STRATEGY_DEFAULT, false };
+
+void gray_png_default_options(GrayPngOptions* options) {
+    if (!options) {
+        return;
+    }
+
+    options->compression_level = -1;
+    options->filter = GRAY_PNG_FILTER_ADAPTIVE;
+    options->strategy = GRAY_PNG_STRATEGY_DEFAULT;
+    options->parallel = false;
+}
+
+void gray_png_fast_options(GrayPngOptions* options) {
+    if (!options) {
+        return;
+    }
+
+    options->compression_level = 1;
+    options->filter = GRAY_PNG_FILTER_PAETH;
+    options->strategy = GRAY_PNG_STRATEGY_RLE;
+    options->parallel = true;
+}
+
+static bool valid_options(const GrayPngOptions* options) {
+    return options->compression_level >= -1 && options->compression_level <= 9 &&
+           options->filter >= GRAY_PNG_FILTER_ADAPTIVE && options->filter <= GRAY_PNG_FILTER_PAETH &&
+           options->strategy >= GRAY_PNG_STRATEGY_DEFAULT && options->strategy <= GRAY_PNG_STRATEGY_RLE;
+}
+
+bool set_png_encode_options(const GrayPngOptions* options) {
+    if (!options) {
+        gray_png_default_options(&g_options);
+        return true;
+    }
+
+    if (!valid_options(options)) {
+        fprintf(stderr, "Invalid PNG encode options\n");
+        return false;
+    }
+    g_options = *options;
+    return true;
+}
+
+void get_png_encode_options(GrayPngOptions* options) {
+    if (options) {
+        *options = g_options;
+    }
+}
+
+bool parse_png_filter(const char* name, GrayPngFilter* filter) {
+    static const char* names[] = { "adaptive", "none", "sub", "up", "average", "paeth" };
+
+    if (!name || !filter) {
+        return false;
+    }
+
+    for (int i = 0; i < (int)(sizeof(names) / sizeof(names[0])); i++) {
+        if (strcmp(name, names[i]) == 0) {
+            *filter = (GrayPngFilter)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static int zlib_level(const GrayPngOptions* options) {
+    return options->compression_level < 0 ? Z_DEFAULT_COMPRESSION : options->compression_level;
+}
+
+static int zlib_strategy(const GrayPngOptions* options) {
+    switch (options->strategy) {
+        case GRAY_PNG_STRATEGY_FILTERED:
+            return Z_FILTERED;
+        case GRAY_PNG_STRATEGY_HUFFMAN_ONLY:
+            return Z_HUFFMAN_ONLY;
+        case GRAY_PNG_STRATEGY_RLE:
+            return Z_RLE;
+        case GRAY_PNG_STRATEGY_DEFAULT:
+        default:
+            return options->filter == GRAY_PNG_FILTER_NONE ? Z_DEFAULT_STRATEGY : Z_FILTERED;
+    }
+}
+
+static int libpng_filter_mask(GrayPngFilter filter) {
+    switch (filter) {
+        case GRAY_PNG_FILTER_NONE:
+            return PNG_FILTER_NONE;
+        case GRAY_PNG_FILTER_SUB:
+            return PNG_FILTER_SUB;
+        case GRAY_PNG_FILTER_UP:
+            return PNG_FILTER_UP;
+        case GRAY_PNG_FILTER_AVERAGE:
+            return PNG_FILTER_AVG;
+        case GRAY_PNG_FILTER_PAETH:
+            return PNG_FILTER_PAETH;
+        case GRAY_PNG_FILTER_ADAPTIVE:
+        default:
+            return PNG_ALL_FILTERS;
+    }
+}
+
+struct GrayPngWriter {
+    FILE* file;
+    png_structp png;
+    png_infop png_info;
+};
+
+void gray_png_close(GrayPngWriter* writer) {
+    if (!writer) {
+        return;
+    }
+
+    if (writer->png) {
+        png_destroy_write_struct(&writer->png, writer->png_info ? &writer->png_info : NULL);
+    }
+    if (writer->file) {
+        fclose(writer->file);
+    }
+    free(writer);
+}
+
+static bool write_header(GrayPngWriter* writer, int width, int height, const GrayPngOptions* options) {
+    if (setjmp(png_jmpbuf(writer->png))) {
+        return false;
+    }
+
+    png_init_io(writer->png, writer->file);
+    png_set_compression_level(writer->png, zlib_level(options));
+    png_set_compression_strategy(writer->png, zlib_strategy(options));
+    png_set_filter(writer->png, PNG_FILTER_TYPE_BASE, libpng_filter_mask(options->filter));
+    png_set_IHDR(writer->png, writer->png_info, (png_uint_32)width, (png_uint_32)height, 8,
+                 PNG_COLOR_TYPE_GRAY, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(writer->png, writer->png_info);
+    return true;
+}
+
+GrayPngWriter* gray_png_open(const char* filename, int width, int height) {
+    return gray_png_open_with_options(filename, width, height, &g_options);
+}
+
+GrayPngWriter* gray_png_open_with_options(const char* filename, int width, int height,
+                                          const GrayPngOptions* options) {
+    if (!filename || width <= 0 || height <= 0 || !options || !valid_options(options)) {
+        return NULL;
+    }
+
+    GrayPngWriter* writer = calloc(1, sizeof(GrayPngWriter));
+    if (!writer) {
+        return NULL;
+    }
+
+    writer->file = fopen(filename, "wb");
+    if (!writer->file) {
+        free(writer);
+        return NULL;
+    }
+
+    writer->png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    writer->png_info = writer->png ? png_create_info_struct(writer->png) : NULL;
+    if (!writer->png_info) {
+        gray_png_close(writer);
+        return NULL;
+    }
+
+    if (!write_header(writer, width, height, options)) {
+        gray_png_close(writer);
+        return NULL;
+    }
+    return writer;
+}
+
+bool gray_png_write_rows(GrayPngWriter* writer, Uint8** row_pointers, int rows) {
+    if (!writer || !row_pointers) {
+        return false;
+    }
+
+    if (setjmp(png_jmpbuf(writer->png))) {
+        return false;
+    }
+    png_write_rows(writer->png, row_pointers, (png_uint_32)rows);
+    return true;
+}
+
+bool gray_png_finish(GrayPngWriter* writer) {
+    if (!writer) {
+        return false;
+    }
+
+    if (setjmp(png_jmpbuf(writer->png))) {
+        return false;
+    }
+    png_write_end(writer->png, NULL);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Parallel encoding
+// ---------------------------------------------------------------------------
+
+static int paeth_predictor(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = abs(p - a);
+    int pb = abs(p - b);
+    int pc = abs(p - c);
+    if (pa <= pb && pa <= pc) {
+        return a;
+    }
+    return pb <= pc ? b : c;
+}
+
+// Apply one filter type (1 byte per pixel); previous is NULL on the first row
+static void filter_row(int type, const Uint8* row, const Uint8* previous, int width, Uint8* out) {
+    switch (type) {
+        case PNG_FILTER_VALUE_SUB:
+            out[0] = row[0];
+            for (int x = 1; x < width; x++) {
+                out[x] = (Uint8)(row[x] - row[x - 1]);
+            }
+            break;
+        case PNG_FILTER_VALUE_UP:
+            for (int x = 0; x < width; x++) {
+                out[x] = (Uint8)(row[x] - (previous ? previous[x] : 0));
+            }
+            break;
+        case PNG_FILTER_VALUE_AVG:
+            for (int x = 0; x < width; x++) {
+                int left = x > 0 ? row[x - 1] : 0;
+                int up = previous ? previous[x] : 0;
+                out[x] = (Uint8)(row[x] - ((left + up) >> 1));
+            }
+            break;
+        case PNG_FILTER_VALUE_PAETH:
+            for (int x = 0; x < width; x++) {
+                int left = x > 0 ? row[x - 1] : 0;
+                int up = previous ? previous[x] : 0;
+                int up_left = (x > 0 && previous) ? previous[x - 1] : 0;
+                out[x] = (Uint8)(row[x] - paeth_predictor(left, up, up_left));
+            }
+            break;
+        case PNG_FILTER_VALUE_NONE:
+        default:
+            memcpy(out, row, (size_t)width);
+            break;
+    }
+}
+
+// Sum of the filtered bytes taken as signed values, libpng's measure of how
+// well a filter did
+static Uint64 filtered_cost(const Uint8* bytes, int width) {
+    Uint64 sum = 0;
+    for (int x = 0; x < width; x++) {
+        sum += bytes[x] < 128 ? bytes[x] : 256 - bytes[x];
+    }
+    return sum;
+}
+
+// Write one row (filter type byte + filtered bytes) to out; scratch holds
+// width bytes for trying filters
+static void encode_row(GrayPngFilter filter, const Uint8* row, const Uint8* previous, int width,
+                       Uint8* out, Uint8* scratch) {
+    static const int fixed_types[] = {
+        PNG_FILTER_VALUE_NONE, PNG_FILTER_VALUE_NONE, PNG_FILTER_VALUE_SUB,
+        PNG_FILTER_VALUE_UP, PNG_FILTER_VALUE_AVG, PNG_FILTER_VALUE_PAETH
+    };
+
+    if (filter != GRAY_PNG_FILTER_ADAPTIVE) {
+        out[0] = (Uint8)fixed_types[filter];
+        filter_row(out[0], row, previous, width, out + 1);
+        return;
+    }
+
+    Uint64 best_cost = 0;
+    for (int type = PNG_FILTER_VALUE_NONE; type < PNG_FILTER_VALUE_LAST; type++) {
+        Uint8* candidate = type == PNG_FILTER_VALUE_NONE ? out + 1 : scratch;
+        filter_row(type, row, previous, width, candidate);
+        Uint64 cost = filtered_cost(candidate, width);
+        if (type == PNG_FILTER_VALUE_NONE || cost < best_cost) {
+            best_cost = cost;
+            out[0] = (Uint8)type;
+            if (candidate != out + 1) {
+                memcpy(out + 1, candidate, (size_t)width);
+            }
+        }
+    }
+}
+
+// Compressed output of one band
+typedef struct {
+    Uint8* data;
+    size_t size;
+    uLong adler;            // Adler-32 of the band's filtered bytes
+    uLong length;           // Filtered bytes in the band
+} PngBand;
+
+typedef struct {
+    const Uint8* pixels;
+    int width;
+    int height;
+    size_t stride;
+    const GrayPngOptions* options;
+    PngBand bands[THREAD_POOL_MAX_BANDS];
+    int band_count;
+    SDL_atomic_t failed;
+} PngEncodeJob;
+
+static void encode_rows(const PngEncodeJob* job, int row_begin, int row_end, Uint8* out, Uint8* scratch) {
+    size_t row_bytes = (size_t)job->width + 1;
+    for (int y = row_begin; y < row_end; y++) {
+        const Uint8* row = job->pixels + (size_t)y * job->stride;
+        const Uint8* previous = y > 0 ? row - job->stride : NULL;
+        encode_row(job->options->filter, row, previous, job->width, out + (size_t)(y - row_begin) * row_bytes, scratch);
+    }
+}
+
+static void encode_band(void* context, int band, int row_begin, int row_end) {
+    PngEncodeJob* job = (PngEncodeJob*)context;
+    PngBand* output = &job->bands[band];
+    size_t row_bytes = (size_t)job->width + 1;
+    bool last = (row_end == job->height);
+
+    // Rows before the band are filtered again (filters only look one row up)
+    // to rebuild the window the band's stream starts with
+    int history_rows = (int)((GRAY_PNG_WINDOW_SIZE + row_bytes - 1) / row_bytes);
+    int history_begin = row_begin - history_rows > 0 ? row_begin - history_rows : 0;
+    size_t history_size = (size_t)(row_begin - history_begin) * row_bytes;
+    size_t band_size = (size_t)(row_end - row_begin) * row_bytes;
+    if ((Uint64)band_size > 0xFFFFFFFFu) {
+        SDL_AtomicSet(&job->failed, 1);     // zlib takes 32-bit lengths
+        return;
+    }
+
+    Uint8* filtered = malloc(history_size + band_size);
+    Uint8* scratch = malloc((size_t)job->width);
+    if (!filtered || !scratch) {
+        free(filtered);
+        free(scratch);
+        SDL_AtomicSet(&job->failed, 1);
+        return;
+    }
+    encode_rows(job, history_begin, row_end, filtered, scratch);
+    free(scratch);
+
+    const Uint8* band_data = filtered + history_size;
+    output->length = (uLong)band_size;
+    output->adler = adler32(adler32(0L, Z_NULL, 0), band_data, (uInt)band_size);
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, zlib_level(job->options), Z_DEFLATED, -15, 8, zlib_strategy(job->options)) != Z_OK) {
+        free(filtered);
+        SDL_AtomicSet(&job->failed, 1);
+        return;
+    }
+
+    size_t window = history_size < GRAY_PNG_WINDOW_SIZE ? history_size : GRAY_PNG_WINDOW_SIZE;
+    bool ok = window == 0 ||
+              deflateSetDictionary(&stream, band_data - window, (uInt)window) == Z_OK;
+
+    // deflateBound covers the data; the sync flush marker and the empty
+    // final block fit in the margin
+    size_t capacity = deflateBound(&stream, (uLong)band_size) + 16;
+    output->data = ok ? malloc(capacity) : NULL;
+    if (output->data) {
+        stream.next_in = (Bytef*)band_data;
+        stream.avail_in = (uInt)band_size;
+        stream.next_out = output->data;
+        stream.avail_out = (uInt)capacity;
+        int result = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+        ok = (last ? result == Z_STREAM_END : result == Z_OK) && stream.avail_in == 0 && stream.avail_out > 0;
+        output->size = capacity - stream.avail_out;
+    }
+    deflateEnd(&stream);
+    free(filtered);
+
+    if (!output->data || !ok) {
+        SDL_AtomicSet(&job->failed, 1);
+    }
+}
+
+static void put_be32(Uint8* bytes, Uint32 value) {
+    bytes[0] = (Uint8)(value >> 24);
+    bytes[1] = (Uint8)(value >> 16);
+    bytes[2] = (Uint8)(value >> 8);
+    bytes[3] = (Uint8)value;
+}
+
+static bool write_bytes(FILE* file, const Uint8* bytes, size_t size) {
+    return size == 0 || fwrite(bytes, 1, size, file) == size;
+}
+
+// Write a chunk whose data is prefix, body and suffix back to back
+static bool write_chunk(FILE* file, const char* type, const Uint8* prefix, size_t prefix_size,
+                        const Uint8* body, size_t body_size, const Uint8* suffix, size_t suffix_size) {
+    size_t length = prefix_size + body_size + suffix_size;
+    if (length > 0x7FFFFFFF) {
+        return false;
+    }
+
+    Uint8 header[8];
+    put_be32(header, (Uint32)length);
+    memcpy(header + 4, type, 4);
+
+    // crc32 restarts on a NULL buffer, so empty parts are skipped
+    uLong crc = crc32(crc32(0L, Z_NULL, 0), header + 4, 4);
+    if (prefix_size > 0) {
+        crc = crc32(crc, prefix, (uInt)prefix_size);
+    }
+    if (body_size > 0) {
+        crc = crc32(crc, body, (uInt)body_size);
+    }
+    if (suffix_size > 0) {
+        crc = crc32(crc, suffix, (uInt)suffix_size);
+    }
+
+    Uint8 trailer[4];
+    put_be32(trailer, (Uint32)crc);
+
+    return write_bytes(file, header, sizeof(header)) && write_bytes(file, prefix, prefix_size) &&
+           write_bytes(file, body, body_size) && write_bytes(file, suffix, suffix_size) &&
+           write_bytes(file, trailer, sizeof(trailer));
+}
+
+// One IDAT per band: the zlib header leads the first, the combined Adler-32
+// closes the last
+static bool write_parallel_png(FILE* file, const PngEncodeJob* job) {
+    static const Uint8 signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+    Uint8 header[13];
+    put_be32(header, (Uint32)job->width);
+    put_be32(header + 4, (Uint32)job->height);
+    header[8] = 8;                      // Bit depth
+    header[9] = PNG_COLOR_TYPE_GRAY;
+    header[10] = 0;                     // Deflate
+    header[11] = 0;                     // Adaptive filtering
+    header[12] = 0;                     // No interlace
+
+    // CMF: deflate with a 32 KB window; FLG: level hint, check bits
+    int level = zlib_level(job->options);
+    int level_hint = level == Z_DEFAULT_COMPRESSION ? 2 : level <= 1 ? 0 : level <= 5 ? 1 : level == 6 ? 2 : 3;
+    Uint8 zlib_header[2] = { 0x78, (Uint8)(level_hint << 6) };
+    zlib_header[1] = (Uint8)(zlib_header[1] + 31 - (zlib_header[0] * 256 + zlib_header[1]) % 31);
+
+    uLong adler = adler32(0L, Z_NULL, 0);
+    for (int band = 0; band < job->band_count; band++) {
+        adler = adler32_combine(adler, job->bands[band].adler, (z_off_t)job->bands[band].length);
+    }
+    Uint8 zlib_trailer[4];
+    put_be32(zlib_trailer, (Uint32)adler);
+
+    bool ok = write_bytes(file, signature, sizeof(signature)) &&
+              write_chunk(file, "IHDR", header, sizeof(header), NULL, 0, NULL, 0);
+    for (int band = 0; ok && band < job->band_count; band++) {
+        bool first = (band == 0);
+        bool last = (band == job->band_count - 1);
+        ok = write_chunk(file, "IDAT", zlib_header, first ? sizeof(zlib_header) : 0,
+                         job->bands[band].data, job->bands[band].size,
+                         zlib_trailer, last ? sizeof(zlib_trailer) : 0);
+    }
+    return ok && write_chunk(file, "IEND", NULL, 0, NULL, 0, NULL, 0);
+}
+
+static bool write_gray_png_parallel(const char* filename, const Uint8* pixels, int width, int height,
+                                    size_t stride, const GrayPngOptions* options) {
+    PngEncodeJob* job = calloc(1, sizeof(PngEncodeJob));
+    if (!job) {
+        return false;
+    }
+
+    job->pixels = pixels;
+    job->width = width;
+    job->height = height;
+    job->stride = stride;
+    job->options = options;
+    SDL_AtomicSet(&job->failed, 0);
+
+    job->band_count = thread_pool_run_bands(get_analysis_pool(), height, encode_band, job);
+
+    bool ok = !SDL_AtomicGet(&job->failed);
+    if (ok) {
+        FILE* file = fopen(filename, "wb");
+        ok = file != NULL;
+        if (file) {
+            ok = write_parallel_png(file, job);
+            ok = (fclose(file) == 0) && ok;
+        }
+    }
+
+    for (int band = 0; band < job->band_count; band++) {
+        free(job->bands[band].data);
+    }
+    free(job);
+    return ok;
+}
+
+bool write_gray_png(const char* filename, const Uint8* pixels, int width, int height, size_t stride) {
+    return write_gray_png_with_options(filename, pixels, width, height, stride, &g_options);
+}
+
+bool write_gray_png_with_options(const char* filename, const Uint8* pixels, int width, int height,
+                                 size_t stride, const GrayPngOptions* options) {
+    if (!filename || !pixels || !options || !valid_options(options)) {
+        return false;
+    }
+
+    if (options->parallel) {
+        if (width <= 0 || height <= 0) {
+            return false;
+        }
+        bool ok = write_gray_png_parallel(filename, pixels, width, height, stride, options);
+        if (!ok) {
+            remove(filename);
+        }
+        return ok;
+    }
+
+    GrayPngWriter* writer = gray_png_open_with_options(filename, width, height, options);
+    if (!writer) {
+        return false;
+    }
+
+    // libpng only reads the rows; the casts drop const for its API
+    Uint8* row_pointers[GRAY_PNG_ROW_BATCH];
+    bool ok = true;
+
+    for (int y = 0; ok && y < height; y += GRAY_PNG_ROW_BATCH) {
+        int rows = (height - y < GRAY_PNG_ROW_BATCH) ? height - y : GRAY_PNG_ROW_BATCH;
+        for (int i = 0; i < rows; i++) {
+            row_pointers[i] = (Uint8*)pixels + (size_t)(y + i) * stride;
+        }
+        ok = gray_png_write_rows(writer, row_pointers, rows);
+    }
+
+    if (ok) {
+        ok = gray_png_finish(writer);
+    }
+    gray_png_close(writer);
+
+    if (!ok) {
+        remove(filename);
+    }
+    return ok;
+}
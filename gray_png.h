@@ -0,0 +1,154 @@
+#ifndef GRAY_PNG_H
+#define GRAY_PNG_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Row filters (PNG filter types) tried by the encoder
+typedef enum {
+    GRAY_PNG_FILTER_ADAPTIVE = 0,   // Best of the five filters per row (libpng's heuristic)
+    GRAY_PNG_FILTER_NONE,
+    GRAY_PNG_FILTER_SUB,
+    GRAY_PNG_FILTER_UP,
+    GRAY_PNG_FILTER_AVERAGE,
+    GRAY_PNG_FILTER_PAETH
+} GrayPngFilter;
+
+// zlib strategies
+typedef enum {
+    GRAY_PNG_STRATEGY_DEFAULT = 0,  // Z_FILTERED when rows are filtered, as libpng does
+    GRAY_PNG_STRATEGY_FILTERED,
+    GRAY_PNG_STRATEGY_HUFFMAN_ONLY,
+    GRAY_PNG_STRATEGY_RLE
+} GrayPngStrategy;
+
+// Encoder settings
+typedef struct {
+    int compression_level;          // zlib level 0-9 (-1 = zlib default, 6)
+    GrayPngFilter filter;
+    GrayPngStrategy strategy;
+    bool parallel;                  // Compress row bands on the analysis thread pool
+} GrayPngOptions;
+
+// Incremental writer for 8-bit grayscale PNG files (color type 0)
+typedef struct GrayPngWriter GrayPngWriter;
+
+/**
+ * Get the default encoder settings: libpng's own defaults (level 6, adaptive
+ * filters), single stream
+ * @param options Pointer to store the settings
+ */
+void gray_png_default_options(GrayPngOptions* options);
+
+/**
+ * Get the fast encoder settings: level 1, Paeth filter, RLE matching and
+ * parallel compression. On photographs Paeth leaves mostly runs of small
+ * residuals, which RLE matching codes nearly as well as a full match search:
+ * files come out within about 1% of the defaults, in a third of the time on
+ * one thread, before the parallel speedup
+ * @param options Pointer to store the settings
+ */
+void gray_png_fast_options(GrayPngOptions* options);
+
+/**
+ * Set the settings used by gray_png_open, write_gray_png and
+ * save_grayscale_image (call before starting other threads)
+ * @param options New settings (NULL restores the defaults)
+ * @return true on success, false if a setting is out of range
+ */
+bool set_png_encode_options(const GrayPngOptions* options);
+
+/**
+ * Get the settings used by gray_png_open, write_gray_png and save_grayscale_image
+ * @param options Pointer to store the settings
+ */
+void get_png_encode_options(GrayPngOptions* options);
+
+/**
+ * Parse a filter name (adaptive, none, sub, up, average, paeth)
+ * @param name Filter name
+ * @param filter Pointer to store the filter
+ * @return true if the name is known
+ */
+bool parse_png_filter(const char* name, GrayPngFilter* filter);
+
+/**
+ * Create a grayscale PNG file and write its header
+ * Uses the current encode settings (rows are always compressed as they come,
+ * in a single stream)
+ * @param filename Path of the PNG to create
+ * @param width Image width in pixels
+ * @param height Image height in pixels
+ * @return Writer, or NULL on failure
+ */
+GrayPngWriter* gray_png_open(const char* filename, int width, int height);
+
+/**
+ * Create a grayscale PNG file with explicit settings and write its header
+ * @param filename Path of the PNG to create
+ * @param width Image width in pixels
+ * @param height Image height in pixels
+ * @param options Encoder settings (parallel is ignored)
+ * @return Writer, or NULL on failure
+ */
+GrayPngWriter* gray_png_open_with_options(const char* filename, int width, int height,
+                                          const GrayPngOptions* options);
+
+/**
+ * Write the next rows of the image
+ * @param writer Open writer
+ * @param row_pointers One pointer per row, each holding width gray bytes
+ * @param rows Number of rows
+ * @return true on success, false on failure
+ */
+bool gray_png_write_rows(GrayPngWriter* writer, Uint8** row_pointers, int rows);
+
+/**
+ * Write the end of the file after all rows
+ * @param writer Open writer
+ * @return true on success, false on failure
+ */
+bool gray_png_finish(GrayPngWriter* writer);
+
+/**
+ * Close the file and free the writer (safe on NULL)
+ * @param writer Writer to close
+ */
+void gray_png_close(GrayPngWriter* writer);
+
+/**
+ * Write a whole 8-bit grayscale buffer as a PNG with the current encode settings
+ * Row pointers point straight into the buffer
+ * @param filename Path of the PNG to create
+ * @param pixels Gray pixel data
+ * @param width Image width in pixels
+ * @param height Image height in pixels
+ * @param stride Bytes between the start of consecutive rows
+ * @return true on success, false on failure (a partial file is removed)
+ */
+bool write_gray_png(const char* filename, const Uint8* pixels, int width, int height, size_t stride);
+
+/**
+ * Write a whole 8-bit grayscale buffer as a PNG with explicit settings
+ *
+ * In parallel mode the image is split in row bands, as analysis passes are;
+ * each band is filtered and deflated on its own thread (pigz-style): the
+ * stream of a band is primed with the last 32 KB of filtered data before it,
+ * so matches across bands are kept, and ends on a byte boundary (sync flush)
+ * so the streams concatenate into one zlib stream, whose Adler-32 is combined
+ * from the per-band checksums. The file decodes like any PNG; its size differs
+ * slightly from a single stream, and depends on the band count (thread count)
+ *
+ * @param filename Path of the PNG to create
+ * @param pixels Gray pixel data
+ * @param width Image width in pixels
+ * @param height Image height in pixels
+ * @param stride Bytes between the start of consecutive rows
+ * @param options Encoder settings
+ * @return true on success, false on failure (a partial file is removed)
+ */
+bool write_gray_png_with_options(const char* filename, const Uint8* pixels, int width, int height,
+                                 size_t stride, const GrayPngOptions* options);
+
+#endif // GRAY_PNG_H
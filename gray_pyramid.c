@@ -0,0 +1,305 @@
+#include "gray_pyramid.h"
+#include "cpu_features.h"
+#include "profiler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Levels start on cache-line boundaries inside the block
+#define LEVEL_ALIGNMENT 64
+
+// Halve two source rows into one: out[x] is the rounded mean of the 2x2
+// block at (2x, 2x+1); an odd last column averages its two pixels
+typedef void (*DownsampleRowFunc)(const Uint8* row0, const Uint8* row1, Uint8* out, int src_width);
+
+static void downsample_row_scalar(const Uint8* row0, const Uint8* row1, Uint8* out, int src_width) {
+    int pairs = src_width / 2;
+    for (int x = 0; x < pairs; x++) {
+        out[x] = (Uint8)((row0[2 * x] + row0[2 * x + 1] + row1[2 * x] + row1[2 * x + 1] + 2) >> 2);
+    }
+    if (src_width & 1) {
+        out[pairs] = (Uint8)((row0[src_width - 1] + row1[src_width - 1] + 1) >> 1);
+    }
+}
+
+#ifdef CPU_FEATURES_X86
+
+// Even and odd bytes are split by masking and shifting 16-bit lanes, which
+// sums each horizontal pair without a shuffle
+TARGET_SSE2
+static void downsample_row_sse2(const Uint8* row0, const Uint8* row1, Uint8* out, int src_width) {
+    const __m128i even = _mm_set1_epi16(0x00FF);
+    const __m128i two = _mm_set1_epi16(2);
+    int pairs = src_width / 2;
+    int x = 0;
+
+    for (; x + 16 <= pairs; x += 16) {
+        __m128i sums[2];
+        for (int half = 0; half < 2; half++) {
+            __m128i a = _mm_loadu_si128((const __m128i*)(row0 + 2 * x + 16 * half));
+            __m128i b = _mm_loadu_si128((const __m128i*)(row1 + 2 * x + 16 * half));
+            __m128i top = _mm_add_epi16(_mm_and_si128(a, even), _mm_srli_epi16(a, 8));
+            __m128i bottom = _mm_add_epi16(_mm_and_si128(b, even), _mm_srli_epi16(b, 8));
+            sums[half] = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(top, bottom), two), 2);
+        }
+        _mm_storeu_si128((__m128i*)(out + x), _mm_packus_epi16(sums[0], sums[1]));
+    }
+
+    downsample_row_scalar(row0 + 2 * x, row1 + 2 * x, out + x, src_width - 2 * x);
+}
+
+// The in-lane pack leaves 64-bit quarters in 0, 2, 1, 3 order
+TARGET_AVX2
+static void downsample_row_avx2(const Uint8* row0, const Uint8* row1, Uint8* out, int src_width) {
+    const __m256i even = _mm256_set1_epi16(0x00FF);
+    const __m256i two = _mm256_set1_epi16(2);
+    int pairs = src_width / 2;
+    int x = 0;
+
+    for (; x + 32 <= pairs; x += 32) {
+        __m256i sums[2];
+        for (int half = 0; half < 2; half++) {
+            __m256i a = _mm256_loadu_si256((const __m256i*)(row0 + 2 * x + 32 * half));
+            __m256i b = _mm256_loadu_si256((const __m256i*)(row1 + 2 * x + 32 * half));
+            __m256i top = _mm256_add_epi16(_mm256_and_si256(a, even), _mm256_srli_epi16(a, 8));
+            __m256i bottom = _mm256_add_epi16(_mm256_and_si256(b, even), _mm256_srli_epi16(b, 8));
+            sums[half] = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(top, bottom), two), 2);
+        }
+        __m256i packed = _mm256_packus_epi16(sums[0], sums[1]);
+        _mm256_storeu_si256((__m256i*)(out + x), _mm256_permute4x64_epi64(packed, 0xD8));
+    }
+
+    downsample_row_sse2(row0 + 2 * x, row1 + 2 * x, out + x, src_width - 2 * x);
+}
+
+#endif // CPU_FEATURES_X86
+
+// Pick the widest kernel the CPU supports
+static DownsampleRowFunc select_downsample_kernel(void) {
+#ifdef CPU_FEATURES_X86
+    CpuIsa isa = get_cpu_isa();
+    if (isa == CPU_ISA_AVX2) {
+        return downsample_row_avx2;
+    }
+    if (isa == CPU_ISA_SSE2) {
+        return downsample_row_sse2;
+    }
+#endif
+    return downsample_row_scalar;
+}
+
+// Compute row y of level (from level - 1); the last row of an odd-height
+// level reads its single source row twice
+static void produce_level_row(GrayPyramid* pyramid, int level, int y, DownsampleRowFunc kernel) {
+    const GrayPyramidLevel* src = &pyramid->levels[level - 1];
+    GrayPyramidLevel* dst = &pyramid->levels[level];
+    const Uint8* row0 = src->pixels + (size_t)(2 * y) * src->width;
+    const Uint8* row1 = (2 * y + 1 < src->height) ? row0 + src->width : row0;
+
+    kernel(row0, row1, dst->pixels + (size_t)y * dst->width, src->width);
+}
+
+// ---------------------------------------------------------------------------
+// Allocation
+// ---------------------------------------------------------------------------
+
+bool init_gray_pyramid(GrayPyramid* pyramid, int width, int height, int max_levels) {
+    if (!pyramid || width <= 0 || height <= 0) {
+        return false;
+    }
+
+    memset(pyramid, 0, sizeof(GrayPyramid));
+    if (max_levels <= 0 || max_levels > GRAY_PYRAMID_MAX_LEVELS) {
+        max_levels = GRAY_PYRAMID_MAX_LEVELS;
+    }
+
+    size_t offsets[GRAY_PYRAMID_MAX_LEVELS];
+    size_t total = 0;
+    int level_width = width;
+    int level_height = height;
+    while (pyramid->level_count < max_levels) {
+        GrayPyramidLevel* level = &pyramid->levels[pyramid->level_count];
+        level->width = level_width;
+        level->height = level_height;
+        offsets[pyramid->level_count++] = total;
+
+        size_t size = (size_t)level_width * level_height;
+        total += (size + LEVEL_ALIGNMENT - 1) & ~(size_t)(LEVEL_ALIGNMENT - 1);
+        if (level_width == 1 && level_height == 1) {
+            break;
+        }
+        level_width = (level_width + 1) / 2;
+        level_height = (level_height + 1) / 2;
+    }
+
+    pyramid->pool = get_grayscale_buffer_pool();
+    pyramid->data = buffer_pool_acquire(pyramid->pool, total);
+    if (!pyramid->data) {
+        printf("Erro: Falha ao alocar memória para a pirâmide\n");
+        memset(pyramid, 0, sizeof(GrayPyramid));
+        return false;
+    }
+    pyramid->data_size = total;
+    PROFILE_ALLOC(total);
+
+    for (int i = 0; i < pyramid->level_count; i++) {
+        pyramid->levels[i].pixels = pyramid->data + offsets[i];
+    }
+    return true;
+}
+
+void free_gray_pyramid(GrayPyramid* pyramid) {
+    if (!pyramid) {
+        return;
+    }
+
+    if (pyramid->data) {
+        PROFILE_FREE(pyramid->data_size);
+        buffer_pool_release(pyramid->pool, pyramid->data);
+    }
+    memset(pyramid, 0, sizeof(GrayPyramid));
+}
+
+// ---------------------------------------------------------------------------
+// Incremental building
+// ---------------------------------------------------------------------------
+
+bool gray_pyramid_push_rows(GrayPyramid* pyramid, const Uint8* rows, size_t stride, int count) {
+    if (!pyramid || !pyramid->data || !rows || count < 0) {
+        return false;
+    }
+
+    GrayPyramidLevel* base = &pyramid->levels[0];
+    if (count > base->height - base->rows_ready) {
+        return false;
+    }
+
+    for (int i = 0; i < count; i++) {
+        memcpy(base->pixels + (size_t)(base->rows_ready + i) * base->width, rows + i * stride, (size_t)base->width);
+    }
+    base->rows_ready += count;
+
+    // A coarser row is ready once both of its source rows are (or the single
+    // last row of an odd-height level)
+    DownsampleRowFunc kernel = select_downsample_kernel();
+    for (int level = 1; level < pyramid->level_count; level++) {
+        const GrayPyramidLevel* src = &pyramid->levels[level - 1];
+        GrayPyramidLevel* dst = &pyramid->levels[level];
+        while (dst->rows_ready < dst->height) {
+            int needed = 2 * dst->rows_ready + 2;
+            if (needed > src->height) {
+                needed = src->height;
+            }
+            if (src->rows_ready < needed) {
+                break;
+            }
+            produce_level_row(pyramid, level, dst->rows_ready, kernel);
+            dst->rows_ready++;
+        }
+    }
+    return true;
+}
+
+bool gray_pyramid_is_complete(const GrayPyramid* pyramid) {
+    if (!pyramid || pyramid->level_count == 0) {
+        return false;
+    }
+
+    const GrayPyramidLevel* last = &pyramid->levels[pyramid->level_count - 1];
+    return last->rows_ready == last->height;
+}
+
+// ---------------------------------------------------------------------------
+// Whole image
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    GrayPyramid* pyramid;
+    int level;
+    DownsampleRowFunc kernel;
+} PyramidLevelJob;
+
+static void pyramid_level_band(void* context, int band, int row_begin, int row_end) {
+    PyramidLevelJob* job = (PyramidLevelJob*)context;
+    (void)band;
+
+    for (int y = row_begin; y < row_end; y++) {
+        produce_level_row(job->pyramid, job->level, y, job->kernel);
+    }
+}
+
+bool build_gray_pyramid(const GrayscaleImage* grayscale_image, GrayPyramid* pyramid, int max_levels) {
+    if (!grayscale_image || !grayscale_image->pixels ||
+        !init_gray_pyramid(pyramid, grayscale_image->width, grayscale_image->height, max_levels)) {
+        return false;
+    }
+
+    PROFILE_START(filter_start);
+    GrayPyramidLevel* base = &pyramid->levels[0];
+    memcpy(base->pixels, grayscale_image->pixels, grayscale_image->data_size);
+    base->rows_ready = base->height;
+
+    PyramidLevelJob job;
+    job.pyramid = pyramid;
+    job.kernel = select_downsample_kernel();
+    for (int level = 1; level < pyramid->level_count; level++) {
+        job.level = level;
+        thread_pool_run_bands(get_analysis_pool(), pyramid->levels[level].height, pyramid_level_band, &job);
+        pyramid->levels[level].rows_ready = pyramid->levels[level].height;
+    }
+    PROFILE_STOP(PROFILE_STAGE_FILTER, filter_start, grayscale_image->data_size);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Queries
+// ---------------------------------------------------------------------------
+
+int select_pyramid_level(const GrayPyramid* pyramid, size_t max_pixels) {
+    if (!pyramid || pyramid->level_count == 0) {
+        return 0;
+    }
+
+    for (int level = 0; level < pyramid->level_count; level++) {
+        const GrayPyramidLevel* current = &pyramid->levels[level];
+        if ((size_t)current->width * current->height <= max_pixels) {
+            return level;
+        }
+    }
+    return pyramid->level_count - 1;
+}
+
+// Non-owning GrayscaleImage over a level (never passed to free_grayscale_image)
+static bool level_view(const GrayPyramid* pyramid, int level, GrayscaleImage* view) {
+    if (!pyramid || level < 0 || level >= pyramid->level_count) {
+        return false;
+    }
+
+    const GrayPyramidLevel* current = &pyramid->levels[level];
+    if (current->rows_ready < current->height) {
+        return false;
+    }
+
+    memset(view, 0, sizeof(GrayscaleImage));
+    view->width = current->width;
+    view->height = current->height;
+    view->data_size = (size_t)current->width * current->height;
+    view->pixels = current->pixels;
+    return true;
+}
+
+bool estimate_pyramid_stats(const GrayPyramid* pyramid, int level, ImageAnalysis* analysis) {
+    GrayscaleImage view;
+    if (!analysis || !level_view(pyramid, level, &view) || !calculate_grayscale_stats(&view, analysis)) {
+        return false;
+    }
+
+    analysis->width = pyramid->levels[0].width;
+    analysis->height = pyramid->levels[0].height;
+    return true;
+}
+
+bool save_pyramid_level(const GrayPyramid* pyramid, int level, const char* filename) {
+    GrayscaleImage view;
+    return level_view(pyramid, level, &view) && save_grayscale_image(&view, filename);
+}
@@ -0,0 +1,104 @@
+#ifndef GRAY_PYRAMID_H
+#define GRAY_PYRAMID_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include "image_analysis.h"
+
+// Most levels of a pyramid (level 0 included); enough to reach 1x1 from any image
+#define GRAY_PYRAMID_MAX_LEVELS 32
+
+// One level of a pyramid (rows are width bytes apart)
+typedef struct {
+    int width;
+    int height;
+    Uint8* pixels;          // Into the pyramid's single block (64-byte aligned)
+    int rows_ready;         // Rows already filled (incremental building)
+} GrayPyramidLevel;
+
+// Image pyramid: level 0 is the full image and each following level halves
+// the previous one (sizes round up) with a rounded 2x2 average; all levels
+// share one allocation
+typedef struct {
+    Uint8* data;
+    size_t data_size;
+    BufferPool* pool;       // Pool owning data
+    int level_count;
+    GrayPyramidLevel levels[GRAY_PYRAMID_MAX_LEVELS];
+} GrayPyramid;
+
+/**
+ * Allocate an empty pyramid, to be filled with gray_pyramid_push_rows
+ * @param pyramid Pyramid to initialize
+ * @param width Full image width
+ * @param height Full image height
+ * @param max_levels Most levels including level 0 (0 = down to 1x1)
+ * @return true on success, false on invalid size or out of memory
+ */
+bool init_gray_pyramid(GrayPyramid* pyramid, int width, int height, int max_levels);
+
+/**
+ * Free a pyramid
+ * @param pyramid Pyramid to free
+ */
+void free_gray_pyramid(GrayPyramid* pyramid);
+
+/**
+ * Append the next rows of the full image and produce every coarser row that
+ * became complete, so a pyramid can be built while an image is being decoded
+ * @param pyramid Pyramid being built
+ * @param rows First pixel of the first row
+ * @param stride Bytes between rows
+ * @param count Number of rows
+ * @return true on success, false if more rows than the image height were pushed
+ */
+bool gray_pyramid_push_rows(GrayPyramid* pyramid, const Uint8* rows, size_t stride, int count);
+
+/**
+ * Check whether all rows of every level are filled
+ * @param pyramid Pyramid to check
+ * @return true when complete
+ */
+bool gray_pyramid_is_complete(const GrayPyramid* pyramid);
+
+/**
+ * Build a whole pyramid from an image
+ * Each level is computed in row bands over the analysis thread pool with
+ * SSE2/AVX2 2x2 averaging
+ * @param grayscale_image Source image
+ * @param pyramid Pyramid to create
+ * @param max_levels Most levels including level 0 (0 = down to 1x1)
+ * @return true on success, false on failure
+ */
+bool build_gray_pyramid(const GrayscaleImage* grayscale_image, GrayPyramid* pyramid, int max_levels);
+
+/**
+ * Pick the finest level with at most max_pixels pixels
+ * @param pyramid Pyramid
+ * @param max_pixels Pixel budget
+ * @return Level index (the coarsest level if none fits)
+ */
+int select_pyramid_level(const GrayPyramid* pyramid, size_t max_pixels);
+
+/**
+ * Approximate statistics of the full image from a coarser level
+ * Each level averages 2x2 blocks, so the mean stays within a fraction of an
+ * intensity of the full-resolution mean while min/max/stddev shrink toward
+ * it as detail is averaged away (level 0 gives exact results)
+ * @param pyramid Complete pyramid
+ * @param level Level to read
+ * @param analysis Pointer to store statistics (width/height of the full image)
+ * @return true on success, false on failure
+ */
+bool estimate_pyramid_stats(const GrayPyramid* pyramid, int level, ImageAnalysis* analysis);
+
+/**
+ * Save one level as a grayscale PNG
+ * @param pyramid Complete pyramid
+ * @param level Level to save
+ * @param filename Output path
+ * @return true on success, false on failure
+ */
+bool save_pyramid_level(const GrayPyramid* pyramid, int level, const char* filename);
+
+#endif // GRAY_PYRAMID_H
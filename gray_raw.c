@@ -0,0 +1,273 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "gray_raw.h"
+#include "hash64.h"
+#include "profiler.h"
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define GRAY_RAW_BYTE_ORDER 0x01020304u
+
+Uint64 gray_raw_checksum(const Uint8* data, size_t size) {
+    return hash64(data, size, 0);
+}
+
+static Uint32 payload_offset(void) {
+    // Smallest multiple of the alignment that holds the header
+    return (Uint32)((sizeof(GrayRawHeader) + GRAY_RAW_PAYLOAD_ALIGN - 1) / GRAY_RAW_PAYLOAD_ALIGN * GRAY_RAW_PAYLOAD_ALIGN);
+}
+
+bool save_grayscale_raw(const GrayscaleImage* grayscale_image, const char* output_path) {
+    if (!grayscale_image || !grayscale_image->pixels || !output_path) {
+        return false;
+    }
+
+    GrayRawHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, GRAY_RAW_MAGIC, sizeof(GRAY_RAW_MAGIC));
+    header.version = GRAY_RAW_VERSION;
+    header.byte_order = GRAY_RAW_BYTE_ORDER;
+    header.width = (Uint32)grayscale_image->width;
+    header.height = (Uint32)grayscale_image->height;
+    header.stride = (Uint32)grayscale_image->width;
+    header.payload_offset = payload_offset();
+    header.payload_size = (Uint64)header.stride * header.height;
+    header.checksum = gray_raw_checksum(grayscale_image->pixels, (size_t)header.payload_size);
+
+    PROFILE_START(io_start);
+    FILE* file = fopen(output_path, "wb");
+    if (!file) {
+        printf("Erro ao criar arquivo: %s\n", output_path);
+        return false;
+    }
+
+    // Header, zero padding up to the payload offset, then the pixels
+    Uint8 padding[GRAY_RAW_PAYLOAD_ALIGN];
+    memset(padding, 0, sizeof(padding));
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(padding, header.payload_offset - sizeof(header), 1, file) == 1 &&
+              fwrite(grayscale_image->pixels, 1, (size_t)header.payload_size, file) == header.payload_size;
+
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+    PROFILE_STOP(PROFILE_STAGE_FILE_IO, io_start, header.payload_size);
+    
+    if (!ok) {
+        remove(output_path);
+        printf("Erro ao salvar imagem: %s\n", output_path);
+    }
+    return ok;
+}
+
+// Check a header against the size of the file it came from
+static bool validate_header(const GrayRawHeader* header, Uint64 file_size) {
+    if (memcmp(header->magic, GRAY_RAW_MAGIC, sizeof(GRAY_RAW_MAGIC)) != 0 ||
+        header->version != GRAY_RAW_VERSION ||
+        header->byte_order != GRAY_RAW_BYTE_ORDER) {
+        return false;
+    }
+
+    if (header->width == 0 || header->height == 0 || header->width > INT_MAX || header->height > INT_MAX ||
+        header->stride < header->width ||
+        header->payload_offset < sizeof(GrayRawHeader) ||
+        header->payload_offset % GRAY_RAW_PAYLOAD_ALIGN != 0) {
+        return false;
+    }
+
+    if (header->payload_size != (Uint64)header->stride * header->height) {
+        return false;
+    }
+
+    return file_size >= (Uint64)header->payload_offset + header->payload_size;
+}
+
+bool is_grayscale_raw_file(const char* filename) {
+    if (!filename) {
+        return false;
+    }
+
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        return false;
+    }
+
+    char magic[8];
+    bool is_raw = fread(magic, sizeof(magic), 1, file) == 1 &&
+                  memcmp(magic, GRAY_RAW_MAGIC, sizeof(GRAY_RAW_MAGIC)) == 0;
+    fclose(file);
+    return is_raw;
+}
+
+// ---------------------------------------------------------------------------
+// Mapping
+// ---------------------------------------------------------------------------
+
+// Map a whole file copy-on-write; returns NULL on failure
+static void* map_file(const char* filename, size_t* size) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return NULL;
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0 ||
+        (Uint64)file_size.QuadPart > (Uint64)SIZE_MAX) {
+        CloseHandle(file);
+        return NULL;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping) {
+        return NULL;
+    }
+
+    // The view keeps the mapping alive after its handle is closed
+    void* data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!data) {
+        return NULL;
+    }
+
+    *size = (size_t)file_size.QuadPart;
+    return data;
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0 || (Uint64)st.st_size > (Uint64)SIZE_MAX) {
+        close(fd);
+        return NULL;
+    }
+
+    // Private writable mapping: pixels can be edited in memory without
+    // touching the file, and untouched pages stay shared with the page cache
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+
+    *size = (size_t)st.st_size;
+    return data;
+#endif
+}
+
+void unmap_grayscale_raw(void* mapping, size_t size) {
+    if (!mapping) {
+        return;
+    }
+
+#ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile(mapping);
+#else
+    munmap(mapping, size);
+#endif
+}
+
+bool load_grayscale_raw(const char* filename, GrayscaleImage* grayscale_image, bool verify_checksum) {
+    if (!filename || !grayscale_image) {
+        return false;
+    }
+
+    memset(grayscale_image, 0, sizeof(GrayscaleImage));
+
+    PROFILE_START(io_start);
+    size_t mapping_size = 0;
+    Uint8* mapping = map_file(filename, &mapping_size);
+    if (!mapping) {
+        printf("Erro ao abrir arquivo: %s\n", filename);
+        return false;
+    }
+
+    GrayRawHeader header;
+    if (mapping_size < sizeof(header)) {
+        unmap_grayscale_raw(mapping, mapping_size);
+        printf("Arquivo bruto invalido: %s\n", filename);
+        return false;
+    }
+    memcpy(&header, mapping, sizeof(header));
+
+    if (!validate_header(&header, mapping_size)) {
+        unmap_grayscale_raw(mapping, mapping_size);
+        printf("Arquivo bruto invalido: %s\n", filename);
+        return false;
+    }
+
+    Uint8* payload = mapping + header.payload_offset;
+    if (verify_checksum && gray_raw_checksum(payload, (size_t)header.payload_size) != header.checksum) {
+        unmap_grayscale_raw(mapping, mapping_size);
+        printf("Checksum invalido: %s\n", filename);
+        return false;
+    }
+
+    grayscale_image->width = (int)header.width;
+    grayscale_image->height = (int)header.height;
+    grayscale_image->data_size = (size_t)header.width * header.height;
+
+    if (header.stride == header.width) {
+        // Zero copy: pixels live in the mapping until free_grayscale_image
+        grayscale_image->pixels = payload;
+        grayscale_image->mapping = mapping;
+        grayscale_image->mapping_size = mapping_size;
+    } else {
+        grayscale_image->pool = get_grayscale_buffer_pool();
+        grayscale_image->pixels = buffer_pool_acquire(grayscale_image->pool, grayscale_image->data_size);
+        if (!grayscale_image->pixels) {
+            grayscale_image->pool = NULL;
+            unmap_grayscale_raw(mapping, mapping_size);
+            return false;
+        }
+        PROFILE_ALLOC(grayscale_image->data_size);
+        for (Uint32 y = 0; y < header.height; y++) {
+            memcpy(grayscale_image->pixels + (size_t)y * header.width,
+                   payload + (size_t)y * header.stride, header.width);
+        }
+        unmap_grayscale_raw(mapping, mapping_size);
+    }
+    PROFILE_STOP(PROFILE_STAGE_FILE_IO, io_start, header.payload_size);
+
+    size_t filename_len = strlen(filename) + 1;
+    grayscale_image->source_filename = malloc(filename_len);
+    if (grayscale_image->source_filename) {
+        memcpy(grayscale_image->source_filename, filename, filename_len);
+    }
+    return true;
+}
+
+bool generate_grayscale_raw_filename(const char* original_filename, char* output_buffer, size_t buffer_size) {
+    if (!generate_grayscale_filename(original_filename, output_buffer, buffer_size)) {
+        return false;
+    }
+
+    // Swap the ".png" of the PNG name for the raw extension
+    char* extension = strrchr(output_buffer, '.');
+    size_t prefix = (size_t)(extension - output_buffer) + 1;
+    if (prefix + strlen(GRAY_RAW_EXTENSION) + 1 > buffer_size) {
+        return false;
+    }
+    memcpy(extension + 1, GRAY_RAW_EXTENSION, strlen(GRAY_RAW_EXTENSION) + 1);
+    return true;
+}
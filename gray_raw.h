@@ -0,0 +1,81 @@
+#ifndef GRAY_RAW_H
+#define GRAY_RAW_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include "image_analysis.h"
+
+// Raw grayscale container: a fixed header followed by the pixel payload at a
+// page boundary, so the file can be mapped and used without parsing or copying
+#define GRAY_RAW_MAGIC "GRAYRAW"
+#define GRAY_RAW_VERSION 2           // 2: XXH64 payload checksum
+#define GRAY_RAW_PAYLOAD_ALIGN 4096
+#define GRAY_RAW_EXTENSION "gray"
+
+// On-disk header (native byte order, checked through byte_order)
+typedef struct {
+    char magic[8];          // GRAY_RAW_MAGIC, NUL-terminated
+    Uint32 version;
+    Uint32 byte_order;      // 0x01020304 as written by the producer
+    Uint32 width;
+    Uint32 height;
+    Uint32 stride;          // Bytes between row starts (>= width)
+    Uint32 payload_offset;  // Multiple of GRAY_RAW_PAYLOAD_ALIGN
+    Uint64 payload_size;    // stride * height
+    Uint64 checksum;        // gray_raw_checksum of the payload
+} GrayRawHeader;
+
+/**
+ * Save a grayscale image in the raw container format
+ * @param grayscale_image Grayscale image to save
+ * @param output_path Path of the file to write
+ * @return true on success, false on failure
+ */
+bool save_grayscale_raw(const GrayscaleImage* grayscale_image, const char* output_path);
+
+/**
+ * Load a raw container by mapping it into memory
+ * The returned image points into the mapping (copy-on-write, the file is never
+ * modified); free_grayscale_image unmaps it. Padded rows (stride > width) are
+ * copied into a heap buffer instead.
+ * @param filename Path of the raw container
+ * @param grayscale_image Pointer to store the image
+ * @param verify_checksum Whether to check the payload checksum (reads every page)
+ * @return true on success, false if the file is missing, truncated or corrupt
+ */
+bool load_grayscale_raw(const char* filename, GrayscaleImage* grayscale_image, bool verify_checksum);
+
+/**
+ * Check whether a file starts with a raw container header
+ * @param filename Path to the file
+ * @return true if the file is a raw grayscale container
+ */
+bool is_grayscale_raw_file(const char* filename);
+
+/**
+ * Generate the raw container filename for an image
+ * Converts "images/flowers.jpg" to "grayscale_images/flowers_gray.gray"
+ * @param original_filename Original image filename
+ * @param output_buffer Buffer to store the generated filename
+ * @param buffer_size Size of the output buffer
+ * @return true on success, false on failure
+ */
+bool generate_grayscale_raw_filename(const char* original_filename, char* output_buffer, size_t buffer_size);
+
+/**
+ * Checksum used for the payload (hash64, i.e. XXH64 with seed 0)
+ * @param data Bytes to hash
+ * @param size Number of bytes
+ * @return Checksum value
+ */
+Uint64 gray_raw_checksum(const Uint8* data, size_t size);
+
+/**
+ * Release a mapping created by load_grayscale_raw
+ * Called by free_grayscale_image; not needed by other code
+ * @param mapping Start of the mapping
+ * @param size Size of the mapping in bytes
+ */
+void unmap_grayscale_raw(void* mapping, size_t size);
+
+#endif // GRAY_RAW_H
@@ -0,0 +1,386 @@
+#include "gray_tiles.h"
+#include "grayscale_simd.h"
+#include "profiler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int clamp_int(int value, int low, int high) {
+    return value < low ? low : (value > high ? high : value);
+}
+
+bool init_tiled_image(TiledGrayscaleImage* tiled, int width, int height, int tile_size, int halo) {
+    if (!tiled) {
+        return false;
+    }
+
+    memset(tiled, 0, sizeof(TiledGrayscaleImage));
+    if (tile_size <= 0) {
+        tile_size = GRAY_TILE_SIZE;
+    }
+    if (width <= 0 || height <= 0 || halo < 0 || halo > tile_size) {
+        return false;
+    }
+
+    tiled->width = width;
+    tiled->height = height;
+    tiled->tile_size = tile_size;
+    tiled->halo = halo;
+    tiled->tile_stride = tile_size + 2 * halo;
+    tiled->tiles_x = (width + tile_size - 1) / tile_size;
+    tiled->tiles_y = (height + tile_size - 1) / tile_size;
+
+    // Round every block up to the alignment so each tile starts on a cache line
+    size_t block = (size_t)tiled->tile_stride * tiled->tile_stride;
+    tiled->tile_bytes = (block + BUFFER_POOL_ALIGNMENT - 1) & ~(size_t)(BUFFER_POOL_ALIGNMENT - 1);
+    tiled->data_size = tiled->tile_bytes * tiled->tiles_x * tiled->tiles_y;
+
+    tiled->pool = get_grayscale_buffer_pool();
+    tiled->data = buffer_pool_acquire(tiled->pool, tiled->data_size);
+    if (!tiled->data) {
+        memset(tiled, 0, sizeof(TiledGrayscaleImage));
+        return false;
+    }
+    PROFILE_ALLOC(tiled->data_size);
+    return true;
+}
+
+void free_tiled_image(TiledGrayscaleImage* tiled) {
+    if (!tiled) {
+        return;
+    }
+
+    if (tiled->data) {
+        PROFILE_FREE(tiled->data_size);
+        buffer_pool_release(tiled->pool, tiled->data);
+    }
+    memset(tiled, 0, sizeof(TiledGrayscaleImage));
+}
+
+int get_tile_count(const TiledGrayscaleImage* tiled) {
+    return tiled ? tiled->tiles_x * tiled->tiles_y : 0;
+}
+
+bool get_tile(const TiledGrayscaleImage* tiled, int index, GrayTile* tile) {
+    if (!tiled || !tiled->data || !tile || index < 0 || index >= get_tile_count(tiled)) {
+        return false;
+    }
+
+    tile->index = index;
+    tile->tile_x = index % tiled->tiles_x;
+    tile->tile_y = index / tiled->tiles_x;
+    tile->x = tile->tile_x * tiled->tile_size;
+    tile->y = tile->tile_y * tiled->tile_size;
+    tile->width = (tiled->width - tile->x < tiled->tile_size) ? tiled->width - tile->x : tiled->tile_size;
+    tile->height = (tiled->height - tile->y < tiled->tile_size) ? tiled->height - tile->y : tiled->tile_size;
+    tile->stride = tiled->tile_stride;
+    tile->pixels = tiled->data + (size_t)index * tiled->tile_bytes +
+                   (size_t)tiled->halo * tiled->tile_stride + tiled->halo;
+    return true;
+}
+
+// Interior pixel at image coordinates (x, y), wherever its tile is
+static Uint8 tiled_pixel(const TiledGrayscaleImage* tiled, int x, int y) {
+    int tile_x = x / tiled->tile_size;
+    int tile_y = y / tiled->tile_size;
+    const Uint8* block = tiled->data + (size_t)(tile_y * tiled->tiles_x + tile_x) * tiled->tile_bytes;
+
+    int row = tiled->halo + y - tile_y * tiled->tile_size;
+    int column = tiled->halo + x - tile_x * tiled->tile_size;
+    return block[(size_t)row * tiled->tile_stride + column];
+}
+
+// ---------------------------------------------------------------------------
+// Tile scheduling
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    const TiledGrayscaleImage* tiled;
+    GrayTileFunc func;
+    void* context;
+} TileRunJob;
+
+// Bands are runs of consecutive tiles, i.e. whole tile rows for wide images
+static void tile_band(void* context, int band, int row_begin, int row_end) {
+    TileRunJob* job = (TileRunJob*)context;
+
+    for (int index = row_begin; index < row_end; index++) {
+        GrayTile tile;
+        get_tile(job->tiled, index, &tile);
+        job->func(job->context, band, &tile);
+    }
+}
+
+int get_tile_band_count(const TiledGrayscaleImage* tiled) {
+    return thread_pool_get_band_count(get_analysis_pool(), get_tile_count(tiled));
+}
+
+int run_tiles(const TiledGrayscaleImage* tiled, GrayTileFunc func, void* context) {
+    if (!tiled || !tiled->data || !func) {
+        return 0;
+    }
+
+    TileRunJob job;
+    job.tiled = tiled;
+    job.func = func;
+    job.context = context;
+    return thread_pool_run_bands(get_analysis_pool(), get_tile_count(tiled), tile_band, &job);
+}
+
+// ---------------------------------------------------------------------------
+// Halos
+// ---------------------------------------------------------------------------
+
+// Only halo bytes are written and only interiors are read, so tiles can be
+// refilled in parallel
+static void fill_halo(void* context, int band, const GrayTile* tile) {
+    const TiledGrayscaleImage* tiled = (const TiledGrayscaleImage*)context;
+    int halo = tiled->halo;
+    (void)band;
+
+    for (int r = -halo; r < tile->height + halo; r++) {
+        Uint8* row = tile->pixels + (ptrdiff_t)r * tile->stride;
+        int y = clamp_int(tile->y + r, 0, tiled->height - 1);
+        bool interior_row = (r >= 0 && r < tile->height);
+
+        for (int c = -halo; c < tile->width + halo; c++) {
+            if (interior_row && c >= 0 && c < tile->width) {
+                c = tile->width - 1;    // Skip the interior of the row
+                continue;
+            }
+            int x = clamp_int(tile->x + c, 0, tiled->width - 1);
+            row[c] = tiled_pixel(tiled, x, y);
+        }
+    }
+}
+
+void update_tile_halos(TiledGrayscaleImage* tiled) {
+    if (!tiled || !tiled->data || tiled->halo == 0) {
+        return;
+    }
+    run_tiles(tiled, fill_halo, tiled);
+}
+
+// ---------------------------------------------------------------------------
+// Row-major <-> tiled
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    const TiledGrayscaleImage* tiled;
+    const Uint8* pixels;    // Row-major image
+    Uint8* dst;
+} TileCopyJob;
+
+// Copy a tile and its halo from the row-major image, clamping at the edges
+static void tile_from_rows(void* context, int band, const GrayTile* tile) {
+    const TileCopyJob* job = (const TileCopyJob*)context;
+    const TiledGrayscaleImage* tiled = job->tiled;
+    int halo = tiled->halo;
+    int width = tiled->width;
+    (void)band;
+
+    // Columns [first, end) of the tile block lie inside the image
+    int first = (tile->x - halo < 0) ? -tile->x : -halo;
+    int end = (tile->x + tile->width + halo > width) ? width - tile->x : tile->width + halo;
+
+    for (int r = -halo; r < tile->height + halo; r++) {
+        int y = clamp_int(tile->y + r, 0, tiled->height - 1);
+        const Uint8* src = job->pixels + (size_t)y * width + tile->x;
+        Uint8* row = tile->pixels + (ptrdiff_t)r * tile->stride;
+
+        memcpy(row + first, src + first, (size_t)(end - first));
+        if (first > -halo) {
+            memset(row - halo, src[first], (size_t)(first + halo));
+        }
+        if (end < tile->width + halo) {
+            memset(row + end, src[end - 1], (size_t)(tile->width + halo - end));
+        }
+    }
+}
+
+static void tile_to_rows(void* context, int band, const GrayTile* tile) {
+    const TileCopyJob* job = (const TileCopyJob*)context;
+    int width = job->tiled->width;
+    (void)band;
+
+    for (int r = 0; r < tile->height; r++) {
+        memcpy(job->dst + (size_t)(tile->y + r) * width + tile->x,
+               tile->pixels + (size_t)r * tile->stride, (size_t)tile->width);
+    }
+}
+
+bool tile_grayscale_image(const GrayscaleImage* grayscale_image, TiledGrayscaleImage* tiled, int tile_size, int halo) {
+    if (!grayscale_image || !grayscale_image->pixels || !tiled) {
+        return false;
+    }
+    if (!init_tiled_image(tiled, grayscale_image->width, grayscale_image->height, tile_size, halo)) {
+        return false;
+    }
+
+    TileCopyJob job;
+    job.tiled = tiled;
+    job.pixels = grayscale_image->pixels;
+    job.dst = NULL;
+    run_tiles(tiled, tile_from_rows, &job);
+    return true;
+}
+
+bool untile_grayscale_image(const TiledGrayscaleImage* tiled, GrayscaleImage* grayscale_image) {
+    if (!tiled || !tiled->data || !grayscale_image) {
+        return false;
+    }
+
+    if (!create_grayscale_image(grayscale_image, tiled->width, tiled->height, NULL)) {
+        return false;
+    }
+
+    TileCopyJob job;
+    job.tiled = tiled;
+    job.pixels = NULL;
+    job.dst = grayscale_image->pixels;
+    run_tiles(tiled, tile_to_rows, &job);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Point kernels on the tiled layout
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    const TiledGrayscaleImage* tiled;
+    const GrayscaleConverter* converter;
+    const Uint8* src;
+    int pitch;
+    SDL_atomic_t failed;    // Set if a band could not get its scratch row
+} TileConvertJob;
+
+// Bands are runs of image rows: each surface row is converted whole into a
+// scratch row (full-length kernel runs, no per-span tails) and then split
+// into tile-wide spans that land in consecutive tiles
+static void convert_tile_rows(void* context, int band, int row_begin, int row_end) {
+    TileConvertJob* job = (TileConvertJob*)context;
+    const TiledGrayscaleImage* tiled = job->tiled;
+    const GrayscaleConverter* converter = job->converter;
+    (void)band;
+
+    Uint8* scratch = malloc((size_t)tiled->width);
+    if (!scratch) {
+        SDL_AtomicSet(&job->failed, 1);
+        return;
+    }
+
+    for (int y = row_begin; y < row_end; y++) {
+        converter->kernel(converter, job->src + (size_t)y * job->pitch, scratch, tiled->width);
+
+        int tile_y = y / tiled->tile_size;
+        GrayTile first;
+        get_tile(tiled, tile_y * tiled->tiles_x, &first);
+        Uint8* dst = first.pixels + (size_t)(y - first.y) * first.stride;
+
+        for (int tile_x = 0; tile_x < tiled->tiles_x; tile_x++) {
+            int x = tile_x * tiled->tile_size;
+            int width = (tiled->width - x < tiled->tile_size) ? tiled->width - x : tiled->tile_size;
+            memcpy(dst + (size_t)tile_x * tiled->tile_bytes, scratch + x, (size_t)width);
+        }
+    }
+
+    free(scratch);
+}
+
+bool convert_to_grayscale_tiled(const ImageData* image_data, TiledGrayscaleImage* tiled, int tile_size, int halo) {
+    if (!image_data || !image_data->surface || !tiled) {
+        return false;
+    }
+
+    SDL_Surface* surface = image_data->surface;
+    GrayscaleConverter converter;
+    if (!init_grayscale_converter(&converter, surface->format)) {
+        return false;
+    }
+    if (!init_tiled_image(tiled, surface->w, surface->h, tile_size, halo)) {
+        return false;
+    }
+
+    PROFILE_START(convert_start);
+    SDL_LockSurface(surface);
+
+    TileConvertJob job;
+    job.tiled = tiled;
+    job.converter = &converter;
+    job.src = (const Uint8*)surface->pixels;
+    job.pitch = surface->pitch;
+    SDL_AtomicSet(&job.failed, 0);
+    thread_pool_run_bands(get_analysis_pool(), tiled->height, convert_tile_rows, &job);
+
+    SDL_UnlockSurface(surface);
+    if (SDL_AtomicGet(&job.failed)) {
+        free_tiled_image(tiled);
+        return false;
+    }
+    update_tile_halos(tiled);
+    PROFILE_STOP(PROFILE_STAGE_CONVERT, convert_start, (size_t)surface->h * surface->pitch);
+    return true;
+}
+
+typedef struct {
+    GrayscaleHistogram histogram;
+    HistogramAccumulator accumulator;
+} BandCounts;
+
+static void count_tile(void* context, int band, const GrayTile* tile) {
+    BandCounts* counts = &((BandCounts*)context)[band];
+
+    for (int r = 0; r < tile->height; r++) {
+        histogram_accumulator_add(&counts->accumulator, &counts->histogram,
+                                  tile->pixels + (size_t)r * tile->stride, (size_t)tile->width);
+    }
+}
+
+bool calculate_tiled_histogram(const TiledGrayscaleImage* tiled, GrayscaleHistogram* histogram) {
+    if (!tiled || !tiled->data || !histogram) {
+        return false;
+    }
+
+    int band_count = get_tile_band_count(tiled);
+    BandCounts* counts = malloc((size_t)band_count * sizeof(BandCounts));
+    if (!counts) {
+        return false;
+    }
+    for (int band = 0; band < band_count; band++) {
+        histogram_reset(&counts[band].histogram);
+        histogram_accumulator_reset(&counts[band].accumulator);
+    }
+
+    PROFILE_START(stats_start);
+    int bands = run_tiles(tiled, count_tile, counts);
+
+    histogram_reset(histogram);
+    for (int band = 0; band < bands; band++) {
+        histogram_accumulator_flush(&counts[band].accumulator, &counts[band].histogram);
+        histogram_merge(histogram, &counts[band].histogram);
+    }
+    PROFILE_STOP(PROFILE_STAGE_STATS, stats_start, (size_t)tiled->width * tiled->height);
+
+    free(counts);
+    return true;
+}
+
+bool calculate_tiled_stats(const TiledGrayscaleImage* tiled, ImageAnalysis* analysis) {
+    if (!tiled || !analysis) {
+        return false;
+    }
+
+    analysis->width = tiled->width;
+    analysis->height = tiled->height;
+    analysis->color_type = COLOR_TYPE_GRAYSCALE;
+    analysis->is_grayscale = true;
+    analysis->has_transparency = false;
+
+    GrayscaleHistogram histogram;
+    if (!calculate_tiled_histogram(tiled, &histogram)) {
+        return false;
+    }
+
+    apply_histogram_stats(&histogram, analysis);
+    return true;
+}
@@ -0,0 +1,157 @@
+#ifndef GRAY_TILES_H
+#define GRAY_TILES_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include "image_analysis.h"
+#include "histogram.h"
+
+// Default tile edge in pixels (a 64x64 tile is 4 KB, one page)
+#define GRAY_TILE_SIZE 64
+
+// Tiled grayscale image
+// The image is cut into tile_size x tile_size tiles stored one after the
+// other, row-major in tile order; each tile is surrounded by a halo of
+// border pixels copied from its neighbors (clamped at the image edges), so a
+// neighborhood of up to halo pixels around any pixel of a tile is read from
+// that tile's block only
+typedef struct {
+    Uint8* data;            // Tile blocks (64-byte aligned, from the buffer pool)
+    size_t data_size;
+    int width;              // Image size in pixels
+    int height;
+    int tile_size;          // Tile edge in pixels
+    int halo;               // Border pixels around each tile
+    int tile_stride;        // Bytes per row inside a tile block (tile_size + 2 * halo)
+    size_t tile_bytes;      // Bytes per tile block (rounded up to 64)
+    int tiles_x;            // Tiles per row / column of the image
+    int tiles_y;
+    BufferPool* pool;       // Pool owning data
+} TiledGrayscaleImage;
+
+// One tile, as seen by iterators and tile callbacks
+typedef struct {
+    int index;              // Tile index (tile_y * tiles_x + tile_x)
+    int tile_x;
+    int tile_y;
+    int x;                  // Image coordinates of the first pixel
+    int y;
+    int width;              // Pixels of the image in the tile (smaller on the right/bottom edges)
+    int height;
+    Uint8* pixels;          // First pixel; pixels[-halo * stride - halo] is the halo corner
+    int stride;             // Bytes between rows
+} GrayTile;
+
+/**
+ * Tile callback for run_tiles
+ * @param context User pointer passed to run_tiles
+ * @param band Band of tiles being processed (0 to band count - 1), for per-band results
+ * @param tile Tile to process
+ */
+typedef void (*GrayTileFunc)(void* context, int band, const GrayTile* tile);
+
+/**
+ * Allocate an uninitialized tiled image
+ * @param tiled Tiled image to initialize
+ * @param width Image width
+ * @param height Image height
+ * @param tile_size Tile edge (0 = GRAY_TILE_SIZE)
+ * @param halo Border pixels around each tile (0 to tile_size)
+ * @return true on success, false on invalid size or out of memory
+ */
+bool init_tiled_image(TiledGrayscaleImage* tiled, int width, int height, int tile_size, int halo);
+
+/**
+ * Free a tiled image
+ * @param tiled Tiled image to free
+ */
+void free_tiled_image(TiledGrayscaleImage* tiled);
+
+/**
+ * Get the number of tiles
+ * @param tiled Tiled image
+ * @return tiles_x * tiles_y
+ */
+int get_tile_count(const TiledGrayscaleImage* tiled);
+
+/**
+ * Get a tile by index; iterate with index from 0 to get_tile_count() - 1
+ * @param tiled Tiled image
+ * @param index Tile index
+ * @param tile Pointer to store the tile
+ * @return true on success, false if index is out of range
+ */
+bool get_tile(const TiledGrayscaleImage* tiled, int index, GrayTile* tile);
+
+/**
+ * Run func on every tile, split in bands of consecutive tiles over the
+ * analysis thread pool; blocks until all tiles are done
+ * @param tiled Tiled image
+ * @param func Tile callback
+ * @param context User pointer passed to func
+ * @return Number of bands used (see get_tile_band_count)
+ */
+int run_tiles(const TiledGrayscaleImage* tiled, GrayTileFunc func, void* context);
+
+/**
+ * Get the number of bands run_tiles will use, to size per-band results
+ * @param tiled Tiled image
+ * @return Band count (at least 1)
+ */
+int get_tile_band_count(const TiledGrayscaleImage* tiled);
+
+/**
+ * Refill every tile's halo from the neighboring tiles
+ * Call after writing tile interiors when neighborhood reads will follow
+ * @param tiled Tiled image
+ */
+void update_tile_halos(TiledGrayscaleImage* tiled);
+
+/**
+ * Convert a row-major grayscale image to the tiled layout (halos filled)
+ * @param grayscale_image Source image
+ * @param tiled Tiled image to create
+ * @param tile_size Tile edge (0 = GRAY_TILE_SIZE)
+ * @param halo Border pixels around each tile
+ * @return true on success, false on failure
+ */
+bool tile_grayscale_image(const GrayscaleImage* grayscale_image, TiledGrayscaleImage* tiled, int tile_size, int halo);
+
+/**
+ * Convert a tiled image back to a row-major grayscale image
+ * @param tiled Source tiled image
+ * @param grayscale_image Pointer to store the result (free with free_grayscale_image)
+ * @return true on success, false on failure
+ */
+bool untile_grayscale_image(const TiledGrayscaleImage* tiled, GrayscaleImage* grayscale_image);
+
+/**
+ * Convert an image to grayscale straight into the tiled layout
+ * Works in bands of image rows: each row is converted whole with the same
+ * luminance kernels as convert_to_grayscale, then split into tile-wide spans
+ * written to the tiles of its tile row; halos are filled afterwards
+ * @param image_data Source image data
+ * @param tiled Tiled image to create
+ * @param tile_size Tile edge (0 = GRAY_TILE_SIZE)
+ * @param halo Border pixels around each tile
+ * @return true on success, false on failure
+ */
+bool convert_to_grayscale_tiled(const ImageData* image_data, TiledGrayscaleImage* tiled, int tile_size, int halo);
+
+/**
+ * Count the intensities of a tiled image, tile by tile
+ * @param tiled Tiled image
+ * @param histogram Pointer to store the histogram
+ * @return true on success, false on failure
+ */
+bool calculate_tiled_histogram(const TiledGrayscaleImage* tiled, GrayscaleHistogram* histogram);
+
+/**
+ * Calculate statistics of a tiled image (same results as calculate_grayscale_stats)
+ * @param tiled Tiled image
+ * @param analysis Pointer to store statistics
+ * @return true on success, false on failure
+ */
+bool calculate_tiled_stats(const TiledGrayscaleImage* tiled, ImageAnalysis* analysis);
+
+#endif // GRAY_TILES_H
@@ -0,0 +1,168 @@
+#include "gray_view.h"
+#include "gray_png.h"
+#include "histogram.h"
+#include "thread_pool.h"
+#include "profiler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool make_gray_view(Uint8* pixels, int width, int height, size_t stride, GrayView* view) {
+    if (!pixels || width <= 0 || height <= 0 || stride < (size_t)width || !view) {
+        fprintf(stderr, "Invalid parameters passed to make_gray_view\n");
+        return false;
+    }
+
+    view->pixels = pixels;
+    view->width = width;
+    view->height = height;
+    view->stride = stride;
+    return true;
+}
+
+bool gray_subview(const GrayView* parent, int x, int y, int width, int height, GrayView* view) {
+    if (!parent || !parent->pixels || !view) {
+        fprintf(stderr, "Invalid parameters passed to gray_subview\n");
+        return false;
+    }
+
+    // Written so no sum can overflow: x + width <= parent->width
+    if (x < 0 || y < 0 || width <= 0 || height <= 0 ||
+        x > parent->width - width || y > parent->height - height) {
+        return false;
+    }
+
+    Uint8* pixels = parent->pixels + (size_t)y * parent->stride + (size_t)x;
+    view->stride = parent->stride;
+    view->pixels = pixels;
+    view->width = width;
+    view->height = height;
+    return true;
+}
+
+bool gray_image_subview(const GrayscaleImage* grayscale_image, int x, int y, int width, int height, GrayView* view) {
+    if (!grayscale_image || !grayscale_image->pixels) {
+        fprintf(stderr, "Invalid parameters passed to gray_image_subview\n");
+        return false;
+    }
+
+    GrayView whole = gray_view_of_image(grayscale_image);
+    return gray_subview(&whole, x, y, width, height, view);
+}
+
+void fill_gray_view(const GrayView* view, Uint8 value) {
+    if (!view || !view->pixels) {
+        return;
+    }
+
+    if (view->stride == (size_t)view->width) {
+        memset(view->pixels, value, (size_t)view->width * (size_t)view->height);
+        return;
+    }
+
+    for (int y = 0; y < view->height; y++) {
+        memset(gray_view_row(view, y), value, (size_t)view->width);
+    }
+}
+
+bool copy_gray_view(const GrayView* source, const GrayView* destination) {
+    if (!source || !source->pixels || !destination || !destination->pixels) {
+        return false;
+    }
+
+    if (source->width != destination->width || source->height != destination->height) {
+        fprintf(stderr, "Cannot copy a %dx%d view into a %dx%d view\n",
+                source->width, source->height, destination->width, destination->height);
+        return false;
+    }
+
+    for (int y = 0; y < source->height; y++) {
+        memcpy(gray_view_row(destination, y), gray_view_row(source, y), (size_t)source->width);
+    }
+    return true;
+}
+
+bool gray_view_to_image(const GrayView* view, GrayscaleImage* grayscale_image) {
+    if (!view || !view->pixels || !grayscale_image) {
+        return false;
+    }
+
+    if (!create_grayscale_image(grayscale_image, view->width, view->height, NULL)) {
+        return false;
+    }
+
+    GrayView packed = gray_view_of_image(grayscale_image);
+    return copy_gray_view(view, &packed);
+}
+
+typedef struct {
+    GrayscaleHistogram histogram;
+    HistogramAccumulator accumulator;
+} ViewBandCounts;
+
+typedef struct {
+    const GrayView* view;
+    ViewBandCounts* counts;     // One per band, merged after the run
+} ViewHistogramJob;
+
+// Rows are not contiguous, so they go through the banked accumulator, which
+// keeps counting across rows instead of flushing the banks after each one
+static void view_histogram_band(void* context, int band, int row_begin, int row_end) {
+    ViewHistogramJob* job = (ViewHistogramJob*)context;
+    const GrayView* view = job->view;
+    ViewBandCounts* counts = &job->counts[band];
+
+    histogram_reset(&counts->histogram);
+    histogram_accumulator_reset(&counts->accumulator);
+    for (int y = row_begin; y < row_end; y++) {
+        histogram_accumulator_add(&counts->accumulator, &counts->histogram,
+                                  gray_view_row(view, y), (size_t)view->width);
+    }
+    histogram_accumulator_flush(&counts->accumulator, &counts->histogram);
+}
+
+bool calculate_gray_view_stats(const GrayView* view, ImageAnalysis* analysis) {
+    if (!view || !view->pixels || !analysis) {
+        return false;
+    }
+
+    ThreadPool* pool = get_analysis_pool();
+    ViewHistogramJob job;
+    job.view = view;
+    job.counts = malloc((size_t)thread_pool_get_band_count(pool, view->height) * sizeof(ViewBandCounts));
+    if (!job.counts) {
+        return false;
+    }
+
+    PROFILE_START(stats_start);
+    int bands = thread_pool_run_bands(pool, view->height, view_histogram_band, &job);
+
+    GrayscaleHistogram histogram;
+    histogram_reset(&histogram);
+    for (int band = 0; band < bands; band++) {
+        histogram_merge(&histogram, &job.counts[band].histogram);
+    }
+    PROFILE_STOP(PROFILE_STAGE_STATS, stats_start, (size_t)view->width * (size_t)view->height);
+    free(job.counts);
+
+    analysis->width = view->width;
+    analysis->height = view->height;
+    analysis->color_type = COLOR_TYPE_GRAYSCALE;
+    analysis->is_grayscale = true;
+    analysis->has_transparency = false;
+    apply_histogram_stats(&histogram, analysis);
+    return true;
+}
+
+bool save_gray_view(const GrayView* view, const char* filename) {
+    if (!view || !view->pixels || !filename) {
+        fprintf(stderr, "Invalid parameters passed to save_gray_view\n");
+        return false;
+    }
+
+    // The encoder takes a stride, so a crop is written without a packed copy
+    PROFILE_START(encode_start);
+    bool ok = write_gray_png(filename, view->pixels, view->width, view->height, view->stride);
+    PROFILE_STOP(PROFILE_STAGE_ENCODE, encode_start, (size_t)view->width * (size_t)view->height);
+    return ok;
+}
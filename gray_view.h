@@ -0,0 +1,190 @@
+#ifndef GRAY_VIEW_H
+#define GRAY_VIEW_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "image_analysis.h"
+
+// Row and pixel access without per-call checks, for hot loops
+// The accessors below are inline and do no validation, so a loop over them
+// compiles to the same code as a loop over raw pointers. Debug builds
+// (make debug, which defines DEBUG) assert every coordinate instead; the
+// checked get_grayscale_pixel/set_grayscale_pixel remain for callers that
+// want out-of-range reads to return 0
+#ifdef DEBUG
+#include <assert.h>
+#define GRAY_VIEW_ASSERT(condition) assert(condition)
+#else
+#define GRAY_VIEW_ASSERT(condition) ((void)0)
+#endif
+
+// Non-owning window over 8-bit gray pixels (a whole image, a crop of one, or
+// any buffer with padded rows); rows are stride bytes apart. Views never
+// allocate and never free: the pixels belong to whatever they were made from
+typedef struct {
+    Uint8* pixels;          // First pixel of the first row
+    int width;
+    int height;
+    size_t stride;          // Bytes between the start of consecutive rows (>= width)
+} GrayView;
+
+/**
+ * Get a row of a grayscale image (rows are width bytes apart)
+ * @param grayscale_image Grayscale image
+ * @param y Row (0 to height-1, not checked)
+ * @return First pixel of the row
+ */
+static inline Uint8* gray_image_row(const GrayscaleImage* grayscale_image, int y) {
+    GRAY_VIEW_ASSERT(grayscale_image && grayscale_image->pixels && y >= 0 && y < grayscale_image->height);
+    return grayscale_image->pixels + (size_t)y * (size_t)grayscale_image->width;
+}
+
+/**
+ * Read a pixel of a grayscale image without bounds checks
+ * @param grayscale_image Grayscale image
+ * @param x Column (0 to width-1, not checked)
+ * @param y Row (0 to height-1, not checked)
+ * @return Pixel value
+ */
+static inline Uint8 gray_image_at(const GrayscaleImage* grayscale_image, int x, int y) {
+    GRAY_VIEW_ASSERT(x >= 0 && x < grayscale_image->width);
+    return gray_image_row(grayscale_image, y)[x];
+}
+
+/**
+ * Write a pixel of a grayscale image without bounds checks
+ * @param grayscale_image Grayscale image
+ * @param x Column (0 to width-1, not checked)
+ * @param y Row (0 to height-1, not checked)
+ * @param value Pixel value
+ */
+static inline void gray_image_put(GrayscaleImage* grayscale_image, int x, int y, Uint8 value) {
+    GRAY_VIEW_ASSERT(x >= 0 && x < grayscale_image->width);
+    gray_image_row(grayscale_image, y)[x] = value;
+}
+
+/**
+ * Get a view covering a whole grayscale image
+ * @param grayscale_image Grayscale image
+ * @return View over its pixels
+ */
+static inline GrayView gray_view_of_image(const GrayscaleImage* grayscale_image) {
+    GrayView view;
+    view.pixels = grayscale_image->pixels;
+    view.width = grayscale_image->width;
+    view.height = grayscale_image->height;
+    view.stride = (size_t)grayscale_image->width;
+    return view;
+}
+
+/**
+ * Get a row of a view
+ * @param view View
+ * @param y Row (0 to height-1, not checked)
+ * @return First pixel of the row
+ */
+static inline Uint8* gray_view_row(const GrayView* view, int y) {
+    GRAY_VIEW_ASSERT(view && view->pixels && y >= 0 && y < view->height);
+    return view->pixels + (size_t)y * view->stride;
+}
+
+/**
+ * Read a pixel of a view without bounds checks
+ * @param view View
+ * @param x Column (0 to width-1, not checked)
+ * @param y Row (0 to height-1, not checked)
+ * @return Pixel value
+ */
+static inline Uint8 gray_view_at(const GrayView* view, int x, int y) {
+    GRAY_VIEW_ASSERT(x >= 0 && x < view->width);
+    return gray_view_row(view, y)[x];
+}
+
+/**
+ * Write a pixel of a view without bounds checks
+ * @param view View
+ * @param x Column (0 to width-1, not checked)
+ * @param y Row (0 to height-1, not checked)
+ * @param value Pixel value
+ */
+static inline void gray_view_put(const GrayView* view, int x, int y, Uint8 value) {
+    GRAY_VIEW_ASSERT(x >= 0 && x < view->width);
+    gray_view_row(view, y)[x] = value;
+}
+
+/**
+ * Make a view over any buffer of gray rows
+ * @param pixels First pixel of the first row
+ * @param width Pixels per row
+ * @param height Number of rows
+ * @param stride Bytes between rows (at least width)
+ * @param view Pointer to store the view
+ * @return true on success, false on invalid parameters
+ */
+bool make_gray_view(Uint8* pixels, int width, int height, size_t stride, GrayView* view);
+
+/**
+ * Make a view over a rectangle of another view, without copying
+ * @param parent View to crop
+ * @param x Left column of the rectangle
+ * @param y Top row of the rectangle
+ * @param width Rectangle width
+ * @param height Rectangle height
+ * @param view Pointer to store the view (may be parent)
+ * @return true on success, false if the rectangle is empty or leaves the parent
+ */
+bool gray_subview(const GrayView* parent, int x, int y, int width, int height, GrayView* view);
+
+/**
+ * Make a view over a rectangle of a grayscale image, without copying
+ * @param grayscale_image Image to crop
+ * @param x Left column of the rectangle
+ * @param y Top row of the rectangle
+ * @param width Rectangle width
+ * @param height Rectangle height
+ * @param view Pointer to store the view
+ * @return true on success, false if the rectangle is empty or leaves the image
+ */
+bool gray_image_subview(const GrayscaleImage* grayscale_image, int x, int y, int width, int height, GrayView* view);
+
+/**
+ * Set every pixel of a view
+ * @param view View to fill
+ * @param value Pixel value
+ */
+void fill_gray_view(const GrayView* view, Uint8 value);
+
+/**
+ * Copy the pixels of one view into another of the same size
+ * @param source View to read
+ * @param destination View to write (must not overlap source)
+ * @return true on success, false if the sizes differ
+ */
+bool copy_gray_view(const GrayView* source, const GrayView* destination);
+
+/**
+ * Copy a view into a new, packed grayscale image
+ * @param view View to copy
+ * @param grayscale_image Pointer to store the image (free with free_grayscale_image)
+ * @return true on success, false on failure
+ */
+bool gray_view_to_image(const GrayView* view, GrayscaleImage* grayscale_image);
+
+/**
+ * Compute the statistics of the pixels of a view
+ * @param view View to analyze
+ * @param analysis Pointer to store the statistics (width/height of the view)
+ * @return true on success, false on failure
+ */
+bool calculate_gray_view_stats(const GrayView* view, ImageAnalysis* analysis);
+
+/**
+ * Save a view as a grayscale PNG straight from its rows
+ * @param view View to save
+ * @param filename Output path
+ * @return true on success, false on failure
+ */
+bool save_gray_view(const GrayView* view, const char* filename);
+
+#endif // GRAY_VIEW_H
@@ -0,0 +1,578 @@
+#include "grayscale_simd.h"
+#include "cpu_features.h"
+#include <string.h>
+
+// Exact .5 ties of the integer formula are where the original double
+// expression may round either way, so they are settled by the same expression
+static Uint8 luminance_tie(Uint8 r, Uint8 g, Uint8 b) {
+    double gray = 0.2125 * r + 0.7154 * g + 0.0721 * b;
+    return (Uint8)(gray + 0.5);
+}
+
+Uint8 luminance_from_rgb(Uint8 r, Uint8 g, Uint8 b) {
+    unsigned int t = LUMA_WEIGHT_R * r + LUMA_WEIGHT_G * g + LUMA_WEIGHT_B * b + LUMA_SCALE / 2;
+    unsigned int q = t / LUMA_SCALE;
+
+    if (q * LUMA_SCALE == t) {
+        return luminance_tie(r, g, b);
+    }
+    return (Uint8)q;
+}
+
+// ---------------------------------------------------------------------------
+// Packed layouts
+// A packed layout is described by its pixel size, the byte offset of its
+// first color channel (0, or 1 when alpha/padding comes first) and whether
+// the channels are stored R,G,B or B,G,R. Every kernel below is specialized on
+// these constants by a thin wrapper, so no layout test runs per pixel.
+// ---------------------------------------------------------------------------
+
+static inline void gray_row_packed_scalar(const Uint8* src, Uint8* dst, int width,
+                                          int bpp, int first, bool bgr) {
+    const int ro = bgr ? first + 2 : first;
+    const int bo = bgr ? first : first + 2;
+    const int go = first + 1;
+
+    for (int x = 0; x < width; x++) {
+        const Uint8* p = src + x * bpp;
+        dst[x] = luminance_from_rgb(p[ro], p[go], p[bo]);
+    }
+}
+
+// Largest difference between two of the color channels, i.e. max(|R-G|,
+// |G-B|, |R-B|); 0 for a neutral gray
+static inline int channel_spread(Uint8 a, Uint8 b, Uint8 c) {
+    Uint8 hi = a > b ? a : b;
+    Uint8 lo = a > b ? b : a;
+    hi = c > hi ? c : hi;
+    lo = c < lo ? c : lo;
+    return hi - lo;
+}
+
+// The check only needs where the three channels start, not their order
+static inline bool check_row_packed_scalar(const Uint8* src, int width, int bpp, int first, int tolerance) {
+    for (int x = 0; x < width; x++) {
+        const Uint8* p = src + x * bpp + first;
+        if (channel_spread(p[0], p[1], p[2]) > tolerance) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static inline void patch_ties(const Uint8* src, Uint8* dst, int tie_mask,
+                              int bpp, int first, bool bgr) {
+    const int ro = bgr ? first + 2 : first;
+    const int bo = bgr ? first : first + 2;
+    const int go = first + 1;
+
+    for (int i = 0; tie_mask; i++, tie_mask >>= 1) {
+        if (tie_mask & 1) {
+            const Uint8* p = src + i * bpp;
+            dst[i] = luminance_tie(p[ro], p[go], p[bo]);
+        }
+    }
+}
+
+#ifdef CPU_FEATURES_X86
+
+// ---------------------------------------------------------------------------
+// Vector kernels
+// Each 32-bit lane holds one pixel, shifted so its color bytes are [C0, G, C2].
+// Masking with 0x00FF00FF leaves C0 and C2 as the two 16-bit halves of the
+// lane, so a single pmaddwd yields 2125*R + 721*B (weights swapped for B,G,R);
+// G is added with a second pmaddwd. The sum (< 2^22) is divided by 10000
+// through a float multiply, which is exact over that range. Lanes that land on
+// an exact .5 tie are patched by the scalar code.
+// ---------------------------------------------------------------------------
+
+// Spread 4 packed RGB24 triples into 32-bit lanes (the load covers 5 pixels)
+TARGET_SSE2
+static inline __m128i load_rgb24_lanes_sse2(const Uint8* p) {
+    __m128i v = _mm_loadu_si128((const __m128i*)p);
+    __m128i p01 = _mm_unpacklo_epi32(v, _mm_srli_si128(v, 3));
+    __m128i p23 = _mm_unpacklo_epi32(_mm_srli_si128(v, 6), _mm_srli_si128(v, 9));
+    return _mm_unpacklo_epi64(p01, p23);
+}
+
+TARGET_SSE2
+static inline __m128i luma_lanes_sse2(__m128i px, bool bgr, int* tie_mask) {
+    const __m128i mask_rb = _mm_set1_epi32(0x00FF00FF);
+    const __m128i mask_lo = _mm_set1_epi32(0x000000FF);
+    const __m128i weight_rb = bgr ? _mm_set1_epi32((LUMA_WEIGHT_R << 16) | LUMA_WEIGHT_B)
+                                  : _mm_set1_epi32((LUMA_WEIGHT_B << 16) | LUMA_WEIGHT_R);
+    const __m128i weight_g = _mm_set1_epi32(LUMA_WEIGHT_G);
+    const __m128i scale = _mm_set1_epi32(LUMA_SCALE);
+    const __m128i bias = _mm_set1_epi32(LUMA_SCALE / 2);
+    const __m128 inv_scale = _mm_set1_ps(1.0f / LUMA_SCALE);
+
+    __m128i rb = _mm_and_si128(px, mask_rb);
+    __m128i g = _mm_and_si128(_mm_srli_epi32(px, 8), mask_lo);
+    __m128i t = _mm_add_epi32(_mm_madd_epi16(rb, weight_rb), _mm_madd_epi16(g, weight_g));
+    t = _mm_add_epi32(t, bias);
+
+    __m128i q = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(t), inv_scale));
+    __m128i tie = _mm_cmpeq_epi32(_mm_madd_epi16(q, scale), t);
+    *tie_mask = _mm_movemask_ps(_mm_castsi128_ps(tie));
+    return q;
+}
+
+TARGET_SSE2
+static inline void store_luma4_sse2(Uint8* dst, __m128i q) {
+    __m128i words = _mm_packs_epi32(q, q);
+    __m128i packed = _mm_packus_epi16(words, words);
+    int value = _mm_cvtsi128_si32(packed);
+    memcpy(dst, &value, 4);
+}
+
+TARGET_SSE2
+static inline void gray_row_packed_sse2(const Uint8* src, Uint8* dst, int width,
+                                        int bpp, int first, bool bgr) {
+    int x = 0;
+
+    if (bpp == 3) {
+        // A 16-byte load covers 5 pixels, stop early enough not to read past the row
+        for (; x + 6 <= width; x += 4) {
+            __m128i px = load_rgb24_lanes_sse2(src + x * 3);
+
+            int tie_mask;
+            store_luma4_sse2(dst + x, luma_lanes_sse2(px, bgr, &tie_mask));
+            patch_ties(src + x * 3, dst + x, tie_mask, 3, 0, bgr);
+        }
+    } else {
+        for (; x + 4 <= width; x += 4) {
+            __m128i px = _mm_loadu_si128((const __m128i*)(src + x * 4));
+            if (first) {
+                px = _mm_srli_epi32(px, 8);
+            }
+
+            int tie_mask;
+            store_luma4_sse2(dst + x, luma_lanes_sse2(px, bgr, &tie_mask));
+            patch_ties(src + x * 4, dst + x, tie_mask, 4, first, bgr);
+        }
+    }
+
+    gray_row_packed_scalar(src + x * bpp, dst + x, width - x, bpp, first, bgr);
+}
+
+// Spread 8 packed RGB24 triples into 32-bit lanes; the upper 16-byte load
+// starts at pixel 4, so 10 pixels must be readable
+TARGET_AVX2
+static inline __m256i load_rgb24_lanes_avx2(const Uint8* p) {
+    const __m256i spread = _mm256_setr_epi8(
+        0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+        0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+
+    __m256i v = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)p)),
+        _mm_loadu_si128((const __m128i*)(p + 12)), 1);
+    return _mm256_shuffle_epi8(v, spread);
+}
+
+TARGET_AVX2
+static inline __m256i luma_lanes_avx2(__m256i px, bool bgr, int* tie_mask) {
+    const __m256i mask_rb = _mm256_set1_epi32(0x00FF00FF);
+    const __m256i mask_lo = _mm256_set1_epi32(0x000000FF);
+    const __m256i weight_rb = bgr ? _mm256_set1_epi32((LUMA_WEIGHT_R << 16) | LUMA_WEIGHT_B)
+                                  : _mm256_set1_epi32((LUMA_WEIGHT_B << 16) | LUMA_WEIGHT_R);
+    const __m256i weight_g = _mm256_set1_epi32(LUMA_WEIGHT_G);
+    const __m256i scale = _mm256_set1_epi32(LUMA_SCALE);
+    const __m256i bias = _mm256_set1_epi32(LUMA_SCALE / 2);
+    const __m256 inv_scale = _mm256_set1_ps(1.0f / LUMA_SCALE);
+
+    __m256i rb = _mm256_and_si256(px, mask_rb);
+    __m256i g = _mm256_and_si256(_mm256_srli_epi32(px, 8), mask_lo);
+    __m256i t = _mm256_add_epi32(_mm256_madd_epi16(rb, weight_rb), _mm256_madd_epi16(g, weight_g));
+    t = _mm256_add_epi32(t, bias);
+
+    __m256i q = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(t), inv_scale));
+    __m256i tie = _mm256_cmpeq_epi32(_mm256_madd_epi16(q, scale), t);
+    *tie_mask = _mm256_movemask_ps(_mm256_castsi256_ps(tie));
+    return q;
+}
+
+TARGET_AVX2
+static inline void store_luma8_avx2(Uint8* dst, __m256i q) {
+    __m128i words = _mm_packs_epi32(_mm256_castsi256_si128(q), _mm256_extracti128_si256(q, 1));
+    _mm_storel_epi64((__m128i*)dst, _mm_packus_epi16(words, words));
+}
+
+TARGET_AVX2
+static inline void gray_row_packed_avx2(const Uint8* src, Uint8* dst, int width,
+                                        int bpp, int first, bool bgr) {
+    int x = 0;
+
+    if (bpp == 3) {
+        // The upper 16-byte load starts at pixel x+4, keep it inside the row
+        for (; x + 10 <= width; x += 8) {
+            const Uint8* p = src + x * 3;
+            __m256i px = load_rgb24_lanes_avx2(p);
+
+            int tie_mask;
+            store_luma8_avx2(dst + x, luma_lanes_avx2(px, bgr, &tie_mask));
+            patch_ties(p, dst + x, tie_mask, 3, 0, bgr);
+        }
+    } else {
+        for (; x + 8 <= width; x += 8) {
+            __m256i px = _mm256_loadu_si256((const __m256i*)(src + x * 4));
+            if (first) {
+                px = _mm256_srli_epi32(px, 8);
+            }
+
+            int tie_mask;
+            store_luma8_avx2(dst + x, luma_lanes_avx2(px, bgr, &tie_mask));
+            patch_ties(src + x * 4, dst + x, tie_mask, 4, first, bgr);
+        }
+    }
+
+    gray_row_packed_scalar(src + x * bpp, dst + x, width - x, bpp, first, bgr);
+}
+
+// ---------------------------------------------------------------------------
+// Color check kernels
+// With one pixel per 32-bit lane ([C0, G, C2, x]), the lane shifted right by
+// 8 and 16 bits lines G and C2 up with C0, so byte 0 of max - min over the
+// three is the channel spread. Saturating subtraction of the tolerance leaves
+// a nonzero byte exactly for the pixels out of tolerance. Several vectors are
+// OR-ed before each exit test, so a row is checked 16 (SSE2) or 32 (AVX2)
+// pixels per branch.
+// ---------------------------------------------------------------------------
+
+TARGET_SSE2
+static inline __m128i excess_lanes_sse2(__m128i px, __m128i tolerance) {
+    __m128i g = _mm_srli_epi32(px, 8);
+    __m128i c2 = _mm_srli_epi32(px, 16);
+    __m128i hi = _mm_max_epu8(px, _mm_max_epu8(g, c2));
+    __m128i lo = _mm_min_epu8(px, _mm_min_epu8(g, c2));
+    __m128i spread = _mm_and_si128(_mm_sub_epi8(hi, lo), _mm_set1_epi32(0xFF));
+    return _mm_subs_epu8(spread, tolerance);
+}
+
+TARGET_SSE2
+static inline __m128i load_lanes_sse2(const Uint8* src, int x, int bpp, int first) {
+    if (bpp == 3) {
+        return load_rgb24_lanes_sse2(src + x * 3);
+    }
+    __m128i px = _mm_loadu_si128((const __m128i*)(src + x * 4));
+    return first ? _mm_srli_epi32(px, 8) : px;
+}
+
+TARGET_SSE2
+static inline bool any_set_sse2(__m128i v) {
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xFFFF;
+}
+
+TARGET_SSE2
+static inline bool check_row_packed_sse2(const Uint8* src, int width, int bpp, int first, int tolerance) {
+    const __m128i tol = _mm_set1_epi8((char)tolerance);
+    // RGB24 loads read 2 pixels past the 4 they use
+    const int slack = (bpp == 3) ? 2 : 0;
+    int x = 0;
+
+    for (; x + 16 + slack <= width; x += 16) {
+        __m128i excess = _mm_or_si128(
+            _mm_or_si128(excess_lanes_sse2(load_lanes_sse2(src, x, bpp, first), tol),
+                         excess_lanes_sse2(load_lanes_sse2(src, x + 4, bpp, first), tol)),
+            _mm_or_si128(excess_lanes_sse2(load_lanes_sse2(src, x + 8, bpp, first), tol),
+                         excess_lanes_sse2(load_lanes_sse2(src, x + 12, bpp, first), tol)));
+        if (any_set_sse2(excess)) {
+            return false;
+        }
+    }
+    for (; x + 4 + slack <= width; x += 4) {
+        if (any_set_sse2(excess_lanes_sse2(load_lanes_sse2(src, x, bpp, first), tol))) {
+            return false;
+        }
+    }
+
+    return check_row_packed_scalar(src + x * bpp, width - x, bpp, first, tolerance);
+}
+
+TARGET_AVX2
+static inline __m256i excess_lanes_avx2(__m256i px, __m256i tolerance) {
+    __m256i g = _mm256_srli_epi32(px, 8);
+    __m256i c2 = _mm256_srli_epi32(px, 16);
+    __m256i hi = _mm256_max_epu8(px, _mm256_max_epu8(g, c2));
+    __m256i lo = _mm256_min_epu8(px, _mm256_min_epu8(g, c2));
+    __m256i spread = _mm256_and_si256(_mm256_sub_epi8(hi, lo), _mm256_set1_epi32(0xFF));
+    return _mm256_subs_epu8(spread, tolerance);
+}
+
+TARGET_AVX2
+static inline __m256i load_lanes_avx2(const Uint8* src, int x, int bpp, int first) {
+    if (bpp == 3) {
+        return load_rgb24_lanes_avx2(src + x * 3);
+    }
+    __m256i px = _mm256_loadu_si256((const __m256i*)(src + x * 4));
+    return first ? _mm256_srli_epi32(px, 8) : px;
+}
+
+TARGET_AVX2
+static inline bool check_row_packed_avx2(const Uint8* src, int width, int bpp, int first, int tolerance) {
+    const __m256i tol = _mm256_set1_epi8((char)tolerance);
+    const int slack = (bpp == 3) ? 2 : 0;
+    int x = 0;
+
+    for (; x + 32 + slack <= width; x += 32) {
+        __m256i excess = _mm256_or_si256(
+            _mm256_or_si256(excess_lanes_avx2(load_lanes_avx2(src, x, bpp, first), tol),
+                            excess_lanes_avx2(load_lanes_avx2(src, x + 8, bpp, first), tol)),
+            _mm256_or_si256(excess_lanes_avx2(load_lanes_avx2(src, x + 16, bpp, first), tol),
+                            excess_lanes_avx2(load_lanes_avx2(src, x + 24, bpp, first), tol)));
+        if (!_mm256_testz_si256(excess, excess)) {
+            return false;
+        }
+    }
+    for (; x + 8 + slack <= width; x += 8) {
+        __m256i excess = excess_lanes_avx2(load_lanes_avx2(src, x, bpp, first), tol);
+        if (!_mm256_testz_si256(excess, excess)) {
+            return false;
+        }
+    }
+
+    return check_row_packed_scalar(src + x * bpp, width - x, bpp, first, tolerance);
+}
+
+#endif // CPU_FEATURES_X86
+
+// Specialized row kernels for one packed layout and instruction set
+#define DEFINE_PACKED_KERNEL(name, isa, bpp, first, bgr)                                         \
+    static void name##_##isa(const GrayscaleConverter* converter, const Uint8* src, Uint8* dst,  \
+                             int width) {                                                        \
+        (void)converter;                                                                         \
+        gray_row_packed_##isa(src, dst, width, bpp, first, bgr);                                 \
+    }
+
+#ifdef CPU_FEATURES_X86
+#define DEFINE_PACKED_KERNELS(name, bpp, first, bgr)    \
+    DEFINE_PACKED_KERNEL(name, scalar, bpp, first, bgr) \
+    TARGET_SSE2 DEFINE_PACKED_KERNEL(name, sse2, bpp, first, bgr) \
+    TARGET_AVX2 DEFINE_PACKED_KERNEL(name, avx2, bpp, first, bgr)
+#else
+#define DEFINE_PACKED_KERNELS(name, bpp, first, bgr)    \
+    DEFINE_PACKED_KERNEL(name, scalar, bpp, first, bgr)
+#endif
+
+// Specialized color check kernels for one channel position and instruction set
+#define DEFINE_CHECK_KERNEL(name, isa, bpp, first)                                               \
+    static bool name##_##isa(const GrayscaleConverter* converter, const Uint8* src, int width,   \
+                             int tolerance) {                                                    \
+        (void)converter;                                                                         \
+        return check_row_packed_##isa(src, width, bpp, first, tolerance);                        \
+    }
+
+#ifdef CPU_FEATURES_X86
+#define DEFINE_CHECK_KERNELS(name, bpp, first)    \
+    DEFINE_CHECK_KERNEL(name, scalar, bpp, first) \
+    TARGET_SSE2 DEFINE_CHECK_KERNEL(name, sse2, bpp, first) \
+    TARGET_AVX2 DEFINE_CHECK_KERNEL(name, avx2, bpp, first)
+#else
+#define DEFINE_CHECK_KERNELS(name, bpp, first)    \
+    DEFINE_CHECK_KERNEL(name, scalar, bpp, first)
+#endif
+
+DEFINE_PACKED_KERNELS(gray_row_rgb24, 3, 0, false)   // bytes R,G,B
+DEFINE_PACKED_KERNELS(gray_row_bgr24, 3, 0, true)    // bytes B,G,R
+DEFINE_PACKED_KERNELS(gray_row_rgbx, 4, 0, false)    // bytes R,G,B,x
+DEFINE_PACKED_KERNELS(gray_row_bgrx, 4, 0, true)     // bytes B,G,R,x
+DEFINE_PACKED_KERNELS(gray_row_xrgb, 4, 1, false)    // bytes x,R,G,B
+DEFINE_PACKED_KERNELS(gray_row_xbgr, 4, 1, true)     // bytes x,B,G,R
+
+DEFINE_CHECK_KERNELS(check_row_c3, 3, 0)             // 3 channels, no padding
+DEFINE_CHECK_KERNELS(check_row_c4, 4, 0)             // 3 channels, then padding
+DEFINE_CHECK_KERNELS(check_row_xc4, 4, 1)            // padding, then 3 channels
+
+typedef struct {
+    int bpp;
+    int first;
+    bool bgr;
+    GrayscaleRowKernel scalar;
+    GrayscaleCheckKernel check_scalar;
+#ifdef CPU_FEATURES_X86
+    GrayscaleRowKernel sse2;
+    GrayscaleCheckKernel check_sse2;
+    GrayscaleRowKernel avx2;
+    GrayscaleCheckKernel check_avx2;
+#endif
+} PackedKernelEntry;
+
+#ifdef CPU_FEATURES_X86
+#define PACKED_KERNEL_ENTRY(name, check, bpp, first, bgr) \
+    { bpp, first, bgr, name##_scalar, check##_scalar, name##_sse2, check##_sse2, name##_avx2, check##_avx2 }
+#else
+#define PACKED_KERNEL_ENTRY(name, check, bpp, first, bgr) \
+    { bpp, first, bgr, name##_scalar, check##_scalar }
+#endif
+
+static const PackedKernelEntry g_packed_kernels[] = {
+    PACKED_KERNEL_ENTRY(gray_row_rgb24, check_row_c3, 3, 0, false),
+    PACKED_KERNEL_ENTRY(gray_row_bgr24, check_row_c3, 3, 0, true),
+    PACKED_KERNEL_ENTRY(gray_row_rgbx, check_row_c4, 4, 0, false),
+    PACKED_KERNEL_ENTRY(gray_row_bgrx, check_row_c4, 4, 0, true),
+    PACKED_KERNEL_ENTRY(gray_row_xrgb, check_row_xc4, 4, 1, false),
+    PACKED_KERNEL_ENTRY(gray_row_xbgr, check_row_xc4, 4, 1, true)
+};
+
+// ---------------------------------------------------------------------------
+// Palettized and generic formats
+// ---------------------------------------------------------------------------
+
+static void gray_row_indexed(const GrayscaleConverter* converter, const Uint8* src, Uint8* dst, int width) {
+    const Uint8* lut = converter->palette_luma;
+
+    for (int x = 0; x < width; x++) {
+        dst[x] = lut[src[x]];
+    }
+}
+
+static bool check_row_indexed(const GrayscaleConverter* converter, const Uint8* src, int width, int tolerance) {
+    const Uint8* spread = converter->palette_spread;
+
+    for (int x = 0; x < width; x++) {
+        if (spread[src[x]] > tolerance) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static Uint32 read_pixel_value(const Uint8* p, int bytes_per_pixel) {
+    switch (bytes_per_pixel) {
+        case 1:
+            return p[0];
+        case 2: {
+            Uint16 value;
+            memcpy(&value, p, 2);
+            return value;
+        }
+        case 3:
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+            return (Uint32)p[0] | ((Uint32)p[1] << 8) | ((Uint32)p[2] << 16);
+#else
+            return ((Uint32)p[0] << 16) | ((Uint32)p[1] << 8) | (Uint32)p[2];
+#endif
+        default: {
+            Uint32 value;
+            memcpy(&value, p, 4);
+            return value;
+        }
+    }
+}
+
+void get_converter_pixel_rgb(const GrayscaleConverter* converter, const Uint8* pixel, Uint8* r, Uint8* g, Uint8* b) {
+    if (converter->packed_rgb) {
+        *r = pixel[converter->r_offset];
+        *g = pixel[converter->g_offset];
+        *b = pixel[converter->b_offset];
+    } else {
+        Uint32 value = read_pixel_value(pixel, converter->bytes_per_pixel);
+        SDL_GetRGB(value, converter->format, r, g, b);
+    }
+}
+
+// Any other format: let SDL decode each pixel
+static void gray_row_generic(const GrayscaleConverter* converter, const Uint8* src, Uint8* dst, int width) {
+    int bpp = converter->bytes_per_pixel;
+
+    for (int x = 0; x < width; x++) {
+        Uint8 r, g, b;
+        get_converter_pixel_rgb(converter, src + x * bpp, &r, &g, &b);
+        dst[x] = luminance_from_rgb(r, g, b);
+    }
+}
+
+static bool check_row_generic(const GrayscaleConverter* converter, const Uint8* src, int width, int tolerance) {
+    int bpp = converter->bytes_per_pixel;
+
+    for (int x = 0; x < width; x++) {
+        Uint8 r, g, b;
+        get_converter_pixel_rgb(converter, src + x * bpp, &r, &g, &b);
+        if (channel_spread(r, g, b) > tolerance) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Runtime dispatch
+// ---------------------------------------------------------------------------
+
+// Byte offset in memory of an 8-bit channel given its shift in the pixel value
+static int channel_byte_offset(Uint8 shift, int bytes_per_pixel) {
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+    (void)bytes_per_pixel;
+    return shift / 8;
+#else
+    return bytes_per_pixel - 1 - shift / 8;
+#endif
+}
+
+bool init_grayscale_converter(GrayscaleConverter* converter, const SDL_PixelFormat* format) {
+    if (!converter || !format) {
+        return false;
+    }
+
+    memset(converter, 0, sizeof(GrayscaleConverter));
+    converter->format = format;
+    converter->bytes_per_pixel = format->BytesPerPixel;
+    converter->kernel = gray_row_generic;
+    converter->check = check_row_generic;
+
+    if (format->palette && format->BytesPerPixel == 1) {
+        // Convert the palette once, then every pixel is a table lookup
+        const SDL_Palette* palette = format->palette;
+        converter->indexed = true;
+        for (int i = 0; i < palette->ncolors && i < 256; i++) {
+            const SDL_Color* c = &palette->colors[i];
+            converter->palette_luma[i] = luminance_from_rgb(c->r, c->g, c->b);
+            converter->palette_spread[i] = (Uint8)channel_spread(c->r, c->g, c->b);
+        }
+        converter->kernel = gray_row_indexed;
+        converter->check = check_row_indexed;
+        return true;
+    }
+
+    int bpp = format->BytesPerPixel;
+    bool full_channels = (format->Rloss == 0 && format->Gloss == 0 && format->Bloss == 0);
+    if ((bpp != 3 && bpp != 4) || !full_channels) {
+        return true;
+    }
+
+    converter->packed_rgb = true;
+    converter->r_offset = channel_byte_offset(format->Rshift, bpp);
+    converter->g_offset = channel_byte_offset(format->Gshift, bpp);
+    converter->b_offset = channel_byte_offset(format->Bshift, bpp);
+
+    CpuIsa isa = get_cpu_isa();
+    for (size_t i = 0; i < sizeof(g_packed_kernels) / sizeof(g_packed_kernels[0]); i++) {
+        const PackedKernelEntry* entry = &g_packed_kernels[i];
+        int ro = entry->bgr ? entry->first + 2 : entry->first;
+        int bo = entry->bgr ? entry->first : entry->first + 2;
+
+        if (entry->bpp != bpp || converter->r_offset != ro ||
+            converter->g_offset != entry->first + 1 || converter->b_offset != bo) {
+            continue;
+        }
+
+        converter->kernel = entry->scalar;
+        converter->check = entry->check_scalar;
+#ifdef CPU_FEATURES_X86
+        if (isa == CPU_ISA_AVX2) {
+            converter->kernel = entry->avx2;
+            converter->check = entry->check_avx2;
+        } else if (isa == CPU_ISA_SSE2) {
+            converter->kernel = entry->sse2;
+            converter->check = entry->check_sse2;
+        }
+#endif
+        break;
+    }
+
+    (void)isa;
+    return true;
+}
+
+const char* get_grayscale_kernel_isa(void) {
+    return get_cpu_isa_name(get_cpu_isa());
+}
@@ -0,0 +1,80 @@
+#ifndef GRAYSCALE_SIMD_H
+#define GRAYSCALE_SIMD_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+
+// Luminance weights in fixed point (units of 1/10000)
+// Y = (2125 * R + 7154 * G + 721 * B) / 10000, rounded to nearest
+#define LUMA_WEIGHT_R 2125
+#define LUMA_WEIGHT_G 7154
+#define LUMA_WEIGHT_B 721
+#define LUMA_SCALE    10000
+
+typedef struct GrayscaleConverter GrayscaleConverter;
+
+// Converts one row of source pixels to 8-bit luminance
+typedef void (*GrayscaleRowKernel)(const GrayscaleConverter* converter, const Uint8* src, Uint8* dst, int width);
+
+// Checks one row of source pixels; returns false at the first block holding
+// a pixel whose channels differ by more than tolerance (0-255)
+typedef bool (*GrayscaleCheckKernel)(const GrayscaleConverter* converter, const Uint8* src, int width, int tolerance);
+
+// How rows of a given SDL pixel format are turned into grayscale
+// Built once per surface by init_grayscale_converter
+struct GrayscaleConverter {
+    GrayscaleRowKernel kernel;      // Row kernel selected for the format
+    GrayscaleCheckKernel check;     // Color check kernel selected for the format
+    const SDL_PixelFormat* format;  // Source format
+    int bytes_per_pixel;
+    bool packed_rgb;                // 8-bit R, G, B channels at fixed byte offsets
+    int r_offset;                   // Byte offsets within a pixel (packed_rgb only)
+    int g_offset;
+    int b_offset;
+    bool indexed;                   // Palettized 8-bit format
+    Uint8 palette_luma[256];        // Luminance of each palette entry (indexed only)
+    Uint8 palette_spread[256];      // Channel spread of each palette entry (indexed only)
+};
+
+/**
+ * Convert a single pixel using the luminance formula
+ * Uses integer weights and reproduces the rounding of the original
+ * double expression (Uint8)(0.2125*R + 0.7154*G + 0.0721*B + 0.5) exactly
+ * @param r Red component
+ * @param g Green component
+ * @param b Blue component
+ * @return Luminance value (0-255)
+ */
+Uint8 luminance_from_rgb(Uint8 r, Uint8 g, Uint8 b);
+
+/**
+ * Prepare grayscale conversion for an SDL pixel format
+ * Packed 24/32-bit formats (RGB24, BGR24, ARGB8888, ABGR8888, RGBA8888,
+ * BGRA8888, RGB888, BGR888) get SIMD kernels reading the channels at their real
+ * byte offsets; INDEX8 converts its palette once and then looks each byte up;
+ * any other format falls back to SDL_GetRGB per pixel. The color check kernel
+ * is selected the same way.
+ * The instruction set is get_cpu_isa() at the time of the call (AVX2, SSE2 or scalar)
+ * @param converter Converter to initialize
+ * @param format Source pixel format (must outlive the converter)
+ * @return true on success, false if format is NULL
+ */
+bool init_grayscale_converter(GrayscaleConverter* converter, const SDL_PixelFormat* format);
+
+/**
+ * Read the R, G, B components of one pixel of the converter's format
+ * @param converter Initialized converter
+ * @param pixel Pointer to the first byte of the pixel
+ * @param r Pointer to store red
+ * @param g Pointer to store green
+ * @param b Pointer to store blue
+ */
+void get_converter_pixel_rgb(const GrayscaleConverter* converter, const Uint8* pixel, Uint8* r, Uint8* g, Uint8* b);
+
+/**
+ * Get the name of the instruction set selected by the runtime dispatch
+ * @return "avx2", "sse2" or "scalar"
+ */
+const char* get_grayscale_kernel_isa(void);
+
+#endif // GRAYSCALE_SIMD_H
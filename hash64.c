@@ -0,0 +1,142 @@
+#include "hash64.h"
+#include <string.h>
+
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+
+static Uint64 rotate_left(Uint64 value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+// Little-endian loads, so the hash is the same on every platform
+static Uint64 read64(const Uint8* data) {
+    Uint64 value;
+    memcpy(&value, data, 8);
+    return SDL_SwapLE64(value);
+}
+
+static Uint32 read32(const Uint8* data) {
+    Uint32 value;
+    memcpy(&value, data, 4);
+    return SDL_SwapLE32(value);
+}
+
+static Uint64 mix_round(Uint64 lane, Uint64 input) {
+    lane += input * PRIME64_2;
+    lane = rotate_left(lane, 31);
+    return lane * PRIME64_1;
+}
+
+static Uint64 merge_lane(Uint64 hash, Uint64 lane) {
+    hash ^= mix_round(0, lane);
+    return hash * PRIME64_1 + PRIME64_4;
+}
+
+// Consume whole 32-byte stripes, one word per lane; returns the bytes used
+static size_t consume_stripes(Uint64 lanes[4], const Uint8* data, size_t size) {
+    size_t offset = 0;
+    Uint64 l0 = lanes[0], l1 = lanes[1], l2 = lanes[2], l3 = lanes[3];
+
+    for (; offset + 32 <= size; offset += 32) {
+        l0 = mix_round(l0, read64(data + offset));
+        l1 = mix_round(l1, read64(data + offset + 8));
+        l2 = mix_round(l2, read64(data + offset + 16));
+        l3 = mix_round(l3, read64(data + offset + 24));
+    }
+
+    lanes[0] = l0;
+    lanes[1] = l1;
+    lanes[2] = l2;
+    lanes[3] = l3;
+    return offset;
+}
+
+void hash64_init(Hash64State* state, Uint64 seed) {
+    memset(state, 0, sizeof(Hash64State));
+    state->seed = seed;
+    state->lanes[0] = seed + PRIME64_1 + PRIME64_2;
+    state->lanes[1] = seed + PRIME64_2;
+    state->lanes[2] = seed;
+    state->lanes[3] = seed - PRIME64_1;
+}
+
+void hash64_update(Hash64State* state, const void* data, size_t size) {
+    if (!state || !data || size == 0) {
+        return;
+    }
+
+    const Uint8* bytes = (const Uint8*)data;
+    state->total_length += size;
+
+    // Complete a stripe started by an earlier call
+    if (state->pending_size > 0) {
+        size_t fill = 32 - state->pending_size;
+        if (size < fill) {
+            memcpy(state->pending + state->pending_size, bytes, size);
+            state->pending_size += (Uint32)size;
+            return;
+        }
+        memcpy(state->pending + state->pending_size, bytes, fill);
+        consume_stripes(state->lanes, state->pending, 32);
+        bytes += fill;
+        size -= fill;
+        state->pending_size = 0;
+    }
+
+    size_t used = consume_stripes(state->lanes, bytes, size);
+    memcpy(state->pending, bytes + used, size - used);
+    state->pending_size = (Uint32)(size - used);
+}
+
+Uint64 hash64_final(const Hash64State* state) {
+    Uint64 hash;
+
+    if (state->total_length >= 32) {
+        const Uint64* lanes = state->lanes;
+        hash = rotate_left(lanes[0], 1) + rotate_left(lanes[1], 7) +
+               rotate_left(lanes[2], 12) + rotate_left(lanes[3], 18);
+        hash = merge_lane(hash, lanes[0]);
+        hash = merge_lane(hash, lanes[1]);
+        hash = merge_lane(hash, lanes[2]);
+        hash = merge_lane(hash, lanes[3]);
+    } else {
+        hash = state->seed + PRIME64_5;
+    }
+    hash += state->total_length;
+
+    // Tail shorter than a stripe
+    const Uint8* tail = state->pending;
+    size_t remaining = state->pending_size;
+    for (; remaining >= 8; tail += 8, remaining -= 8) {
+        hash ^= mix_round(0, read64(tail));
+        hash = rotate_left(hash, 27) * PRIME64_1 + PRIME64_4;
+    }
+    if (remaining >= 4) {
+        hash ^= (Uint64)read32(tail) * PRIME64_1;
+        hash = rotate_left(hash, 23) * PRIME64_2 + PRIME64_3;
+        tail += 4;
+        remaining -= 4;
+    }
+    for (; remaining > 0; tail++, remaining--) {
+        hash ^= (Uint64)(*tail) * PRIME64_5;
+        hash = rotate_left(hash, 11) * PRIME64_1;
+    }
+
+    // Final avalanche
+    hash ^= hash >> 33;
+    hash *= PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= PRIME64_3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+Uint64 hash64(const void* data, size_t size, Uint64 seed) {
+    Hash64State state;
+    hash64_init(&state, seed);
+    hash64_update(&state, data, size);
+    return hash64_final(&state);
+}
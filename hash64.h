@@ -0,0 +1,54 @@
+#ifndef HASH64_H
+#define HASH64_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// 64-bit content hash (XXH64) shared by the raw container checksum and the
+// conversion cache keys. Every input bit reaches every output bit and the
+// length is part of the result, so flipped bits and zero padding are seen;
+// it is not a cryptographic hash
+
+// Streaming state for data that arrives in pieces (e.g. file chunks)
+// Feeding the pieces gives the same result as hash64 on the whole buffer
+typedef struct {
+    Uint64 total_length;
+    Uint64 lanes[4];
+    Uint8 pending[32];      // Input not yet consumed by a 32-byte stripe
+    Uint32 pending_size;
+    Uint64 seed;
+} Hash64State;
+
+/**
+ * Hash a buffer
+ * @param data Bytes to hash (may be NULL when size is 0)
+ * @param size Number of bytes
+ * @param seed Seed (different seeds give unrelated hashes)
+ * @return 64-bit hash
+ */
+Uint64 hash64(const void* data, size_t size, Uint64 seed);
+
+/**
+ * Start a streaming hash
+ * @param state State to initialize
+ * @param seed Seed
+ */
+void hash64_init(Hash64State* state, Uint64 seed);
+
+/**
+ * Add bytes to a streaming hash
+ * @param state State
+ * @param data Bytes to add
+ * @param size Number of bytes
+ */
+void hash64_update(Hash64State* state, const void* data, size_t size);
+
+/**
+ * Get the hash of all bytes added so far (the state may keep being updated)
+ * @param state State
+ * @return 64-bit hash
+ */
+Uint64 hash64_final(const Hash64State* state);
+
+#endif // HASH64_H
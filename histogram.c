@@ -0,0 +1,173 @@
+#include "histogram.h"
+#include <math.h>
+#include <string.h>
+
+// Flush before any 32-bit bank counter can overflow
+#define HISTOGRAM_FLUSH_THRESHOLD 0x40000000u
+
+void histogram_reset(GrayscaleHistogram* histogram) {
+    if (!histogram) {
+        return;
+    }
+    memset(histogram, 0, sizeof(GrayscaleHistogram));
+}
+
+void histogram_merge(GrayscaleHistogram* histogram, const GrayscaleHistogram* other) {
+    if (!histogram || !other) {
+        return;
+    }
+
+    for (int i = 0; i < HISTOGRAM_BINS; i++) {
+        histogram->bins[i] += other->bins[i];
+    }
+    histogram->total += other->total;
+}
+
+void histogram_accumulator_reset(HistogramAccumulator* accumulator) {
+    memset(accumulator, 0, sizeof(HistogramAccumulator));
+}
+
+void histogram_accumulator_flush(HistogramAccumulator* accumulator, GrayscaleHistogram* histogram) {
+    if (accumulator->pending == 0) {
+        return;
+    }
+
+    for (int i = 0; i < HISTOGRAM_BINS; i++) {
+        Uint64 count = 0;
+        for (int bank = 0; bank < HISTOGRAM_BANKS; bank++) {
+            count += accumulator->banks[bank][i];
+        }
+        histogram->bins[i] += count;
+    }
+    histogram->total += accumulator->pending;
+
+    histogram_accumulator_reset(accumulator);
+}
+
+// Count a run that fits in the bank counters
+// Eight pixels are loaded at once and spread over the banks, so consecutive
+// increments hit different memory locations and can retire in parallel
+static void count_run(HistogramAccumulator* accumulator, const Uint8* pixels, size_t count) {
+    Uint32 (*banks)[HISTOGRAM_BINS] = accumulator->banks;
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        Uint32 lo, hi;
+        memcpy(&lo, pixels + i, 4);
+        memcpy(&hi, pixels + i + 4, 4);
+
+        banks[0][lo & 0xFF]++;
+        banks[1][(lo >> 8) & 0xFF]++;
+        banks[2][(lo >> 16) & 0xFF]++;
+        banks[3][lo >> 24]++;
+        banks[0][hi & 0xFF]++;
+        banks[1][(hi >> 8) & 0xFF]++;
+        banks[2][(hi >> 16) & 0xFF]++;
+        banks[3][hi >> 24]++;
+    }
+
+    for (; i < count; i++) {
+        banks[i & (HISTOGRAM_BANKS - 1)][pixels[i]]++;
+    }
+
+    accumulator->pending += (Uint32)count;
+}
+
+void histogram_accumulator_add(HistogramAccumulator* accumulator, GrayscaleHistogram* histogram,
+                               const Uint8* pixels, size_t count) {
+    if (!accumulator || !histogram || !pixels) {
+        return;
+    }
+
+    while (count > 0) {
+        size_t room = HISTOGRAM_FLUSH_THRESHOLD - accumulator->pending;
+        size_t run = count < room ? count : room;
+
+        count_run(accumulator, pixels, run);
+        pixels += run;
+        count -= run;
+
+        if (accumulator->pending >= HISTOGRAM_FLUSH_THRESHOLD) {
+            histogram_accumulator_flush(accumulator, histogram);
+        }
+    }
+}
+
+void histogram_accumulate(GrayscaleHistogram* histogram, const Uint8* pixels, size_t count) {
+    HistogramAccumulator accumulator;
+
+    histogram_accumulator_reset(&accumulator);
+    histogram_accumulator_add(&accumulator, histogram, pixels, count);
+    histogram_accumulator_flush(&accumulator, histogram);
+}
+
+int histogram_percentile(const GrayscaleHistogram* histogram, double percent) {
+    if (!histogram || histogram->total == 0) {
+        return 0;
+    }
+
+    if (percent < 0.0) {
+        percent = 0.0;
+    } else if (percent > 100.0) {
+        percent = 100.0;
+    }
+
+    // Rank of the wanted pixel in sorted order (1-based)
+    Uint64 rank = (Uint64)ceil(percent / 100.0 * (double)histogram->total);
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    Uint64 cumulative = 0;
+    for (int i = 0; i < HISTOGRAM_BINS; i++) {
+        cumulative += histogram->bins[i];
+        if (cumulative >= rank) {
+            return i;
+        }
+    }
+    return HISTOGRAM_BINS - 1;
+}
+
+bool histogram_get_stats(const GrayscaleHistogram* histogram, HistogramStats* stats) {
+    if (!histogram || !stats || histogram->total == 0) {
+        return false;
+    }
+
+    memset(stats, 0, sizeof(HistogramStats));
+    stats->min = -1;
+
+    Uint64 sum = 0;
+    for (int i = 0; i < HISTOGRAM_BINS; i++) {
+        if (histogram->bins[i] == 0) {
+            continue;
+        }
+        if (stats->min < 0) {
+            stats->min = i;
+        }
+        stats->max = i;
+        sum += (Uint64)i * histogram->bins[i];
+    }
+
+    double total = (double)histogram->total;
+    stats->mean = (double)sum / total;
+
+    double variance = 0.0;
+    double entropy = 0.0;
+    for (int i = stats->min; i <= stats->max; i++) {
+        if (histogram->bins[i] == 0) {
+            continue;
+        }
+        double p = (double)histogram->bins[i] / total;
+        double d = i - stats->mean;
+        variance += p * d * d;
+        entropy -= p * log2(p);
+    }
+
+    stats->variance = variance;
+    stats->stddev = sqrt(variance);
+    stats->entropy = entropy;
+    stats->median = histogram_percentile(histogram, 50.0);
+    stats->p5 = histogram_percentile(histogram, 5.0);
+    stats->p95 = histogram_percentile(histogram, 95.0);
+    return true;
+}
@@ -0,0 +1,100 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define HISTOGRAM_BINS 256
+
+// Independent counter banks used while counting; consecutive pixels go to
+// different banks so runs of equal values do not serialize on one counter
+#define HISTOGRAM_BANKS 4
+
+// 256-bin intensity histogram; histograms of disjoint regions can be merged
+typedef struct {
+    Uint64 bins[HISTOGRAM_BINS];
+    Uint64 total;           // Number of pixels counted
+} GrayscaleHistogram;
+
+// Banked 32-bit counters for incremental counting (e.g. row by row)
+typedef struct {
+    Uint32 banks[HISTOGRAM_BANKS][HISTOGRAM_BINS];
+    Uint32 pending;         // Pixels counted since the last flush
+} HistogramAccumulator;
+
+// Statistics derived from a histogram in O(256)
+typedef struct {
+    int min;
+    int max;
+    double mean;
+    double variance;        // Population variance
+    double stddev;
+    int median;
+    int p5;                 // 5th percentile
+    int p95;                // 95th percentile
+    double entropy;         // Shannon entropy in bits (0-8)
+} HistogramStats;
+
+/**
+ * Clear all bins of a histogram
+ * @param histogram Histogram to reset
+ */
+void histogram_reset(GrayscaleHistogram* histogram);
+
+/**
+ * Count pixels into a histogram
+ * @param histogram Histogram to add to
+ * @param pixels Grayscale pixel values
+ * @param count Number of pixels
+ */
+void histogram_accumulate(GrayscaleHistogram* histogram, const Uint8* pixels, size_t count);
+
+/**
+ * Add the bins of one histogram to another (e.g. per-tile or per-thread results)
+ * @param histogram Destination histogram
+ * @param other Histogram to add
+ */
+void histogram_merge(GrayscaleHistogram* histogram, const GrayscaleHistogram* other);
+
+/**
+ * Clear an accumulator
+ * @param accumulator Accumulator to reset
+ */
+void histogram_accumulator_reset(HistogramAccumulator* accumulator);
+
+/**
+ * Count pixels into an accumulator, flushing into histogram before the
+ * 32-bit bank counters could overflow
+ * @param accumulator Accumulator to add to
+ * @param histogram Histogram receiving flushed counts
+ * @param pixels Grayscale pixel values
+ * @param count Number of pixels
+ */
+void histogram_accumulator_add(HistogramAccumulator* accumulator, GrayscaleHistogram* histogram,
+                               const Uint8* pixels, size_t count);
+
+/**
+ * Move the pending counts of an accumulator into a histogram
+ * @param accumulator Accumulator to flush (left empty)
+ * @param histogram Histogram to add to
+ */
+void histogram_accumulator_flush(HistogramAccumulator* accumulator, GrayscaleHistogram* histogram);
+
+/**
+ * Get the value below which a given percentage of the pixels fall
+ * @param histogram Histogram to query
+ * @param percent Percentage (0-100)
+ * @return Smallest intensity whose cumulative count reaches percent, or 0 if empty
+ */
+int histogram_percentile(const GrayscaleHistogram* histogram, double percent);
+
+/**
+ * Derive min, max, mean, variance, median, percentiles and entropy
+ * @param histogram Histogram to summarize
+ * @param stats Pointer to store the statistics
+ * @return true on success, false if the histogram is empty
+ */
+bool histogram_get_stats(const GrayscaleHistogram* histogram, HistogramStats* stats);
+
+#endif // HISTOGRAM_H
@@ -1,9 +1,104 @@
 #include "image_analysis.h"
+#include "grayscale_simd.h"
+#include "gray_png.h"
+#include "gray_raw.h"
+#include "histogram.h"
+#include "thread_pool.h"
+#include "profiler.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 
+// Shared pool for the per-pixel passes, created on first use and reused
+static ThreadPool* g_pool = NULL;
+static int g_thread_count = 0; // 0 = one thread per CPU
+static SDL_SpinLock g_pool_lock = 0;
+
+// Pixel buffers of GrayscaleImage, created on first use and kept for the process
+static BufferPool* g_buffer_pool = NULL;
+static SDL_SpinLock g_buffer_pool_lock = 0;
+
+ThreadPool* get_analysis_pool(void) {
+    SDL_AtomicLock(&g_pool_lock);
+    if (!g_pool) {
+        g_pool = thread_pool_create(g_thread_count);
+    }
+    ThreadPool* pool = g_pool;
+    SDL_AtomicUnlock(&g_pool_lock);
+    return pool;
+}
+
+bool set_analysis_thread_count(int thread_count) {
+    if (thread_count < 0) {
+        return false;
+    }
+    
+    SDL_AtomicLock(&g_pool_lock);
+    thread_pool_destroy(g_pool);
+    g_pool = NULL;
+    g_thread_count = thread_count;
+    SDL_AtomicUnlock(&g_pool_lock);
+    return true;
+}
+
+int get_analysis_thread_count(void) {
+    return thread_pool_get_thread_count(get_analysis_pool());
+}
+
+BufferPool* get_grayscale_buffer_pool(void) {
+    SDL_AtomicLock(&g_buffer_pool_lock);
+    if (!g_buffer_pool) {
+        g_buffer_pool = buffer_pool_create(0);
+    }
+    BufferPool* pool = g_buffer_pool;
+    SDL_AtomicUnlock(&g_buffer_pool_lock);
+    return pool;
+}
+
+void shutdown_analysis_threads(void) {
+    SDL_AtomicLock(&g_pool_lock);
+    thread_pool_destroy(g_pool);
+    g_pool = NULL;
+    SDL_AtomicUnlock(&g_pool_lock);
+    
+    // Images still alive keep their buffers and return them later
+    SDL_AtomicLock(&g_buffer_pool_lock);
+    buffer_pool_trim(g_buffer_pool);
+    SDL_AtomicUnlock(&g_buffer_pool_lock);
+}
+
+// Check whether every palette entry is a shade of gray
+static bool palette_is_grayscale(const SDL_Palette* palette) {
+    for (int i = 0; i < palette->ncolors; i++) {
+        const SDL_Color* c = &palette->colors[i];
+        if (c->r != c->g || c->g != c->b) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Fill color type and transparency from the pixel format
+static void classify_format(const SDL_PixelFormat* format, ImageAnalysis* analysis) {
+    if (format->palette && format->BytesPerPixel == 1) {
+        analysis->color_type = palette_is_grayscale(format->palette) ? COLOR_TYPE_GRAYSCALE : COLOR_TYPE_INDEXED;
+        analysis->has_transparency = false;
+        for (int i = 0; i < format->palette->ncolors; i++) {
+            if (format->palette->colors[i].a != 255) {
+                analysis->has_transparency = true;
+                break;
+            }
+        }
+    } else if (format->Amask != 0) {
+        analysis->color_type = COLOR_TYPE_RGBA;
+        analysis->has_transparency = true;
+    } else {
+        analysis->color_type = COLOR_TYPE_RGB;
+        analysis->has_transparency = false;
+    }
+}
+
 bool analyze_image(const ImageData* image_data, ImageAnalysis* analysis) {
     if (!image_data || !image_data->surface || !analysis) {
         return false;
@@ -18,148 +113,185 @@ bool analyze_image(const ImageData* image_data, ImageAnalysis* analysis) {
     analysis->min_intensity = 255;
     analysis->max_intensity = 0;
     
-    // Determine color type based on channels
-    switch (image_data->channels) {
-        case 1:
-            analysis->color_type = COLOR_TYPE_GRAYSCALE;
-            analysis->has_transparency = false;
-            break;
-        case 3:
-            analysis->color_type = COLOR_TYPE_RGB;
-            analysis->has_transparency = false;
-            break;
-        case 4:
-            analysis->color_type = COLOR_TYPE_RGBA;
-            analysis->has_transparency = true;
-            break;
-        default:
-            analysis->color_type = COLOR_TYPE_UNKNOWN;
-            return false;
-    }
+    // Determine color type from the pixel format
+    classify_format(surface->format, analysis);
     
     // Check if image is actually grayscale (even if stored as RGB)
-    analysis->is_grayscale = is_image_grayscale(image_data);
+    analysis->is_grayscale = is_image_grayscale(image_data, GRAYSCALE_DEFAULT_TOLERANCE, true);
     
     return true;
 }
 
-bool is_image_grayscale(const ImageData* image_data) {
+typedef struct {
+    const GrayscaleConverter* converter;
+    const Uint8* pixels;
+    int pitch;
+    int width;
+    int tolerance;
+    SDL_atomic_t found_color; // Set by the first band that finds a colored pixel
+} GrayscaleCheckJob;
+
+static void grayscale_check_band(void* context, int band, int row_begin, int row_end) {
+    GrayscaleCheckJob* job = (GrayscaleCheckJob*)context;
+    (void)band;
+    
+    for (int y = row_begin; y < row_end; y++) {
+        // Another band already proved the image has color
+        if (SDL_AtomicGet(&job->found_color)) {
+            return;
+        }
+        if (!job->converter->check(job->converter, job->pixels + (size_t)y * job->pitch, job->width, job->tolerance)) {
+            SDL_AtomicSet(&job->found_color, 1);
+            return;
+        }
+    }
+}
+
+// Probe a sparse grid of pixels; photos with color anywhere are almost always
+// caught here, so the full scan is left for images that look gray
+static bool sampled_pixels_are_grayscale(const GrayscaleCheckJob* job, int height) {
+    int rows = height < GRAYSCALE_SAMPLE_GRID ? height : GRAYSCALE_SAMPLE_GRID;
+    int columns = job->width < GRAYSCALE_SAMPLE_GRID ? job->width : GRAYSCALE_SAMPLE_GRID;
+    int bpp = job->converter->bytes_per_pixel;
+    
+    for (int i = 0; i < rows; i++) {
+        // Centered in each cell, so small images still sample every pixel
+        const Uint8* row = job->pixels + (size_t)((2 * i + 1) * (Sint64)height / (2 * rows)) * job->pitch;
+        for (int j = 0; j < columns; j++) {
+            int x = (int)((2 * j + 1) * (Sint64)job->width / (2 * columns));
+            if (!job->converter->check(job->converter, row + (size_t)x * bpp, 1, job->tolerance)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool is_image_grayscale(const ImageData* image_data, int tolerance, bool sampled) {
     if (!image_data || !image_data->surface) {
         return false;
     }
     
     SDL_Surface* surface = image_data->surface;
+    tolerance = tolerance < 0 ? 0 : (tolerance > 255 ? 255 : tolerance);
     
-    // If it's already single channel, it's grayscale
-    if (image_data->channels == 1) {
+    // A palette made only of grays cannot produce a colored pixel
+    if (surface->format->palette && surface->format->BytesPerPixel == 1 &&
+        palette_is_grayscale(surface->format->palette)) {
         return true;
     }
     
-    // For RGB/RGBA images, check if R == G == B for all pixels
+    GrayscaleConverter converter;
+    if (!init_grayscale_converter(&converter, surface->format)) {
+        return false;
+    }
+    
+    // Otherwise check if R == G == B (within tolerance) for all pixels
+    PROFILE_START(analyze_start);
     SDL_LockSurface(surface);
     
-    Uint8* pixels = (Uint8*)surface->pixels;
-    int pitch = surface->pitch;
-    bool is_grayscale = true;
+    GrayscaleCheckJob job;
+    job.converter = &converter;
+    job.pixels = (const Uint8*)surface->pixels;
+    job.pitch = surface->pitch;
+    job.width = surface->w;
+    job.tolerance = tolerance;
+    SDL_AtomicSet(&job.found_color, 0);
     
-    for (int y = 0; y < surface->h && is_grayscale; y++) {
-        Uint8* row = pixels + y * pitch;
-        
-        for (int x = 0; x < surface->w && is_grayscale; x++) {
-            Uint8 r, g, b;
-            
-            if (image_data->channels == 3) {
-                // RGB format
-                r = row[x * 3];
-                g = row[x * 3 + 1];
-                b = row[x * 3 + 2];
-            } else if (image_data->channels == 4) {
-                // RGBA format
-                r = row[x * 4];
-                g = row[x * 4 + 1];
-                b = row[x * 4 + 2];
-                // We ignore alpha channel for grayscale check
-            } else {
-                break;
-            }
-            
-            // Check if R == G == B (with small tolerance for compression artifacts)
-            if (abs(r - g) > 1 || abs(g - b) > 1 || abs(r - b) > 1) {
-                is_grayscale = false;
-            }
-        }
+    if (sampled && !sampled_pixels_are_grayscale(&job, surface->h)) {
+        SDL_AtomicSet(&job.found_color, 1);
+    } else {
+        thread_pool_run_bands(get_analysis_pool(), surface->h, grayscale_check_band, &job);
     }
     
     SDL_UnlockSurface(surface);
-    return is_grayscale;
+    PROFILE_STOP(PROFILE_STAGE_ANALYZE, analyze_start, (size_t)surface->h * surface->pitch);
+    return !SDL_AtomicGet(&job.found_color);
 }
 
-bool convert_to_grayscale(const ImageData* image_data, GrayscaleImage* grayscale_image) {
-    if (!image_data || !image_data->surface || !grayscale_image) {
+typedef struct {
+    const GrayscaleConverter* converter;
+    const Uint8* src;
+    int pitch;
+    Uint8* dst;
+    int width;
+} ConvertJob;
+
+static void convert_band(void* context, int band, int row_begin, int row_end) {
+    ConvertJob* job = (ConvertJob*)context;
+    (void)band;
+    
+    for (int y = row_begin; y < row_end; y++) {
+        job->converter->kernel(job->converter, job->src + (size_t)y * job->pitch,
+                               job->dst + (size_t)y * job->width, job->width);
+    }
+}
+
+bool create_grayscale_image(GrayscaleImage* grayscale_image, int width, int height, const char* source_filename) {
+    if (!grayscale_image || width <= 0 || height <= 0) {
         return false;
     }
     
-    SDL_Surface* surface = image_data->surface;
-    
     // Initialize grayscale image structure
     memset(grayscale_image, 0, sizeof(GrayscaleImage));
-    grayscale_image->width = surface->w;
-    grayscale_image->height = surface->h;
-    grayscale_image->data_size = surface->w * surface->h;
+    grayscale_image->width = width;
+    grayscale_image->height = height;
+    grayscale_image->data_size = (size_t)width * height;
     
-    // Allocate memory for grayscale pixels
-    grayscale_image->pixels = malloc(grayscale_image->data_size);
+    // Take an aligned pixel buffer from the pool (reused across images)
+    grayscale_image->pool = get_grayscale_buffer_pool();
+    grayscale_image->pixels = buffer_pool_acquire(grayscale_image->pool, grayscale_image->data_size);
     if (!grayscale_image->pixels) {
+        grayscale_image->pool = NULL;
         return false;
     }
+    PROFILE_ALLOC(grayscale_image->data_size);
     
     // Copy filename if available
-    if (image_data->filename) {
-        size_t filename_len = strlen(image_data->filename) + 1;
+    if (source_filename) {
+        size_t filename_len = strlen(source_filename) + 1;
         grayscale_image->source_filename = malloc(filename_len);
         if (grayscale_image->source_filename) {
-            strncpy(grayscale_image->source_filename, image_data->filename, filename_len);
+            memcpy(grayscale_image->source_filename, source_filename, filename_len);
         }
     }
+    return true;
+}
+
+// Allocate the pixel buffer for a conversion of image_data
+static bool init_grayscale_image(const ImageData* image_data, GrayscaleImage* grayscale_image) {
+    return create_grayscale_image(grayscale_image, image_data->surface->w, image_data->surface->h, image_data->filename);
+}
+
+bool convert_to_grayscale(const ImageData* image_data, GrayscaleImage* grayscale_image) {
+    if (!image_data || !image_data->surface || !grayscale_image) {
+        return false;
+    }
     
-    SDL_LockSurface(surface);
+    SDL_Surface* surface = image_data->surface;
     
-    Uint8* pixels = (Uint8*)surface->pixels;
-    int pitch = surface->pitch;
+    if (!init_grayscale_image(image_data, grayscale_image)) {
+        return false;
+    }
+    
+    // Pick the row kernel for the pixel format once, outside the loop
+    GrayscaleConverter converter;
+    init_grayscale_converter(&converter, surface->format);
+    
+    PROFILE_START(convert_start);
+    SDL_LockSurface(surface);
     
     // Convert using luminance formula: Y = 0.2125 * R + 0.7154 * G + 0.0721 * B
-    for (int y = 0; y < surface->h; y++) {
-        Uint8* row = pixels + y * pitch;
-        
-        for (int x = 0; x < surface->w; x++) {
-            Uint8 r, g, b;
-            
-            if (image_data->channels == 1) {
-                // Already grayscale
-                grayscale_image->pixels[y * surface->w + x] = row[x];
-            } else if (image_data->channels == 3) {
-                // RGB format
-                r = row[x * 3];
-                g = row[x * 3 + 1];
-                b = row[x * 3 + 2];
-                
-                // Apply luminance formula
-                double gray = 0.2125 * r + 0.7154 * g + 0.0721 * b;
-                grayscale_image->pixels[y * surface->w + x] = (Uint8)(gray + 0.5); // Round to nearest
-            } else if (image_data->channels == 4) {
-                // RGBA format (ignore alpha)
-                r = row[x * 4];
-                g = row[x * 4 + 1];
-                b = row[x * 4 + 2];
-                
-                // Apply luminance formula
-                double gray = 0.2125 * r + 0.7154 * g + 0.0721 * b;
-                grayscale_image->pixels[y * surface->w + x] = (Uint8)(gray + 0.5); // Round to nearest
-            }
-        }
-    }
+    ConvertJob job;
+    job.converter = &converter;
+    job.src = (const Uint8*)surface->pixels;
+    job.pitch = surface->pitch;
+    job.dst = grayscale_image->pixels;
+    job.width = surface->w;
+    thread_pool_run_bands(get_analysis_pool(), surface->h, convert_band, &job);
     
     SDL_UnlockSurface(surface);
+    PROFILE_STOP(PROFILE_STAGE_CONVERT, convert_start, (size_t)surface->h * surface->pitch);
     
     printf("Converted to grayscale using luminance formula: Y = 0.2125*R + 0.7154*G + 0.0721*B\n");
     return true;
@@ -184,7 +316,7 @@ bool get_grayscale_image(const ImageData* image_data, GrayscaleImage* grayscale_
     }
     
     // Check if already grayscale
-    if (is_image_grayscale(image_data)) {
+    if (is_image_grayscale(image_data, GRAYSCALE_DEFAULT_TOLERANCE, true)) {
         printf("Image is already grayscale - extracting pixel data\n");
         return convert_to_grayscale(image_data, grayscale_image);
     } else {
@@ -202,7 +334,7 @@ Uint8 get_grayscale_pixel(const GrayscaleImage* grayscale_image, int x, int y) {
         return 0;
     }
     
-    return grayscale_image->pixels[y * grayscale_image->width + x];
+    return grayscale_image->pixels[(size_t)y * (size_t)grayscale_image->width + (size_t)x];
 }
 
 bool set_grayscale_pixel(GrayscaleImage* grayscale_image, int x, int y, Uint8 value) {
@@ -214,10 +346,82 @@ bool set_grayscale_pixel(GrayscaleImage* grayscale_image, int x, int y, Uint8 va
         return false;
     }
     
-    grayscale_image->pixels[y * grayscale_image->width + x] = value;
+    grayscale_image->pixels[(size_t)y * (size_t)grayscale_image->width + (size_t)x] = value;
+    return true;
+}
+
+typedef struct {
+    const Uint8* pixels;
+    int width;
+    GrayscaleHistogram* partial; // One histogram per band, merged after the run
+} HistogramJob;
+
+static void histogram_band(void* context, int band, int row_begin, int row_end) {
+    HistogramJob* job = (HistogramJob*)context;
+    const Uint8* pixels = job->pixels + (size_t)row_begin * job->width;
+    size_t count = (size_t)(row_end - row_begin) * job->width;
+    
+    histogram_reset(&job->partial[band]);
+    histogram_accumulate(&job->partial[band], pixels, count);
+}
+
+// Allocate one histogram per band the pool will use for the given rows
+static GrayscaleHistogram* alloc_band_histograms(ThreadPool* pool, int rows) {
+    return malloc((size_t)thread_pool_get_band_count(pool, rows) * sizeof(GrayscaleHistogram));
+}
+
+static void merge_band_histograms(const GrayscaleHistogram* partial, int bands, GrayscaleHistogram* histogram) {
+    histogram_reset(histogram);
+    for (int band = 0; band < bands; band++) {
+        histogram_merge(histogram, &partial[band]);
+    }
+}
+
+bool calculate_grayscale_histogram(const GrayscaleImage* grayscale_image, GrayscaleHistogram* histogram) {
+    if (!grayscale_image || !grayscale_image->pixels || !histogram) {
+        return false;
+    }
+    
+    ThreadPool* pool = get_analysis_pool();
+    
+    HistogramJob job;
+    job.pixels = grayscale_image->pixels;
+    job.width = grayscale_image->width;
+    job.partial = alloc_band_histograms(pool, grayscale_image->height);
+    if (!job.partial) {
+        return false;
+    }
+    
+    PROFILE_START(stats_start);
+    int bands = thread_pool_run_bands(pool, grayscale_image->height, histogram_band, &job);
+    
+    merge_band_histograms(job.partial, bands, histogram);
+    PROFILE_STOP(PROFILE_STAGE_STATS, stats_start, grayscale_image->data_size);
+    free(job.partial);
     return true;
 }
 
+void apply_histogram_stats(const GrayscaleHistogram* histogram, ImageAnalysis* analysis) {
+    if (!histogram || !analysis) {
+        return;
+    }
+    
+    HistogramStats stats;
+    if (!histogram_get_stats(histogram, &stats)) {
+        // Empty image: keep the "no pixel seen" min/max convention
+        analysis->min_intensity = 255;
+        analysis->max_intensity = 0;
+        return;
+    }
+    
+    analysis->avg_intensity = stats.mean;
+    analysis->min_intensity = stats.min;
+    analysis->max_intensity = stats.max;
+    analysis->intensity_stddev = stats.stddev;
+    analysis->median_intensity = stats.median;
+    analysis->entropy = stats.entropy;
+}
+
 bool calculate_grayscale_stats(const GrayscaleImage* grayscale_image, ImageAnalysis* analysis) {
     if (!grayscale_image || !grayscale_image->pixels || !analysis) {
         return false;
@@ -228,25 +432,113 @@ bool calculate_grayscale_stats(const GrayscaleImage* grayscale_image, ImageAnaly
     analysis->color_type = COLOR_TYPE_GRAYSCALE;
     analysis->is_grayscale = true;
     analysis->has_transparency = false;
-    analysis->min_intensity = 255;
-    analysis->max_intensity = 0;
     
-    long long sum = 0;
-    size_t total_pixels = grayscale_image->width * grayscale_image->height;
+    GrayscaleHistogram histogram;
+    if (!calculate_grayscale_histogram(grayscale_image, &histogram)) {
+        return false;
+    }
     
-    for (size_t i = 0; i < total_pixels; i++) {
-        Uint8 pixel = grayscale_image->pixels[i];
-        sum += pixel;
+    apply_histogram_stats(&histogram, analysis);
+    return true;
+}
+
+typedef struct {
+    const GrayscaleConverter* converter;
+    bool check_color;
+    const Uint8* src;
+    int pitch;
+    Uint8* dst;
+    int width;
+    SDL_atomic_t found_color;
+    GrayscaleHistogram* partial;
+} FusedJob;
+
+// Convert, color-check and accumulate stats row by row, so every source row
+// is fetched from memory once and the gray row is still in cache for the stats
+static void fused_band(void* context, int band, int row_begin, int row_end) {
+    FusedJob* job = (FusedJob*)context;
+    const GrayscaleConverter* converter = job->converter;
+    
+    HistogramAccumulator accumulator;
+    
+    histogram_reset(&job->partial[band]);
+    histogram_accumulator_reset(&accumulator);
+    
+    for (int y = row_begin; y < row_end; y++) {
+        const Uint8* src_row = job->src + (size_t)y * job->pitch;
+        Uint8* dst_row = job->dst + (size_t)y * job->width;
         
-        if (pixel < analysis->min_intensity) {
-            analysis->min_intensity = pixel;
-        }
-        if (pixel > analysis->max_intensity) {
-            analysis->max_intensity = pixel;
+        converter->kernel(converter, src_row, dst_row, job->width);
+        
+        // Once any band has seen color, the remaining rows need no check
+        if (job->check_color && !SDL_AtomicGet(&job->found_color) &&
+            !converter->check(converter, src_row, job->width, GRAYSCALE_DEFAULT_TOLERANCE)) {
+            SDL_AtomicSet(&job->found_color, 1);
         }
+        
+        histogram_accumulator_add(&accumulator, &job->partial[band], dst_row, (size_t)job->width);
     }
     
-    analysis->avg_intensity = (double)sum / total_pixels;
+    histogram_accumulator_flush(&accumulator, &job->partial[band]);
+}
+
+bool analyze_and_convert_image(const ImageData* image_data, ImageAnalysis* analysis, GrayscaleImage* grayscale_image) {
+    if (!image_data || !image_data->surface || !analysis || !grayscale_image) {
+        return false;
+    }
+    
+    SDL_Surface* surface = image_data->surface;
+    
+    memset(analysis, 0, sizeof(ImageAnalysis));
+    analysis->width = surface->w;
+    analysis->height = surface->h;
+    
+    classify_format(surface->format, analysis);
+    
+    GrayscaleConverter converter;
+    if (!init_grayscale_converter(&converter, surface->format)) {
+        return false;
+    }
+    
+    ThreadPool* pool = get_analysis_pool();
+    GrayscaleHistogram* partial = alloc_band_histograms(pool, surface->h);
+    if (!partial) {
+        return false;
+    }
+    
+    if (!init_grayscale_image(image_data, grayscale_image)) {
+        free(partial);
+        return false;
+    }
+    
+    PROFILE_START(convert_start);
+    SDL_LockSurface(surface);
+    
+    FusedJob job;
+    job.converter = &converter;
+    job.check_color = (analysis->color_type != COLOR_TYPE_GRAYSCALE);
+    job.src = (const Uint8*)surface->pixels;
+    job.pitch = surface->pitch;
+    job.dst = grayscale_image->pixels;
+    job.width = surface->w;
+    job.partial = partial;
+    SDL_AtomicSet(&job.found_color, 0);
+    
+    int bands = thread_pool_run_bands(pool, surface->h, fused_band, &job);
+    
+    SDL_UnlockSurface(surface);
+    PROFILE_STOP(PROFILE_STAGE_CONVERT, convert_start, (size_t)surface->h * surface->pitch);
+    
+    analysis->is_grayscale = !SDL_AtomicGet(&job.found_color);
+    
+    // The per-band histograms were counted inside the fused pass; only the
+    // reduction is charged to the stats stage
+    PROFILE_START(stats_start);
+    GrayscaleHistogram histogram;
+    merge_band_histograms(partial, bands, &histogram);
+    free(partial);
+    apply_histogram_stats(&histogram, analysis);
+    PROFILE_STOP(PROFILE_STAGE_STATS, stats_start, grayscale_image->data_size);
     return true;
 }
 
@@ -263,6 +555,9 @@ void print_image_analysis(const ImageAnalysis* analysis) {
     printf("Intensidade média: %.2f\n", analysis->avg_intensity);
     printf("Intensidade mínima: %d\n", analysis->min_intensity);
     printf("Intensidade máxima: %d\n", analysis->max_intensity);
+    printf("Intensidade mediana: %d\n", analysis->median_intensity);
+    printf("Desvio padrão: %.2f\n", analysis->intensity_stddev);
+    printf("Entropia: %.3f bits\n", analysis->entropy);
     printf("========================\n");
 }
 
@@ -285,54 +580,16 @@ bool save_grayscale_image(const GrayscaleImage* grayscale_image, const char* out
         return false;
     }
     
-    // Create SDL surface from grayscale data
-    SDL_Surface* surface = SDL_CreateRGBSurface(0, 
-                                               grayscale_image->width, 
-                                               grayscale_image->height, 
-                                               24, // 24-bit RGB
-                                               0x000000FF, // R mask
-                                               0x0000FF00, // G mask  
-                                               0x00FF0000, // B mask
-                                               0);         // No alpha
-    
-    if (!surface) {
-        printf("Erro ao criar superficie SDL: %s\n", SDL_GetError());
-        return false;
-    }
-    
-    SDL_LockSurface(surface);
-    
-    // Convert grayscale to RGB (R=G=B for each pixel)
-    Uint8* pixels = (Uint8*)surface->pixels;
-    int pitch = surface->pitch;
-    
-    for (int y = 0; y < grayscale_image->height; y++) {
-        Uint8* row = pixels + y * pitch;
-        
-        for (int x = 0; x < grayscale_image->width; x++) {
-            Uint8 gray_value = grayscale_image->pixels[y * grayscale_image->width + x];
-            
-            // Set R, G, B to the same grayscale value
-            row[x * 3] = gray_value;     // R
-            row[x * 3 + 1] = gray_value; // G
-            row[x * 3 + 2] = gray_value; // B
-        }
-    }
+    // Write the gray bytes as-is to an 8-bit grayscale PNG (color type 0);
+    // libpng reads the rows straight from the image buffer
+    PROFILE_START(encode_start);
+    bool ok = write_gray_png(output_path, grayscale_image->pixels, grayscale_image->width,
+                             grayscale_image->height, (size_t)grayscale_image->width);
+    PROFILE_STOP(PROFILE_STAGE_ENCODE, encode_start, grayscale_image->data_size);
     
-    SDL_UnlockSurface(surface);
-    
-    // Save as PNG
-    int result = IMG_SavePNG(surface, output_path);
-    
-    SDL_FreeSurface(surface);
-    
-    if (result == 0) {
-        printf("Imagem em escala de cinza salva: %s\n", output_path);
-        return true;
-    } else {
-        printf("Erro ao salvar imagem: %s\n", IMG_GetError());
-        return false;
-    }
+    // No message here: the batch encode thread calls this too, and callers
+    // report the result themselves (quiet batches print nothing)
+    return ok;
 }
 
 bool generate_grayscale_filename(const char* original_filename, char* output_buffer, size_t buffer_size) {
@@ -374,8 +631,20 @@ void free_grayscale_image(GrayscaleImage* grayscale_image) {
         return;
     }
     
-    if (grayscale_image->pixels) {
-        free(grayscale_image->pixels);
+    if (grayscale_image->mapping) {
+        // Pixels point into a raw container mapping (see gray_raw.h)
+        unmap_grayscale_raw(grayscale_image->mapping, grayscale_image->mapping_size);
+        grayscale_image->mapping = NULL;
+        grayscale_image->mapping_size = 0;
+        grayscale_image->pixels = NULL;
+    } else if (grayscale_image->pixels) {
+        PROFILE_FREE(grayscale_image->data_size);
+        if (grayscale_image->pool) {
+            buffer_pool_release(grayscale_image->pool, grayscale_image->pixels);
+            grayscale_image->pool = NULL;
+        } else {
+            free(grayscale_image->pixels);
+        }
         grayscale_image->pixels = NULL;
     }
     
@@ -397,6 +666,8 @@ const char* get_color_type_string(ColorType color_type) {
             return "RGB (3 canais)";
         case COLOR_TYPE_RGBA:
             return "RGBA (4 canais)";
+        case COLOR_TYPE_INDEXED:
+            return "Indexada (paleta de cores)";
         case COLOR_TYPE_UNKNOWN:
         default:
             return "Desconhecido";
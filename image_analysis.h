@@ -4,12 +4,23 @@
 #include <SDL2/SDL.h>
 #include <stdbool.h>
 #include "image_loader.h"
+#include "histogram.h"
+#include "buffer_pool.h"
+#include "thread_pool.h"
+
+// Largest channel difference (max - min of R, G, B) still counted as gray;
+// absorbs chroma noise left by lossy compression
+#define GRAYSCALE_DEFAULT_TOLERANCE 1
+
+// Rows and columns probed by the sampled color pre-check
+#define GRAYSCALE_SAMPLE_GRID 64
 
 // Color type classification
 typedef enum {
     COLOR_TYPE_GRAYSCALE = 1,
     COLOR_TYPE_RGB = 3,
     COLOR_TYPE_RGBA = 4,
+    COLOR_TYPE_INDEXED = 8,     // Palettized (8 bits per pixel) with colored entries
     COLOR_TYPE_UNKNOWN = 0
 } ColorType;
 
@@ -23,6 +34,9 @@ typedef struct {
     double avg_intensity;
     int min_intensity;
     int max_intensity;
+    int median_intensity;
+    double intensity_stddev;
+    double entropy;             // Shannon entropy of the intensities in bits
 } ImageAnalysis;
 
 // Structure to hold grayscale image data
@@ -32,6 +46,9 @@ typedef struct {
     int height;
     size_t data_size;       // Total bytes allocated
     char* source_filename;  // Original image filename
+    void* mapping;          // File mapping holding pixels (NULL if heap-allocated)
+    size_t mapping_size;
+    BufferPool* pool;       // Pool owning pixels (NULL if malloc'ed or mapped)
 } GrayscaleImage;
 
 /**
@@ -44,11 +61,27 @@ bool analyze_image(const ImageData* image_data, ImageAnalysis* analysis);
 
 /**
  * Check if an image is already in grayscale
- * This function analyzes pixel data to determine if the image contains colors
+ * This function analyzes pixel data to determine if the image contains colors.
+ * Rows are compared many pixels at a time and the scan stops at the first
+ * colored block; with sampled, a sparse grid is probed first so most color
+ * photos are answered without a full scan (the result is the same)
  * @param image_data Loaded image data
+ * @param tolerance Largest channel difference counted as gray (0-255,
+ *                  GRAYSCALE_DEFAULT_TOLERANCE absorbs compression noise)
+ * @param sampled Probe a GRAYSCALE_SAMPLE_GRID grid before the full scan
  * @return true if image is grayscale, false if it contains colors
  */
-bool is_image_grayscale(const ImageData* image_data);
+bool is_image_grayscale(const ImageData* image_data, int tolerance, bool sampled);
+
+/**
+ * Allocate an uninitialized grayscale image (pixel buffer from the pool)
+ * @param grayscale_image Image to initialize
+ * @param width Width in pixels
+ * @param height Height in pixels
+ * @param source_filename Original image filename to record (may be NULL)
+ * @return true on success, false on invalid size or out of memory
+ */
+bool create_grayscale_image(GrayscaleImage* grayscale_image, int width, int height, const char* source_filename);
 
 /**
  * Convert a color image to grayscale using luminance formula
@@ -78,6 +111,8 @@ bool get_grayscale_image(const ImageData* image_data, GrayscaleImage* grayscale_
 
 /**
  * Get pixel value at specific coordinates in grayscale image
+ * Checks every call; loops over many pixels should use gray_image_row or
+ * gray_image_at (gray_view.h) instead
  * @param grayscale_image Grayscale image data
  * @param x X coordinate (0 to width-1)
  * @param y Y coordinate (0 to height-1)
@@ -95,14 +130,44 @@ Uint8 get_grayscale_pixel(const GrayscaleImage* grayscale_image, int x, int y);
  */
 bool set_grayscale_pixel(GrayscaleImage* grayscale_image, int x, int y, Uint8 value);
 
+/**
+ * Calculate the 256-bin intensity histogram of a grayscale image
+ * Row bands are counted in parallel and merged
+ * @param grayscale_image Grayscale image data
+ * @param histogram Pointer to store the histogram
+ * @return true on success, false on failure
+ */
+bool calculate_grayscale_histogram(const GrayscaleImage* grayscale_image, GrayscaleHistogram* histogram);
+
+/**
+ * Fill the intensity statistics of an analysis from a histogram
+ * (avg/min/max, median, standard deviation and entropy)
+ * @param histogram Intensity histogram
+ * @param analysis Analysis to update
+ */
+void apply_histogram_stats(const GrayscaleHistogram* histogram, ImageAnalysis* analysis);
+
 /**
  * Calculate basic statistics for grayscale image
+ * Statistics are derived from the intensity histogram
  * @param grayscale_image Grayscale image data
  * @param analysis Pointer to store statistical results
  * @return true on success, false on failure
  */
 bool calculate_grayscale_stats(const GrayscaleImage* grayscale_image, ImageAnalysis* analysis);
 
+/**
+ * Analyze, convert to grayscale and compute intensity statistics in one pass
+ * Each source pixel is read once; equivalent to calling analyze_image,
+ * get_grayscale_image and calculate_grayscale_stats, with the statistics
+ * stored in the returned analysis
+ * @param image_data Source image data
+ * @param analysis Pointer to store analysis results and statistics
+ * @param grayscale_image Pointer to store grayscale result
+ * @return true on success, false on failure
+ */
+bool analyze_and_convert_image(const ImageData* image_data, ImageAnalysis* analysis, GrayscaleImage* grayscale_image);
+
 /**
  * Print detailed analysis information
  * @param analysis Analysis results to print
@@ -117,6 +182,8 @@ void print_grayscale_info(const GrayscaleImage* grayscale_image);
 
 /**
  * Save grayscale image to file as PNG
+ * Written as an 8-bit grayscale PNG straight from the pixel buffer (no RGB expansion)
+ * Prints nothing; the caller reports success or failure
  * @param grayscale_image Grayscale image to save
  * @param output_path Path where to save the image
  * @return true on success, false on failure
@@ -146,4 +213,41 @@ void free_grayscale_image(GrayscaleImage* grayscale_image);
  */
 const char* get_color_type_string(ColorType color_type);
 
+/**
+ * Set the number of threads used by the per-pixel passes
+ * Passes split the image into row bands and share one worker pool across images;
+ * the pool is rebuilt on next use, so do not call this while a pass is running
+ * @param thread_count Number of threads, or 0 for one per CPU (default)
+ * @return true on success, false if thread_count is negative
+ */
+bool set_analysis_thread_count(int thread_count);
+
+/**
+ * Get the thread pool the per-pixel passes run on (created on first use)
+ * Other modules schedule their passes on it so --threads applies everywhere
+ * @return Shared pool (NULL means single-threaded)
+ */
+ThreadPool* get_analysis_pool(void);
+
+/**
+ * Get the number of threads used by the per-pixel passes
+ * @return Thread count (1 means single-threaded)
+ */
+int get_analysis_thread_count(void);
+
+/**
+ * Get the pool grayscale pixel buffers are taken from
+ * Buffers are 64-byte aligned and reused across images of similar size,
+ * so batch runs do not keep allocating and page-faulting fresh buffers
+ * @return Process-wide buffer pool (NULL if it cannot be created)
+ */
+BufferPool* get_grayscale_buffer_pool(void);
+
+/**
+ * Stop the worker threads used by the per-pixel passes and free the cached
+ * pixel buffers
+ * Should be called before program exit; passes still work afterwards
+ */
+void shutdown_analysis_threads(void);
+
 #endif // IMAGE_ANALYSIS_H
\ No newline at end of file
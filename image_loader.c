@@ -1,96 +1,189 @@
 #include "image_loader.h"
+#include "profiler.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdarg.h>
+#include <limits.h>
 
-// Global flag to track initialization status
-static bool g_initialized = false;
+// Number of image_loader_init calls not yet matched by image_loader_cleanup;
+// changes happen under g_init_lock, loads only read it
+static SDL_atomic_t g_init_count;
+static SDL_SpinLock g_init_lock = 0;
 
 bool image_loader_init(void) {
-    if (g_initialized) {
-        return true;
-    }
-    
-    // Initialize SDL if not already done
-    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
-        fprintf(stderr, "SDL could not initialize! SDL Error: %s\n", SDL_GetError());
-        return false;
+    bool success = true;
+
+    SDL_AtomicLock(&g_init_lock);
+    if (SDL_AtomicGet(&g_init_count) == 0) {
+        // Initialize SDL if not already done
+        if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+            fprintf(stderr, "SDL could not initialize! SDL Error: %s\n", SDL_GetError());
+            success = false;
+        } else {
+            // Initialize SDL_image with support for PNG, JPG, and BMP
+            int img_flags = IMG_INIT_PNG | IMG_INIT_JPG;
+            if (!(IMG_Init(img_flags) & img_flags)) {
+                fprintf(stderr, "SDL_image could not initialize! SDL_image Error: %s\n", IMG_GetError());
+                SDL_Quit();
+                success = false;
+            } else {
+                printf("Image loader initialized successfully\n");
+            }
+        }
     }
-    
-    // Initialize SDL_image with support for PNG, JPG, and BMP
-    int img_flags = IMG_INIT_PNG | IMG_INIT_JPG;
-    if (!(IMG_Init(img_flags) & img_flags)) {
-        fprintf(stderr, "SDL_image could not initialize! SDL_image Error: %s\n", IMG_GetError());
-        SDL_Quit();
-        return false;
+    if (success) {
+        SDL_AtomicAdd(&g_init_count, 1);
     }
-    
-    g_initialized = true;
-    printf("Image loader initialized successfully\n");
-    return true;
+    SDL_AtomicUnlock(&g_init_lock);
+
+    return success;
 }
 
-ImageLoadError load_image(const char* filename, ImageData* image_data) {
-    if (!g_initialized) {
-        fprintf(stderr, "Image loader not initialized! Call image_loader_init() first.\n");
-        return IMG_ERROR_SDL_NOT_INITIALIZED;
-    }
-    
-    if (!filename || !image_data) {
-        fprintf(stderr, "Invalid parameters passed to load_image\n");
-        return IMG_ERROR_UNKNOWN;
+void image_loader_context_init(ImageLoaderContext* context, bool verbose) {
+    if (!context) {
+        return;
     }
-    
-    // Initialize the image_data structure
-    memset(image_data, 0, sizeof(ImageData));
-    
-    // Check if file exists
-    if (!file_exists(filename)) {
-        fprintf(stderr, "File not found: %s\n", filename);
-        return IMG_ERROR_FILE_NOT_FOUND;
+
+    context->last_error = IMG_SUCCESS;
+    context->message[0] = '\0';
+    context->verbose = verbose;
+}
+
+const char* get_loader_error_message(const ImageLoaderContext* context) {
+    return context ? context->message : "";
+}
+
+// Record an error in the context (and print it when verbose)
+static ImageLoadError set_loader_error(ImageLoaderContext* context, ImageLoadError error, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    vsnprintf(context->message, sizeof(context->message), format, args);
+    va_end(args);
+
+    context->last_error = error;
+    if (context->verbose) {
+        fprintf(stderr, "%s\n", context->message);
     }
-    
-    // Load the image
-    SDL_Surface* loaded_surface = IMG_Load(filename);
+    return error;
+}
+
+// Decode from an open source; source is always closed
+static ImageLoadError load_from_source(ImageLoaderContext* context, SDL_RWops* source,
+                                       const char* name, ImageData* image_data) {
+    const char* label = name ? name : "(memory)";
+
+    // SDL_image detects the format from the data (every format it was built
+    // with, as IMG_Load does), reads straight from the source and closes it
+    PROFILE_START(decode_start);
+    SDL_Surface* loaded_surface = IMG_Load_RW(source, 1);
+    PROFILE_STOP(PROFILE_STAGE_DECODE, decode_start, loaded_surface ? (size_t)loaded_surface->h * loaded_surface->pitch : 0);
     if (!loaded_surface) {
-        fprintf(stderr, "Unable to load image %s! SDL_image Error: %s\n", 
-                filename, IMG_GetError());
-        
-        // Try to determine the specific error type
-        const char* error = IMG_GetError();
-        if (strstr(error, "Unsupported image format") || 
-            strstr(error, "not a") || 
-            strstr(error, "Invalid")) {
-            return IMG_ERROR_INVALID_FORMAT;
-        }
-        return IMG_ERROR_UNKNOWN;
+        // The source opened, so the decoder rejected the data; SDL_image's
+        // text is kept for the details only
+        return set_loader_error(context, IMG_ERROR_INVALID_FORMAT,
+                                "Unable to load image %s! SDL_image Error: %s", label, IMG_GetError());
     }
-    
+
+    PROFILE_ALLOC((size_t)loaded_surface->h * loaded_surface->pitch);
+
     // Store image information
     image_data->surface = loaded_surface;
     image_data->width = loaded_surface->w;
     image_data->height = loaded_surface->h;
     image_data->channels = loaded_surface->format->BytesPerPixel;
-    
+
     // Store filename (make a copy)
-    size_t filename_len = strlen(filename) + 1;
-    image_data->filename = malloc(filename_len);
-    if (image_data->filename) {
-        strncpy(image_data->filename, filename, filename_len);
+    if (name) {
+        size_t filename_len = strlen(name) + 1;
+        image_data->filename = malloc(filename_len);
+        if (image_data->filename) {
+            strncpy(image_data->filename, name, filename_len);
+        }
     }
-    
-    printf("Image loaded successfully: %s (%dx%d, %d channels)\n", 
-           filename, image_data->width, image_data->height, image_data->channels);
-    
+
+    context->last_error = IMG_SUCCESS;
+    context->message[0] = '\0';
+    if (context->verbose) {
+        printf("Image loaded successfully: %s (%dx%d, %d channels)\n",
+               label, image_data->width, image_data->height, image_data->channels);
+    }
+
     return IMG_SUCCESS;
 }
 
+// Common checks of the load functions
+static ImageLoadError check_load_state(ImageLoaderContext* context, bool valid, ImageData* image_data) {
+    if (SDL_AtomicGet(&g_init_count) == 0) {
+        return set_loader_error(context, IMG_ERROR_SDL_NOT_INITIALIZED,
+                                "Image loader not initialized! Call image_loader_init() first.");
+    }
+
+    if (!valid || !image_data) {
+        return set_loader_error(context, IMG_ERROR_UNKNOWN, "Invalid parameters passed to load_image");
+    }
+
+    // Initialize the image_data structure
+    memset(image_data, 0, sizeof(ImageData));
+    return IMG_SUCCESS;
+}
+
+ImageLoadError load_image_with_context(ImageLoaderContext* context, const char* filename, ImageData* image_data) {
+    if (!context) {
+        fprintf(stderr, "Invalid parameters passed to load_image_with_context\n");
+        return IMG_ERROR_UNKNOWN;
+    }
+
+    ImageLoadError result = check_load_state(context, filename != NULL, image_data);
+    if (result != IMG_SUCCESS) {
+        return result;
+    }
+
+    // A single open both checks that the file exists and feeds the decoder
+    PROFILE_START(io_start);
+    SDL_RWops* source = SDL_RWFromFile(filename, "rb");
+    PROFILE_STOP(PROFILE_STAGE_FILE_IO, io_start, 0);
+    if (!source) {
+        return set_loader_error(context, IMG_ERROR_FILE_NOT_FOUND, "File not found: %s", filename);
+    }
+
+    return load_from_source(context, source, filename, image_data);
+}
+
+ImageLoadError load_image_from_memory(ImageLoaderContext* context, const void* data, size_t size,
+                                      const char* name, ImageData* image_data) {
+    if (!context) {
+        fprintf(stderr, "Invalid parameters passed to load_image_from_memory\n");
+        return IMG_ERROR_UNKNOWN;
+    }
+
+    ImageLoadError result = check_load_state(context, data && size > 0 && size <= INT_MAX, image_data);
+    if (result != IMG_SUCCESS) {
+        return result;
+    }
+
+    SDL_RWops* source = SDL_RWFromConstMem(data, (int)size);
+    if (!source) {
+        return set_loader_error(context, IMG_ERROR_MEMORY_ALLOCATION,
+                                "Unable to read image %s from memory: %s", name ? name : "(memory)", SDL_GetError());
+    }
+
+    return load_from_source(context, source, name, image_data);
+}
+
+ImageLoadError load_image(const char* filename, ImageData* image_data) {
+    ImageLoaderContext context;
+    image_loader_context_init(&context, true);
+    return load_image_with_context(&context, filename, image_data);
+}
+
 void free_image_data(ImageData* image_data) {
     if (!image_data) {
         return;
     }
     
     if (image_data->surface) {
+        PROFILE_FREE((size_t)image_data->surface->h * image_data->surface->pitch);
         SDL_FreeSurface(image_data->surface);
         image_data->surface = NULL;
     }
@@ -142,12 +235,15 @@ const char* get_supported_formats(void) {
 }
 
 void image_loader_cleanup(void) {
-    if (!g_initialized) {
-        return;
+    SDL_AtomicLock(&g_init_lock);
+    int count = SDL_AtomicGet(&g_init_count);
+    if (count > 0) {
+        SDL_AtomicSet(&g_init_count, count - 1);
+        if (count == 1) {
+            IMG_Quit();
+            SDL_Quit();
+            printf("Image loader cleaned up\n");
+        }
     }
-    
-    IMG_Quit();
-    SDL_Quit();
-    g_initialized = false;
-    printf("Image loader cleaned up\n");
+    SDL_AtomicUnlock(&g_init_lock);
 }
\ No newline at end of file
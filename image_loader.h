@@ -15,6 +15,19 @@ typedef enum {
     IMG_ERROR_UNKNOWN
 } ImageLoadError;
 
+// Size of the error message kept by a loader context
+#define IMAGE_LOADER_MESSAGE_SIZE 256
+
+// Loading state of one caller (typically one per thread)
+// Contexts share nothing, so any number of threads may load at once, each
+// with its own context; the error code comes from the step that failed
+// (open, memory source or decode), SDL's message is only copied as details
+typedef struct {
+    ImageLoadError last_error;                  // Result of the last load
+    char message[IMAGE_LOADER_MESSAGE_SIZE];    // Details of last_error ("" on success)
+    bool verbose;                               // Print loads to stdout and errors to stderr
+} ImageLoaderContext;
+
 // Structure to hold image data and metadata
 typedef struct {
     SDL_Surface* surface;
@@ -26,7 +39,8 @@ typedef struct {
 
 /**
  * Initialize the image loading system
- * Must be called before using any other image loading functions
+ * Must be called before using any other image loading functions; calls are
+ * counted, so independent users may each init and cleanup
  * @return true on success, false on failure
  */
 bool image_loader_init(void);
@@ -34,12 +48,51 @@ bool image_loader_init(void);
 /**
  * Load an image from file
  * Supports PNG, JPG, JPEG, BMP, GIF, TIF, TIFF formats
+ * Same as load_image_with_context with a verbose context of its own
  * @param filename Path to the image file
  * @param image_data Pointer to ImageData structure to store the loaded image
  * @return ImageLoadError code indicating success or type of error
  */
 ImageLoadError load_image(const char* filename, ImageData* image_data);
 
+/**
+ * Initialize a loader context
+ * @param context Context to initialize
+ * @param verbose Print each load to stdout and errors to stderr
+ */
+void image_loader_context_init(ImageLoaderContext* context, bool verbose);
+
+/**
+ * Load an image from file with a caller-owned context (thread-safe)
+ * The file is opened once and read by the decoder directly, which detects
+ * the format from the data (IMG_ERROR_FILE_NOT_FOUND if the open fails,
+ * IMG_ERROR_INVALID_FORMAT if the decoder fails)
+ * @param context Loader context (receives the error state)
+ * @param filename Path to the image file
+ * @param image_data Pointer to ImageData structure to store the loaded image
+ * @return ImageLoadError code indicating success or type of error
+ */
+ImageLoadError load_image_with_context(ImageLoaderContext* context, const char* filename, ImageData* image_data);
+
+/**
+ * Decode an image already in memory (thread-safe)
+ * @param context Loader context (receives the error state)
+ * @param data Encoded image bytes (only read during the call)
+ * @param size Number of bytes
+ * @param name Name stored as the ImageData filename (may be NULL)
+ * @param image_data Pointer to ImageData structure to store the loaded image
+ * @return ImageLoadError code indicating success or type of error
+ */
+ImageLoadError load_image_from_memory(ImageLoaderContext* context, const void* data, size_t size,
+                                      const char* name, ImageData* image_data);
+
+/**
+ * Get the message describing the last error of a context
+ * @param context Loader context
+ * @return Message, or "" if the last load succeeded
+ */
+const char* get_loader_error_message(const ImageLoaderContext* context);
+
 /**
  * Free memory allocated for an ImageData structure
  * @param image_data Pointer to ImageData structure to free
@@ -68,7 +121,7 @@ const char* get_supported_formats(void);
 
 /**
  * Cleanup the image loading system
- * Should be called before program exit
+ * Should be called before program exit, once per successful image_loader_init
  */
 void image_loader_cleanup(void);
 
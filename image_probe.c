@@ -0,0 +1,427 @@
+#include "image_probe.h"
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+// Reads at arbitrary offsets of a file or memory buffer; file reads go
+// through one cached block, so headers close together cost a single read
+typedef struct {
+    FILE* file;             // NULL when probing memory
+    const Uint8* data;      // Memory contents
+    size_t size;            // Memory size
+    long block_offset;      // File offset of the cached block
+    size_t block_length;    // Bytes in the cached block (0 = none)
+    Uint8 block[IMAGE_PROBE_BLOCK_SIZE];
+} ProbeSource;
+
+static bool source_read(ProbeSource* source, size_t offset, void* destination, size_t length) {
+    if (!source->file) {
+        if (offset > source->size || length > source->size - offset) {
+            return false;
+        }
+        memcpy(destination, source->data + offset, length);
+        return true;
+    }
+
+    if (length > IMAGE_PROBE_BLOCK_SIZE || offset > (size_t)LONG_MAX - IMAGE_PROBE_BLOCK_SIZE) {
+        return false;
+    }
+
+    size_t block_offset = (size_t)source->block_offset;
+    if (source->block_length == 0 || offset < block_offset ||
+        offset + length > block_offset + source->block_length) {
+        if (fseek(source->file, (long)offset, SEEK_SET) != 0) {
+            return false;
+        }
+        source->block_offset = (long)offset;
+        source->block_length = fread(source->block, 1, IMAGE_PROBE_BLOCK_SIZE, source->file);
+        block_offset = offset;
+    }
+
+    if (offset + length > block_offset + source->block_length) {
+        return false;
+    }
+    memcpy(destination, source->block + (offset - block_offset), length);
+    return true;
+}
+
+static Uint32 read_be32(const Uint8* bytes) {
+    return ((Uint32)bytes[0] << 24) | ((Uint32)bytes[1] << 16) | ((Uint32)bytes[2] << 8) | bytes[3];
+}
+
+static int read_be16(const Uint8* bytes) {
+    return (bytes[0] << 8) | bytes[1];
+}
+
+static Uint32 read_le32(const Uint8* bytes) {
+    return ((Uint32)bytes[3] << 24) | ((Uint32)bytes[2] << 16) | ((Uint32)bytes[1] << 8) | bytes[0];
+}
+
+static int read_le16(const Uint8* bytes) {
+    return (bytes[1] << 8) | bytes[0];
+}
+
+// ---------------------------------------------------------------------------
+// PNG
+// ---------------------------------------------------------------------------
+
+#define PNG_COLOR_GRAY 0
+#define PNG_COLOR_RGB 2
+#define PNG_COLOR_PALETTE 3
+#define PNG_COLOR_GRAY_ALPHA 4
+#define PNG_COLOR_RGB_ALPHA 6
+
+static const Uint8 PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+// SDL_image keeps a palette image indexed when its tRNS only makes a single
+// entry fully transparent (color key), and expands it to RGBA otherwise
+static bool png_palette_needs_alpha(ProbeSource* source, size_t offset, Uint32 length) {
+    Uint8 alphas[256];
+    if (length > sizeof(alphas) || !source_read(source, offset, alphas, length)) {
+        return true;
+    }
+
+    int transparent = 0;
+    for (Uint32 i = 0; i < length; i++) {
+        if (alphas[i] == 0) {
+            transparent++;
+        } else if (alphas[i] != 255) {
+            return true;
+        }
+    }
+    return transparent > 1;
+}
+
+static bool probe_png(ProbeSource* source, ImageProbe* probe) {
+    Uint8 header[8 + 8 + 13];
+    if (!source_read(source, 0, header, sizeof(header)) ||
+        read_be32(header + 8) != 13 || memcmp(header + 12, "IHDR", 4) != 0) {
+        return false;
+    }
+
+    Uint32 width = read_be32(header + 16);
+    Uint32 height = read_be32(header + 20);
+    int bit_depth = header[24];
+    int color_type = header[25];
+    if (width == 0 || height == 0 || width > INT_MAX || height > INT_MAX) {
+        return false;
+    }
+
+    // tRNS, when present, comes after IHDR/PLTE and before the first IDAT
+    bool transparency = false;
+    bool needs_alpha = false;
+    size_t offset = sizeof(header) + 4;
+    Uint8 chunk[8];
+    while (source_read(source, offset, chunk, sizeof(chunk))) {
+        Uint32 length = read_be32(chunk);
+        if (memcmp(chunk + 4, "IDAT", 4) == 0 || memcmp(chunk + 4, "IEND", 4) == 0 || length > INT_MAX) {
+            break;
+        }
+        if (memcmp(chunk + 4, "tRNS", 4) == 0) {
+            transparency = true;
+            needs_alpha = color_type == PNG_COLOR_PALETTE && png_palette_needs_alpha(source, offset + 8, length);
+            break;
+        }
+        offset += 12 + (size_t)length;
+    }
+
+    // Layout after SDL_image's libpng transforms: 16-bit samples stripped,
+    // small depths unpacked, gray expanded (with tRNS as alpha), gray+alpha
+    // turned to RGBA
+    int channels;
+    switch (color_type) {
+        case PNG_COLOR_GRAY:
+            channels = transparency ? 2 : 1;
+            break;
+        case PNG_COLOR_RGB:
+            channels = 3;
+            break;
+        case PNG_COLOR_PALETTE:
+            channels = needs_alpha ? 4 : 1;
+            break;
+        case PNG_COLOR_GRAY_ALPHA:
+        case PNG_COLOR_RGB_ALPHA:
+            channels = 4;
+            break;
+        default:
+            return false;
+    }
+
+    probe->format = PROBE_FORMAT_PNG;
+    probe->width = (int)width;
+    probe->height = (int)height;
+    probe->channels = channels;
+    probe->bit_depth = bit_depth;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// JPEG
+// ---------------------------------------------------------------------------
+
+// Start-of-frame markers (every coding process); C4, C8 and CC share the
+// range but are other segments
+static bool is_jpeg_sof(int marker) {
+    return marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+}
+
+static bool probe_jpeg(ProbeSource* source, ImageProbe* probe) {
+    size_t offset = 2;
+    Uint8 marker[4];
+
+    // Segments are skipped by their length until the frame header
+    while (source_read(source, offset, marker, 2)) {
+        if (marker[0] != 0xFF) {
+            return false;
+        }
+        if (marker[1] == 0xFF) {
+            offset++;   // Fill byte
+            continue;
+        }
+        if ((marker[1] >= 0xD0 && marker[1] <= 0xD7) || marker[1] == 0x01) {
+            offset += 2;    // No payload
+            continue;
+        }
+        if (marker[1] == 0xD9 || marker[1] == 0xDA || !source_read(source, offset, marker, 4)) {
+            return false;   // Image data or end reached without a frame header
+        }
+
+        int length = read_be16(marker + 2);
+        if (length < 2) {
+            return false;
+        }
+
+        if (is_jpeg_sof(marker[1])) {
+            Uint8 frame[6];
+            if (!source_read(source, offset + 4, frame, sizeof(frame))) {
+                return false;
+            }
+
+            int height = read_be16(frame + 1);
+            int width = read_be16(frame + 3);
+            int components = frame[5];
+            if (width == 0 || height == 0 || components == 0) {
+                return false;   // Height defined later by a DNL segment: not supported
+            }
+
+            // SDL_image decodes four components as CMYK, everything else as RGB
+            probe->format = PROBE_FORMAT_JPEG;
+            probe->width = width;
+            probe->height = height;
+            probe->channels = components == 4 ? 4 : 3;
+            probe->bit_depth = frame[0];
+            return true;
+        }
+
+        offset += 2 + (size_t)length;
+    }
+
+    return false;
+}
+
+// ---------------------------------------------------------------------------
+// BMP
+// ---------------------------------------------------------------------------
+
+#define BMP_CORE_HEADER_SIZE 12
+
+static bool probe_bmp(ProbeSource* source, ImageProbe* probe) {
+    Uint8 header[14 + 16];
+    if (!source_read(source, 0, header, 14 + 4)) {
+        return false;
+    }
+
+    // File header, then the info header (its size tells the variant)
+    Uint32 info_size = read_le32(header + 14);
+    if (!source_read(source, 14 + 4, header + 14 + 4,
+                     info_size == BMP_CORE_HEADER_SIZE ? BMP_CORE_HEADER_SIZE - 4 : sizeof(header) - 14 - 4)) {
+        return false;
+    }
+
+    Sint64 width;
+    Sint64 height;
+    int bits;
+    if (info_size == BMP_CORE_HEADER_SIZE) {
+        // OS/2 header: 16-bit sizes
+        width = read_le16(header + 18);
+        height = read_le16(header + 20);
+        bits = read_le16(header + 24);
+    } else if (info_size >= 16) {
+        width = (Sint32)read_le32(header + 18);
+        height = (Sint32)read_le32(header + 22);
+        bits = read_le16(header + 28);
+    } else {
+        return false;
+    }
+
+    // A negative height marks a top-down bitmap
+    if (height < 0) {
+        height = -height;
+    }
+    if (width <= 0 || height == 0 || width > INT_MAX || height > INT_MAX) {
+        return false;
+    }
+
+    // SDL expands 1 and 4 bits to 8-bit indexed; other depths keep their size
+    int channels;
+    switch (bits) {
+        case 1: case 4: case 8: channels = 1; break;
+        case 15: case 16: channels = 2; break;
+        case 24: channels = 3; break;
+        case 32: channels = 4; break;
+        default: return false;
+    }
+
+    probe->format = PROBE_FORMAT_BMP;
+    probe->width = (int)width;
+    probe->height = (int)height;
+    probe->channels = channels;
+    probe->bit_depth = bits;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// GIF
+// ---------------------------------------------------------------------------
+
+#define GIF_EXTENSION 0x21
+#define GIF_IMAGE 0x2C
+#define GIF_COLOR_TABLE_FLAG 0x80
+
+static bool probe_gif(ProbeSource* source, ImageProbe* probe) {
+    Uint8 screen[13];
+    if (!source_read(source, 0, screen, sizeof(screen))) {
+        return false;
+    }
+
+    int table_bits = (screen[10] & 0x07) + 1;
+    size_t offset = sizeof(screen);
+    if (screen[10] & GIF_COLOR_TABLE_FLAG) {
+        offset += (size_t)3 << table_bits;
+    }
+
+    // SDL_image loads the first frame at its own size, so the size comes
+    // from the first image descriptor rather than the logical screen
+    Uint8 block[10];
+    while (source_read(source, offset, block, 1)) {
+        if (block[0] == GIF_IMAGE) {
+            if (!source_read(source, offset, block, sizeof(block))) {
+                return false;
+            }
+
+            int width = read_le16(block + 5);
+            int height = read_le16(block + 7);
+            if (width == 0 || height == 0) {
+                return false;
+            }
+            if (block[9] & GIF_COLOR_TABLE_FLAG) {
+                table_bits = (block[9] & 0x07) + 1;
+            }
+
+            probe->format = PROBE_FORMAT_GIF;
+            probe->width = width;
+            probe->height = height;
+            probe->channels = 1;
+            probe->bit_depth = table_bits;
+            return true;
+        }
+        if (block[0] != GIF_EXTENSION) {
+            return false;   // Trailer or damaged stream before any image
+        }
+
+        // Introducer and label, then data sub-blocks up to an empty one
+        offset += 2;
+        Uint8 length;
+        while (source_read(source, offset, &length, 1) && length > 0) {
+            offset += 1 + (size_t)length;
+        }
+        offset++;
+    }
+
+    return false;
+}
+
+// ---------------------------------------------------------------------------
+// Entry points
+// ---------------------------------------------------------------------------
+
+static ImageLoadError probe_source(ProbeSource* source, ImageProbe* probe) {
+    Uint8 signature[8];
+    bool ok = false;
+
+    memset(probe, 0, sizeof(ImageProbe));
+    if (source_read(source, 0, signature, sizeof(signature))) {
+        if (memcmp(signature, PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) == 0) {
+            ok = probe_png(source, probe);
+        } else if (signature[0] == 0xFF && signature[1] == 0xD8 && signature[2] == 0xFF) {
+            ok = probe_jpeg(source, probe);
+        } else if (signature[0] == 'B' && signature[1] == 'M') {
+            ok = probe_bmp(source, probe);
+        } else if (memcmp(signature, "GIF87a", 6) == 0 || memcmp(signature, "GIF89a", 6) == 0) {
+            ok = probe_gif(source, probe);
+        }
+    }
+
+    if (!ok) {
+        memset(probe, 0, sizeof(ImageProbe));
+        return IMG_ERROR_INVALID_FORMAT;
+    }
+    return IMG_SUCCESS;
+}
+
+ImageLoadError probe_image(const char* filename, ImageProbe* probe) {
+    if (!filename || !probe) {
+        fprintf(stderr, "Invalid parameters passed to probe_image\n");
+        return IMG_ERROR_UNKNOWN;
+    }
+
+    ProbeSource source;
+    source.file = fopen(filename, "rb");
+    source.data = NULL;
+    source.size = 0;
+    source.block_offset = 0;
+    source.block_length = 0;
+    if (!source.file) {
+        memset(probe, 0, sizeof(ImageProbe));
+        return IMG_ERROR_FILE_NOT_FOUND;
+    }
+
+    // Blocks are read whole, stdio buffering would only add a copy
+    setvbuf(source.file, NULL, _IONBF, 0);
+
+    ImageLoadError result = probe_source(&source, probe);
+    fclose(source.file);
+    return result;
+}
+
+ImageLoadError probe_image_memory(const void* data, size_t size, ImageProbe* probe) {
+    if (!data || !probe) {
+        fprintf(stderr, "Invalid parameters passed to probe_image_memory\n");
+        return IMG_ERROR_UNKNOWN;
+    }
+
+    ProbeSource source;
+    source.file = NULL;
+    source.data = (const Uint8*)data;
+    source.size = size;
+    source.block_offset = 0;
+    source.block_length = 0;
+
+    return probe_source(&source, probe);
+}
+
+const char* get_probe_format_name(ProbeFormat format) {
+    switch (format) {
+        case PROBE_FORMAT_PNG:
+            return "PNG";
+        case PROBE_FORMAT_JPEG:
+            return "JPEG";
+        case PROBE_FORMAT_BMP:
+            return "BMP";
+        case PROBE_FORMAT_GIF:
+            return "GIF";
+        case PROBE_FORMAT_UNKNOWN:
+        default:
+            return "desconhecido";
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef IMAGE_PROBE_H
+#define IMAGE_PROBE_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "image_loader.h"
+
+// Bytes read at a time while probing; the headers of nearly every file fit
+// in the first block, later blocks are only read to skip large metadata
+// (EXIF, ICC profiles) placed before the header that holds the size
+#define IMAGE_PROBE_BLOCK_SIZE 4096
+
+// Formats the probe can read
+typedef enum {
+    PROBE_FORMAT_UNKNOWN = 0,
+    PROBE_FORMAT_PNG,
+    PROBE_FORMAT_JPEG,
+    PROBE_FORMAT_BMP,
+    PROBE_FORMAT_GIF
+} ProbeFormat;
+
+// Image metadata read from the file header
+typedef struct {
+    ProbeFormat format;
+    int width;              // Same as ImageData width after load_image
+    int height;             // Same as ImageData height after load_image
+    int channels;           // Same as ImageData channels (bytes per pixel of the loaded surface)
+    int bit_depth;          // Bits per sample (PNG, JPEG) or per pixel (BMP, GIF)
+} ImageProbe;
+
+/**
+ * Read the size and layout of an image from its header, without decoding
+ * PNG (IHDR, and tRNS for the alpha channel), JPEG (SOF), BMP (DIB header)
+ * and GIF (first image descriptor) are parsed; channels follow what SDL_image
+ * produces for the file: palette and grayscale images load as one byte per
+ * pixel unless transparency expands them to RGBA, JPEGs as RGB (CMYK as four
+ * bytes), 16-bit samples are reduced to 8
+ * @param filename Path to the image file
+ * @param probe Pointer to store the metadata
+ * @return IMG_SUCCESS, IMG_ERROR_FILE_NOT_FOUND, or IMG_ERROR_INVALID_FORMAT for
+ *         unrecognized (TIFF included) or malformed headers
+ */
+ImageLoadError probe_image(const char* filename, ImageProbe* probe);
+
+/**
+ * Same as probe_image for a file already in memory
+ * @param data File contents (a prefix holding the headers is enough)
+ * @param size Number of bytes
+ * @param probe Pointer to store the metadata
+ * @return IMG_SUCCESS or IMG_ERROR_INVALID_FORMAT
+ */
+ImageLoadError probe_image_memory(const void* data, size_t size, ImageProbe* probe);
+
+/**
+ * Get the name of a probed format
+ * @param format Format
+ * @return Name ("PNG", "JPEG", ...)
+ */
+const char* get_probe_format_name(ProbeFormat format);
+
+#endif // IMAGE_PROBE_H
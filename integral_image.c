@@ -0,0 +1,201 @@
+#include "integral_image.h"
+#include "profiler.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Builders for each entry width; the squared table is filled in the same
+// loop as the sums so the pixels are read once
+#define DEFINE_INTEGRAL_BUILDER(name, SumType, SquareType)                          \
+    static void name(const GrayscaleImage* image, SumType* sums, SquareType* squares) { \
+        int width = image->width;                                                   \
+        int stride = width + 1;                                                     \
+        memset(sums, 0, stride * sizeof(SumType));                                  \
+        if (squares) {                                                              \
+            memset(squares, 0, stride * sizeof(SquareType));                        \
+        }                                                                           \
+        for (int y = 0; y < image->height; y++) {                                   \
+            const Uint8* row = image->pixels + (size_t)y * width;                   \
+            const SumType* above = sums + (size_t)y * stride;                       \
+            SumType* current = sums + (size_t)(y + 1) * stride;                     \
+            SumType row_sum = 0;                                                    \
+            current[0] = 0;                                                         \
+            if (squares) {                                                          \
+                const SquareType* square_above = squares + (size_t)y * stride;      \
+                SquareType* square_current = squares + (size_t)(y + 1) * stride;    \
+                SquareType row_square = 0;                                          \
+                square_current[0] = 0;                                              \
+                for (int x = 0; x < width; x++) {                                   \
+                    row_sum += row[x];                                              \
+                    row_square += (SquareType)(row[x] * row[x]);                    \
+                    current[x + 1] = above[x + 1] + row_sum;                        \
+                    square_current[x + 1] = square_above[x + 1] + row_square;       \
+                }                                                                   \
+            } else {                                                                \
+                for (int x = 0; x < width; x++) {                                   \
+                    row_sum += row[x];                                              \
+                    current[x + 1] = above[x + 1] + row_sum;                        \
+                }                                                                   \
+            }                                                                       \
+        }                                                                           \
+    }
+
+DEFINE_INTEGRAL_BUILDER(build_narrow_narrow, Uint32, Uint32)
+DEFINE_INTEGRAL_BUILDER(build_narrow_wide, Uint32, Uint64)
+DEFINE_INTEGRAL_BUILDER(build_wide_wide, Uint64, Uint64)
+
+// 32-bit entries suffice while the total of the whole table fits: every
+// rectangle sum is then smaller than 2^32 and wrapping cancels out
+static bool fits_narrow(int width, int height, Uint64 max_value) {
+    return max_value * (Uint64)width * (Uint64)height <= 0xFFFFFFFFu;
+}
+
+bool build_integral_image(const GrayscaleImage* grayscale_image, IntegralImage* integral, bool with_squares) {
+    if (!grayscale_image || !grayscale_image->pixels || !integral ||
+        grayscale_image->width <= 0 || grayscale_image->height <= 0) {
+        return false;
+    }
+
+    memset(integral, 0, sizeof(IntegralImage));
+    integral->width = grayscale_image->width;
+    integral->height = grayscale_image->height;
+    integral->stride = grayscale_image->width + 1;
+    integral->wide_sums = !fits_narrow(integral->width, integral->height, 255);
+    integral->wide_squares = !fits_narrow(integral->width, integral->height, 255 * 255);
+
+    size_t entries = (size_t)integral->stride * (integral->height + 1);
+    size_t sums_size = entries * (integral->wide_sums ? sizeof(Uint64) : sizeof(Uint32));
+    size_t squares_size = with_squares ? entries * (integral->wide_squares ? sizeof(Uint64) : sizeof(Uint32)) : 0;
+
+    integral->sums = malloc(sums_size);
+    integral->squares = with_squares ? malloc(squares_size) : NULL;
+    if (!integral->sums || (with_squares && !integral->squares)) {
+        printf("Erro: Falha ao alocar memória para a imagem integral\n");
+        free(integral->sums);
+        free(integral->squares);
+        memset(integral, 0, sizeof(IntegralImage));
+        return false;
+    }
+    PROFILE_ALLOC(sums_size + squares_size);
+
+    PROFILE_START(stats_start);
+    if (integral->wide_sums) {
+        build_wide_wide(grayscale_image, (Uint64*)integral->sums, (Uint64*)integral->squares);
+    } else if (integral->wide_squares) {
+        build_narrow_wide(grayscale_image, (Uint32*)integral->sums, (Uint64*)integral->squares);
+    } else {
+        build_narrow_narrow(grayscale_image, (Uint32*)integral->sums, (Uint32*)integral->squares);
+    }
+    PROFILE_STOP(PROFILE_STAGE_STATS, stats_start, grayscale_image->data_size);
+
+    return true;
+}
+
+void free_integral_image(IntegralImage* integral) {
+    if (!integral) {
+        return;
+    }
+
+    if (integral->sums) {
+        size_t entries = (size_t)integral->stride * (integral->height + 1);
+        size_t size = entries * (integral->wide_sums ? sizeof(Uint64) : sizeof(Uint32));
+        if (integral->squares) {
+            size += entries * (integral->wide_squares ? sizeof(Uint64) : sizeof(Uint32));
+        }
+        PROFILE_FREE(size);
+    }
+    free(integral->sums);
+    free(integral->squares);
+    memset(integral, 0, sizeof(IntegralImage));
+}
+
+// Clip a rectangle to the image; false if nothing is left
+static bool clip_region(const IntegralImage* integral, int* x, int* y, int* width, int* height) {
+    Sint64 x0 = *x < 0 ? 0 : *x;
+    Sint64 y0 = *y < 0 ? 0 : *y;
+    Sint64 x1 = (Sint64)*x + *width;
+    Sint64 y1 = (Sint64)*y + *height;
+    if (x1 > integral->width) {
+        x1 = integral->width;
+    }
+    if (y1 > integral->height) {
+        y1 = integral->height;
+    }
+    if (x0 >= x1 || y0 >= y1) {
+        return false;
+    }
+
+    *x = (int)x0;
+    *y = (int)y0;
+    *width = (int)(x1 - x0);
+    *height = (int)(y1 - y0);
+    return true;
+}
+
+// Sum of a clipped rectangle from one table
+static Uint64 table_region_sum(const void* table, bool wide, int stride, int x, int y, int width, int height) {
+    size_t top = (size_t)y * stride;
+    size_t bottom = (size_t)(y + height) * stride;
+    size_t left = (size_t)x;
+    size_t right = (size_t)(x + width);
+
+    if (wide) {
+        const Uint64* entries = (const Uint64*)table;
+        return entries[bottom + right] - entries[top + right] - entries[bottom + left] + entries[top + left];
+    }
+
+    const Uint32* entries = (const Uint32*)table;
+    return (Uint32)(entries[bottom + right] - entries[top + right] - entries[bottom + left] + entries[top + left]);
+}
+
+Uint64 get_region_sum(const IntegralImage* integral, int x, int y, int width, int height) {
+    if (!integral || !integral->sums || !clip_region(integral, &x, &y, &width, &height)) {
+        return 0;
+    }
+    return table_region_sum(integral->sums, integral->wide_sums, integral->stride, x, y, width, height);
+}
+
+bool get_region_stats(const IntegralImage* integral, int x, int y, int width, int height, RegionStats* stats) {
+    if (!integral || !integral->sums || !stats || !clip_region(integral, &x, &y, &width, &height)) {
+        return false;
+    }
+
+    memset(stats, 0, sizeof(RegionStats));
+    stats->x = x;
+    stats->y = y;
+    stats->width = width;
+    stats->height = height;
+    stats->count = (Uint64)width * height;
+    stats->sum = table_region_sum(integral->sums, integral->wide_sums, integral->stride, x, y, width, height);
+    stats->mean = (double)stats->sum / (double)stats->count;
+
+    if (integral->squares) {
+        stats->sum_squares = table_region_sum(integral->squares, integral->wide_squares, integral->stride,
+                                              x, y, width, height);
+        double variance = ((double)stats->sum_squares - (double)stats->sum * stats->mean) / (double)stats->count;
+        stats->variance = variance > 0.0 ? variance : 0.0;
+        stats->stddev = sqrt(stats->variance);
+    } else {
+        stats->variance = -1.0;
+        stats->stddev = -1.0;
+    }
+
+    return true;
+}
+
+void print_region_stats(const RegionStats* stats) {
+    if (!stats) {
+        return;
+    }
+
+    printf("\n=== Região (%d,%d) %dx%d ===\n", stats->x, stats->y, stats->width, stats->height);
+    printf("Pixels: %llu\n", (unsigned long long)stats->count);
+    printf("Soma: %llu\n", (unsigned long long)stats->sum);
+    printf("Intensidade média: %.2f\n", stats->mean);
+    if (stats->variance >= 0.0) {
+        printf("Variância: %.2f\n", stats->variance);
+        printf("Desvio padrão: %.2f\n", stats->stddev);
+    }
+    printf("========================\n");
+}
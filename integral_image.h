@@ -0,0 +1,85 @@
+#ifndef INTEGRAL_IMAGE_H
+#define INTEGRAL_IMAGE_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include "image_analysis.h"
+
+// Summed-area table of a grayscale image
+// Entry (x, y) holds the sum of all pixels above and to the left of pixel
+// (x, y), so the table has a zero first row and column and (width + 1) x
+// (height + 1) entries. Tables use 32-bit entries while the total of the
+// image fits in 32 bits (entries may wrap, rectangle sums are still exact
+// modulo 2^32) and 64-bit entries otherwise
+typedef struct {
+    int width;              // Image size in pixels
+    int height;
+    int stride;             // Entries per table row (width + 1)
+    void* sums;             // Pixel sums (Uint32 or Uint64 entries)
+    void* squares;          // Squared pixel sums, or NULL if not built
+    bool wide_sums;         // sums has 64-bit entries
+    bool wide_squares;      // squares has 64-bit entries
+} IntegralImage;
+
+// Statistics of a rectangle, from four table lookups per table
+typedef struct {
+    int x;                  // Rectangle after clipping to the image
+    int y;
+    int width;
+    int height;
+    Uint64 count;           // Pixels in the rectangle
+    Uint64 sum;
+    Uint64 sum_squares;     // 0 without a squared table
+    double mean;
+    double variance;        // Population variance, -1.0 without a squared table
+    double stddev;          // -1.0 without a squared table
+} RegionStats;
+
+/**
+ * Build the integral image (and optionally the squared integral image) in
+ * one pass over the pixels
+ * @param grayscale_image Source image
+ * @param integral Integral image to create
+ * @param with_squares Also build the squared table (needed for variance)
+ * @return true on success, false on failure
+ */
+bool build_integral_image(const GrayscaleImage* grayscale_image, IntegralImage* integral, bool with_squares);
+
+/**
+ * Free an integral image
+ * @param integral Integral image to free
+ */
+void free_integral_image(IntegralImage* integral);
+
+/**
+ * Sum of the pixels of a rectangle in constant time
+ * The rectangle is clipped to the image
+ * @param integral Integral image
+ * @param x Left column
+ * @param y Top row
+ * @param width Rectangle width
+ * @param height Rectangle height
+ * @return Sum of the pixels (0 for an empty rectangle)
+ */
+Uint64 get_region_sum(const IntegralImage* integral, int x, int y, int width, int height);
+
+/**
+ * Sum, mean and variance of a rectangle in constant time
+ * The rectangle is clipped to the image
+ * @param integral Integral image
+ * @param x Left column
+ * @param y Top row
+ * @param width Rectangle width
+ * @param height Rectangle height
+ * @param stats Pointer to store the statistics
+ * @return true on success, false if the clipped rectangle is empty
+ */
+bool get_region_stats(const IntegralImage* integral, int x, int y, int width, int height, RegionStats* stats);
+
+/**
+ * Print region statistics
+ * @param stats Region statistics
+ */
+void print_region_stats(const RegionStats* stats);
+
+#endif // INTEGRAL_IMAGE_H
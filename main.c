@@ -1,9 +1,187 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "image_loader.h"
 #include "image_analysis.h"
+#include "batch_pipeline.h"
+#include "stream_convert.h"
+#include "gray_raw.h"
+#include "conversion_cache.h"
+#include "profiler.h"
+#include "convolution.h"
+#include "integral_image.h"
+#include "point_ops.h"
+#include "gray_loader.h"
+#include "gray_pyramid.h"
+#include "image_probe.h"
+#include "gray_png.h"
+#include "gray_view.h"
 
 int main(int argc, char* argv[]) {
+    // Parse options; the first non-option argument is the image to analyze,
+    // or with --batch every following argument is a file or directory to process
+    const char* image_path = NULL;
+    bool batch_mode = false;
+    bool probe_mode = false;
+    bool stream_mode = false;
+    bool luma_mode = false;
+    int load_scale = 1;
+    int pyramid_levels = 0;
+    bool save_raw = false;
+    bool use_cache = true;
+    bool profile = false;
+    double blur_sigma = 0.0;
+    ConvolutionBorder blur_border = CONVOLUTION_BORDER_MIRROR;
+    int roi[4];
+    bool use_roi = false;
+    int crop[4];
+    bool use_crop = false;
+    PointOpChain point_ops = {0};
+    GrayPngOptions png_options;
+    ProfileReport image_profile;
+    BatchFileList batch_files = {0};
+    BatchOptions batch_options = {0};
+    
+    gray_png_default_options(&png_options);
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            if (!set_analysis_thread_count(atoi(argv[++i]))) {
+                fprintf(stderr, "Invalid thread count: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--queue-depth") == 0 && i + 1 < argc) {
+            batch_options.queue_depth = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--quiet") == 0) {
+            batch_options.quiet = true;
+        } else if (strcmp(argv[i], "--prefetch") == 0 && i + 1 < argc) {
+            batch_options.prefetch_depth = atoi(argv[++i]);
+            if (batch_options.prefetch_depth < 0) {
+                fprintf(stderr, "Invalid prefetch depth: %s\n", argv[i]);
+                return 1;
+            }
+            batch_options.no_prefetch = (batch_options.prefetch_depth == 0);
+        } else if (strcmp(argv[i], "--no-cache") == 0) {
+            use_cache = false;
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            profile = true;
+            batch_options.profile = true;
+        } else if (strcmp(argv[i], "--png-fast") == 0) {
+            gray_png_fast_options(&png_options);
+        } else if (strcmp(argv[i], "--png-level") == 0 && i + 1 < argc) {
+            png_options.compression_level = atoi(argv[++i]);
+            if (png_options.compression_level < 0 || png_options.compression_level > 9) {
+                fprintf(stderr, "Invalid PNG compression level (0-9): %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--png-filter") == 0 && i + 1 < argc) {
+            if (!parse_png_filter(argv[++i], &png_options.filter)) {
+                fprintf(stderr, "Unknown PNG filter: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--png-parallel") == 0) {
+            png_options.parallel = true;
+        } else if (strcmp(argv[i], "--blur") == 0 && i + 1 < argc) {
+            blur_sigma = atof(argv[++i]);
+            if (blur_sigma <= 0.0) {
+                fprintf(stderr, "Invalid blur sigma: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--border") == 0 && i + 1 < argc) {
+            if (!parse_convolution_border(argv[++i], &blur_border)) {
+                fprintf(stderr, "Invalid border mode: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--roi") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%d,%d,%d,%d", &roi[0], &roi[1], &roi[2], &roi[3]) != 4) {
+                fprintf(stderr, "Invalid region (expected X,Y,W,H): %s\n", argv[i]);
+                return 1;
+            }
+            use_roi = true;
+        } else if (strcmp(argv[i], "--crop") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%d,%d,%d,%d", &crop[0], &crop[1], &crop[2], &crop[3]) != 4) {
+                fprintf(stderr, "Invalid region (expected X,Y,W,H): %s\n", argv[i]);
+                return 1;
+            }
+            use_crop = true;
+        } else if (strcmp(argv[i], "--stretch") == 0) {
+            point_op_chain_add(&point_ops, POINT_OP_STRETCH, 0.0);
+        } else if (strcmp(argv[i], "--equalize") == 0) {
+            point_op_chain_add(&point_ops, POINT_OP_EQUALIZE, 0.0);
+        } else if (strcmp(argv[i], "--invert") == 0) {
+            point_op_chain_add(&point_ops, POINT_OP_INVERT, 0.0);
+        } else if (strcmp(argv[i], "--gamma") == 0 && i + 1 < argc) {
+            if (!point_op_chain_add(&point_ops, POINT_OP_GAMMA, atof(argv[++i]))) {
+                fprintf(stderr, "Invalid gamma: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            if (!point_op_chain_add(&point_ops, POINT_OP_THRESHOLD, atof(argv[++i]))) {
+                fprintf(stderr, "Invalid threshold: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--raw") == 0) {
+            save_raw = true;
+        } else if (strcmp(argv[i], "--luma") == 0) {
+            luma_mode = true;
+        } else if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+            load_scale = atoi(argv[++i]);
+            if (load_scale != 1 && load_scale != 2 && load_scale != 4 && load_scale != 8) {
+                fprintf(stderr, "Invalid scale (1, 2, 4 or 8): %s\n", argv[i]);
+                return 1;
+            }
+            luma_mode = true;
+        } else if (strcmp(argv[i], "--pyramid") == 0 && i + 1 < argc) {
+            pyramid_levels = atoi(argv[++i]);
+            if (pyramid_levels < 2 || pyramid_levels > GRAY_PYRAMID_MAX_LEVELS) {
+                fprintf(stderr, "Invalid pyramid level count: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--stream") == 0) {
+            stream_mode = true;
+        } else if (strcmp(argv[i], "--batch") == 0) {
+            batch_mode = true;
+        } else if (strcmp(argv[i], "--probe") == 0) {
+            probe_mode = true;
+        } else if (batch_mode || probe_mode) {
+            if (!batch_add_path(&batch_files, argv[i])) {
+                fprintf(stderr, "Could not read input: %s\n", argv[i]);
+                free_batch_file_list(&batch_files);
+                return 1;
+            }
+        } else if (!image_path) {
+            image_path = argv[i];
+        }
+    }
+    
+    // PNG settings for every save below (applied before any thread starts)
+    set_png_encode_options(&png_options);
+    
+    // Probe mode: header metadata of every input, no decoding (the loader
+    // is not even initialized), then exit
+    if (probe_mode) {
+        int failures = 0;
+        Uint64 probe_start = SDL_GetPerformanceCounter();
+        
+        for (int i = 0; i < batch_files.count; i++) {
+            ImageProbe probe;
+            ImageLoadError result = probe_image(batch_files.paths[i], &probe);
+            if (result != IMG_SUCCESS) {
+                printf("%s: %s\n", batch_files.paths[i], get_image_error_string(result));
+                failures++;
+                continue;
+            }
+            printf("%s: %s %dx%d, %d canais, %d bits\n", batch_files.paths[i],
+                   get_probe_format_name(probe.format), probe.width, probe.height,
+                   probe.channels, probe.bit_depth);
+        }
+        
+        double seconds = (double)(SDL_GetPerformanceCounter() - probe_start) / (double)SDL_GetPerformanceFrequency();
+        printf("\n%d arquivo(s) sondado(s) em %.3f ms (%d falha(s))\n", batch_files.count, seconds * 1000.0, failures);
+        free_batch_file_list(&batch_files);
+        return failures == 0 ? 0 : 1;
+    }
+    
     // Initialize the image loading system
     if (!image_loader_init()) {
         fprintf(stderr, "Failed to initialize image loader\n");
@@ -12,57 +190,269 @@ int main(int argc, char* argv[]) {
     
     printf("Sistema de Análise de Imagens\n");
     printf("============================\n");
-    printf("%s\n\n", get_supported_formats());
+    printf("%s\n", get_supported_formats());
+    printf("Threads: %d\n\n", get_analysis_thread_count());
     
-    // Example 1: Load and analyze an image from command line argument
-    if (argc > 1) {
-        ImageData image;
-        ImageLoadError result = load_image(argv[1], &image);
+    profile_set_enabled(profile);
+    
+    // Batch mode: pipelined decode/convert/encode over all inputs, then exit
+    if (batch_mode) {
+        printf("Processando %d arquivo(s) em lote...\n", batch_files.count);
+        
+        BatchReport report;
+        bool ok = run_batch(&batch_files, &batch_options, &report);
+        print_batch_report(&report);
+        
+        if (profile) {
+            ProfileReport totals;
+            profile_get_totals(&totals);
+            print_profile_report("Agregado do lote", &totals);
+        }
         
+        free_batch_file_list(&batch_files);
+        shutdown_analysis_threads();
+        image_loader_cleanup();
+        return ok ? 0 : 1;
+    }
+    
+    // Conversion results of unchanged inputs are reused across runs (batch
+    // mode does not use the cache, so it is only opened past that branch)
+    ConversionCache cache;
+    if (use_cache && !conversion_cache_open(&cache, NULL, 0)) {
+        use_cache = false;
+    }
+    
+    // Streaming mode: convert strip by strip without loading the whole image
+    // (files it cannot stream, e.g. progressive JPEGs, are loaded normally)
+    if (image_path && stream_mode && !is_streamable_image(image_path)) {
+        printf("Streaming nao suportado para %s, usando o carregamento normal\n", image_path);
+        stream_mode = false;
+    }
+    if (image_path && stream_mode) {
+        char output_filename[256];
+        ImageAnalysis analysis;
+        
+        profile_begin_image(&image_profile);
+        if (!generate_grayscale_filename(image_path, output_filename, sizeof(output_filename))) {
+            printf("Erro ao gerar nome do arquivo de saida\n");
+        } else if (stream_convert_image(image_path, output_filename, 0, &analysis)) {
+            print_image_analysis(&analysis);
+            printf("Contraste: %d\n", analysis.max_intensity - analysis.min_intensity);
+            printf("\nImagem em escala de cinza salva como: %s\n", output_filename);
+        } else {
+            printf("Falha na conversao em streaming: %s\n", image_path);
+        }
+        profile_end_image();
+        if (profile) {
+            print_profile_report(image_path, &image_profile);
+        }
+        image_path = NULL;
+    }
+    
+    // Raw container: map the saved grayscale pixels and analyze them directly
+    if (image_path && is_grayscale_raw_file(image_path)) {
+        GrayscaleImage grayscale;
+        ImageAnalysis analysis;
+        
+        profile_begin_image(&image_profile);
+        if (load_grayscale_raw(image_path, &grayscale, true)) {
+            print_grayscale_info(&grayscale);
+            if (calculate_grayscale_stats(&grayscale, &analysis)) {
+                print_image_analysis(&analysis);
+            }
+            free_grayscale_image(&grayscale);
+        } else {
+            printf("Falha ao carregar arquivo bruto: %s\n", image_path);
+        }
+        profile_end_image();
+        if (profile) {
+            print_profile_report(image_path, &image_profile);
+        }
+        image_path = NULL;
+    }
+    
+    // Grayscale-targeted load: JPEG luminance decoded directly (optionally downscaled)
+    if (image_path && luma_mode) {
+        GrayscaleImage grayscale;
+        ImageAnalysis analysis;
+        bool used_luma = false;
+        
+        profile_begin_image(&image_profile);
+        ImageLoadError result = load_grayscale_image(image_path, load_scale, &grayscale, &used_luma);
         if (result == IMG_SUCCESS) {
-            printf("Imagem carregada com sucesso: %s\n", image.filename);
-            printf("Dimensões: %dx%d pixels\n", image.width, image.height);
-            printf("Canais: %d\n", image.channels);
-            printf("Formato da superfície: %s\n\n", SDL_GetPixelFormatName(image.surface->format->format));
-            
-            // Analyze the image
-            ImageAnalysis analysis;
-            if (analyze_image(&image, &analysis)) {
+            printf("Carregado em escala de cinza (%s): %s\n",
+                   used_luma ? "luminância JPEG" : "conversão", image_path);
+            print_grayscale_info(&grayscale);
+            if (calculate_grayscale_stats(&grayscale, &analysis)) {
                 print_image_analysis(&analysis);
             }
             
-            // Get grayscale version
-            GrayscaleImage grayscale;
-            if (get_grayscale_image(&image, &grayscale)) {
-                print_grayscale_info(&grayscale);
+            char output_filename[256];
+            if (generate_grayscale_filename(image_path, output_filename, sizeof(output_filename))) {
+                if (save_grayscale_image(&grayscale, output_filename)) {
+                    printf("\nImagem em escala de cinza salva como: %s\n", output_filename);
+                } else {
+                    printf("Erro ao salvar imagem: %s\n", output_filename);
+                }
+            }
+            free_grayscale_image(&grayscale);
+        } else {
+            printf("Falha ao carregar imagem: %s\n", get_image_error_string(result));
+        }
+        profile_end_image();
+        if (profile) {
+            print_profile_report(image_path, &image_profile);
+        }
+        image_path = NULL;
+    }
+    
+    // Example 1: Load and analyze an image from command line argument
+    if (image_path) {
+        ImageAnalysis analysis;
+        GrayscaleImage grayscale;
+        ConversionCacheKey cache_key = {0};
+        bool converted = false;
+        
+        profile_begin_image(&image_profile);
+        if (use_cache && conversion_cache_lookup(&cache, image_path, &cache_key, &analysis, &grayscale)) {
+            printf("Resultado servido do cache: %s\n", image_path);
+            converted = true;
+        } else {
+            ImageData image;
+            ImageLoadError result = load_image(image_path, &image);
+            
+            if (result == IMG_SUCCESS) {
+                printf("Imagem carregada com sucesso: %s\n", image.filename);
+                printf("Dimensões: %dx%d pixels\n", image.width, image.height);
+                printf("Canais: %d\n", image.channels);
+                printf("Formato da superfície: %s\n\n", SDL_GetPixelFormatName(image.surface->format->format));
                 
-                // Calculate and print grayscale statistics
-                ImageAnalysis gray_stats;
-                if (calculate_grayscale_stats(&grayscale, &gray_stats)) {
-                    printf("\n=== Estatísticas da Imagem em Escala de Cinza ===\n");
-                    printf("Intensidade média: %.2f\n", gray_stats.avg_intensity);
-                    printf("Intensidade mínima: %d\n", gray_stats.min_intensity);
-                    printf("Intensidade máxima: %d\n", gray_stats.max_intensity);
-                    printf("Contraste: %d\n", gray_stats.max_intensity - gray_stats.min_intensity);
-                    printf("===============================================\n");
+                // Analyze, convert to grayscale and compute statistics in one pass
+                converted = analyze_and_convert_image(&image, &analysis, &grayscale);
+                if (converted && use_cache) {
+                    conversion_cache_store(&cache, &cache_key, &analysis, &grayscale);
                 }
                 
-                // Save grayscale image
-                char output_filename[256];
-                if (generate_grayscale_filename(argv[1], output_filename, sizeof(output_filename))) {
-                    if (save_grayscale_image(&grayscale, output_filename)) {
-                        printf("\nImagem em escala de cinza salva como: %s\n", output_filename);
+                // Free the loaded image
+                free_image_data(&image);
+            } else {
+                printf("Falha ao carregar imagem: %s\n", get_image_error_string(result));
+            }
+        }
+        
+        if (converted) {
+            print_image_analysis(&analysis);
+            print_grayscale_info(&grayscale);
+            
+            // Print grayscale statistics
+            printf("\n=== Estatísticas da Imagem em Escala de Cinza ===\n");
+            printf("Intensidade média: %.2f\n", analysis.avg_intensity);
+            printf("Intensidade mínima: %d\n", analysis.min_intensity);
+            printf("Intensidade máxima: %d\n", analysis.max_intensity);
+            printf("Contraste: %d\n", analysis.max_intensity - analysis.min_intensity);
+            printf("===============================================\n");
+            
+            // Region statistics from the integral image
+            if (use_roi) {
+                IntegralImage integral;
+                RegionStats region;
+                if (build_integral_image(&grayscale, &integral, true)) {
+                    if (get_region_stats(&integral, roi[0], roi[1], roi[2], roi[3], &region)) {
+                        print_region_stats(&region);
+                    } else {
+                        printf("Região fora da imagem: %d,%d %dx%d\n", roi[0], roi[1], roi[2], roi[3]);
                     }
+                    free_integral_image(&integral);
                 }
-                
-                // Free grayscale image
-                free_grayscale_image(&grayscale);
             }
             
-            // Free the loaded image
-            free_image_data(&image);
-        } else {
-            printf("Falha ao carregar imagem: %s\n", get_image_error_string(result));
+            // Point operations (in command line order) composed into one LUT pass
+            if (point_ops.count > 0) {
+                if (apply_point_op_chain(&grayscale, &point_ops)) {
+                    printf("%d operação(ões) pontual(is) aplicada(s)\n", point_ops.count);
+                } else {
+                    printf("Falha nas operações pontuais\n");
+                }
+            }
+            
+            // Optional Gaussian blur of the saved outputs (statistics above are of the unblurred image)
+            if (blur_sigma > 0.0) {
+                GrayscaleImage blurred;
+                if (gaussian_blur(&grayscale, &blurred, blur_sigma, blur_border, 0)) {
+                    free_grayscale_image(&grayscale);
+                    grayscale = blurred;
+                    printf("Desfoque gaussiano aplicado (sigma %.2f)\n", blur_sigma);
+                } else {
+                    printf("Falha no desfoque gaussiano (sigma %.2f)\n", blur_sigma);
+                }
+            }
+            
+            // Save grayscale image
+            char output_filename[256];
+            if (generate_grayscale_filename(image_path, output_filename, sizeof(output_filename))) {
+                if (save_grayscale_image(&grayscale, output_filename)) {
+                    printf("\nImagem em escala de cinza salva como: %s\n", output_filename);
+                } else {
+                    printf("Erro ao salvar imagem: %s\n", output_filename);
+                }
+            }
+            
+            // Reduced levels saved next to the output as <name>_gray_<level>.png
+            if (pyramid_levels > 0 && generate_grayscale_filename(image_path, output_filename, sizeof(output_filename))) {
+                GrayPyramid pyramid;
+                if (build_gray_pyramid(&grayscale, &pyramid, pyramid_levels)) {
+                    size_t base_len = strlen(output_filename);
+                    if (base_len > 4 && strcmp(output_filename + base_len - 4, ".png") == 0) {
+                        base_len -= 4;
+                    }
+                    for (int level = 1; level < pyramid.level_count; level++) {
+                        char level_filename[280];
+                        snprintf(level_filename, sizeof(level_filename), "%.*s_%d.png",
+                                 (int)base_len, output_filename, level);
+                        if (save_pyramid_level(&pyramid, level, level_filename)) {
+                            printf("Nível %d salvo como: %s\n", level, level_filename);
+                        } else {
+                            printf("Erro ao salvar imagem: %s\n", level_filename);
+                        }
+                    }
+                    free_gray_pyramid(&pyramid);
+                }
+            }
+            
+            // Region saved as <name>_gray_crop.png straight from the image rows (no copy)
+            if (use_crop && generate_grayscale_filename(image_path, output_filename, sizeof(output_filename))) {
+                GrayView crop_view;
+                if (gray_image_subview(&grayscale, crop[0], crop[1], crop[2], crop[3], &crop_view)) {
+                    size_t base_len = strlen(output_filename);
+                    if (base_len > 4 && strcmp(output_filename + base_len - 4, ".png") == 0) {
+                        base_len -= 4;
+                    }
+                    char crop_filename[280];
+                    snprintf(crop_filename, sizeof(crop_filename), "%.*s_crop.png", (int)base_len, output_filename);
+                    if (save_gray_view(&crop_view, crop_filename)) {
+                        printf("Recorte salvo como: %s\n", crop_filename);
+                    } else {
+                        printf("Erro ao salvar imagem: %s\n", crop_filename);
+                    }
+                } else {
+                    printf("Região fora da imagem: %d,%d %dx%d\n", crop[0], crop[1], crop[2], crop[3]);
+                }
+            }
+            
+            // Also keep a raw copy that reloads without decoding
+            if (save_raw && generate_grayscale_raw_filename(image_path, output_filename, sizeof(output_filename))) {
+                if (save_grayscale_raw(&grayscale, output_filename)) {
+                    printf("Arquivo bruto salvo como: %s\n", output_filename);
+                }
+            }
+            
+            // Free grayscale image
+            free_grayscale_image(&grayscale);
+        }
+        
+        profile_end_image();
+        if (profile) {
+            print_profile_report(image_path, &image_profile);
         }
     }
     
@@ -81,49 +471,73 @@ int main(int argc, char* argv[]) {
     for (int i = 0; i < num_test_files; i++) {
         printf("\nArquivo: %s\n", test_files[i]);
         
-        ImageData image;
-        ImageLoadError result = load_image(test_files[i], &image);
+        ImageAnalysis analysis;
+        GrayscaleImage grayscale;
+        ConversionCacheKey cache_key = {0};
+        bool converted = false;
         
-        if (result == IMG_SUCCESS) {
-            printf("  Carregado: %dx%d pixels, %d canais\n", 
-                   image.width, image.height, image.channels);
-            
-            // Check if grayscale
-            bool is_gray = is_image_grayscale(&image);
-            printf("  Tipo: %s\n", is_gray ? "Escala de cinza" : "Colorida");
+        profile_begin_image(&image_profile);
+        if (use_cache && conversion_cache_lookup(&cache, test_files[i], &cache_key, &analysis, &grayscale)) {
+            printf("  Servido do cache: %dx%d pixels\n", analysis.width, analysis.height);
+            converted = true;
+        } else {
+            ImageData image;
+            ImageLoadError result = load_image(test_files[i], &image);
             
-            // Convert to grayscale
-            GrayscaleImage grayscale;
-            if (get_grayscale_image(&image, &grayscale)) {
-                // Calculate basic statistics
-                ImageAnalysis gray_stats;
-                if (calculate_grayscale_stats(&grayscale, &gray_stats)) {
-                    printf("  Intensidade media: %.1f\n", gray_stats.avg_intensity);
-                    printf("  Contraste: %d\n", gray_stats.max_intensity - gray_stats.min_intensity);
+            if (result == IMG_SUCCESS) {
+                printf("  Carregado: %dx%d pixels, %d canais\n", 
+                       image.width, image.height, image.channels);
+                
+                // Check color, convert to grayscale and get statistics in one pass
+                converted = analyze_and_convert_image(&image, &analysis, &grayscale);
+                if (converted && use_cache) {
+                    conversion_cache_store(&cache, &cache_key, &analysis, &grayscale);
                 }
                 
-                // Save grayscale image
-                char output_filename[256];
-                if (generate_grayscale_filename(test_files[i], output_filename, sizeof(output_filename))) {
-                    if (save_grayscale_image(&grayscale, output_filename)) {
-                        printf("  Salvo como: %s\n", output_filename);
-                    } else {
-                        printf("  Erro ao salvar imagem em escala de cinza\n");
-                    }
+                free_image_data(&image);
+            } else {
+                printf("  Erro: %s\n", get_image_error_string(result));
+            }
+        }
+        
+        if (converted) {
+            printf("  Tipo: %s\n", analysis.is_grayscale ? "Escala de cinza" : "Colorida");
+            printf("  Intensidade media: %.1f\n", analysis.avg_intensity);
+            printf("  Contraste: %d\n", analysis.max_intensity - analysis.min_intensity);
+            
+            // Save grayscale image
+            char output_filename[256];
+            if (generate_grayscale_filename(test_files[i], output_filename, sizeof(output_filename))) {
+                if (save_grayscale_image(&grayscale, output_filename)) {
+                    printf("  Salvo como: %s\n", output_filename);
                 } else {
-                    printf("  Erro ao gerar nome do arquivo de saida\n");
+                    printf("  Erro ao salvar imagem em escala de cinza\n");
                 }
-                
-                free_grayscale_image(&grayscale);
+            } else {
+                printf("  Erro ao gerar nome do arquivo de saida\n");
             }
             
-            free_image_data(&image);
-        } else {
-            printf("  Erro: %s\n", get_image_error_string(result));
+            free_grayscale_image(&grayscale);
+        }
+        
+        profile_end_image();
+        if (profile) {
+            print_profile_report(test_files[i], &image_profile);
         }
     }
     
+    if (use_cache) {
+        print_conversion_cache_stats(&cache);
+    }
+    
+    if (profile) {
+        ProfileReport totals;
+        profile_get_totals(&totals);
+        print_profile_report("Agregado", &totals);
+    }
+    
     // Cleanup before exit
+    shutdown_analysis_threads();
     image_loader_cleanup();
     
     printf("\nPrograma concluído com sucesso.\n");
@@ -0,0 +1,306 @@
+#include "point_ops.h"
+#include "cpu_features.h"
+#include "profiler.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef void (*LutRowFunc)(Uint8* pixels, size_t count, const PointLut* lut);
+
+// ---------------------------------------------------------------------------
+// LUT builders
+// ---------------------------------------------------------------------------
+
+void lut_identity(PointLut* lut) {
+    for (int v = 0; v < 256; v++) {
+        lut->table[v] = (Uint8)v;
+    }
+}
+
+bool lut_contrast_stretch(PointLut* lut, int low, int high) {
+    if (low < 0 || high > 255 || low >= high) {
+        lut_identity(lut);
+        return false;
+    }
+
+    int range = high - low;
+    for (int v = 0; v < 256; v++) {
+        if (v <= low) {
+            lut->table[v] = 0;
+        } else if (v >= high) {
+            lut->table[v] = 255;
+        } else {
+            lut->table[v] = (Uint8)(((v - low) * 255 + range / 2) / range);
+        }
+    }
+    return true;
+}
+
+bool lut_gamma(PointLut* lut, double gamma) {
+    if (!(gamma > 0.0)) {
+        lut_identity(lut);
+        return false;
+    }
+
+    for (int v = 0; v < 256; v++) {
+        long mapped = lround(255.0 * pow(v / 255.0, gamma));
+        lut->table[v] = (Uint8)(mapped < 0 ? 0 : (mapped > 255 ? 255 : mapped));
+    }
+    return true;
+}
+
+bool lut_equalize(PointLut* lut, const GrayscaleHistogram* histogram) {
+    if (!histogram || histogram->total == 0) {
+        lut_identity(lut);
+        return false;
+    }
+
+    // The first occupied bin maps to 0 and the last to 255
+    Uint64 first_count = 0;
+    for (int v = 0; v < 256 && first_count == 0; v++) {
+        first_count = histogram->bins[v];
+    }
+
+    Uint64 span = histogram->total - first_count;
+    if (span == 0) {
+        lut_identity(lut);
+        return true;
+    }
+
+    Uint64 cumulative = 0;
+    for (int v = 0; v < 256; v++) {
+        cumulative += histogram->bins[v];
+        if (cumulative < first_count) {
+            lut->table[v] = 0;
+        } else {
+            lut->table[v] = (Uint8)(((cumulative - first_count) * 255 + span / 2) / span);
+        }
+    }
+    return true;
+}
+
+void lut_threshold(PointLut* lut, int threshold) {
+    for (int v = 0; v < 256; v++) {
+        lut->table[v] = (v >= threshold) ? 255 : 0;
+    }
+}
+
+void lut_invert(PointLut* lut) {
+    for (int v = 0; v < 256; v++) {
+        lut->table[v] = (Uint8)(255 - v);
+    }
+}
+
+void lut_compose(PointLut* lut, const PointLut* next) {
+    for (int v = 0; v < 256; v++) {
+        lut->table[v] = next->table[lut->table[v]];
+    }
+}
+
+void lut_map_histogram(const GrayscaleHistogram* histogram, const PointLut* lut, GrayscaleHistogram* mapped) {
+    histogram_reset(mapped);
+    for (int v = 0; v < 256; v++) {
+        mapped->bins[lut->table[v]] += histogram->bins[v];
+    }
+    mapped->total = histogram->total;
+}
+
+static bool lut_is_identity(const PointLut* lut) {
+    for (int v = 0; v < 256; v++) {
+        if (lut->table[v] != v) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// LUT application
+// ---------------------------------------------------------------------------
+
+static void apply_lut_scalar(Uint8* pixels, size_t count, const PointLut* lut) {
+    const Uint8* table = lut->table;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        Uint8 a = table[pixels[i]];
+        Uint8 b = table[pixels[i + 1]];
+        Uint8 c = table[pixels[i + 2]];
+        Uint8 d = table[pixels[i + 3]];
+        pixels[i] = a;
+        pixels[i + 1] = b;
+        pixels[i + 2] = c;
+        pixels[i + 3] = d;
+    }
+    for (; i < count; i++) {
+        pixels[i] = table[pixels[i]];
+    }
+}
+
+#ifdef CPU_FEATURES_X86
+
+// The table is cut into 16 slices of 16 entries; pshufb looks every pixel's
+// low nibble up in each slice and a compare on the high nibble keeps the
+// result of the right slice
+TARGET_AVX2
+static void apply_lut_avx2(Uint8* pixels, size_t count, const PointLut* lut) {
+    __m256i slices[16];
+    for (int k = 0; k < 16; k++) {
+        slices[k] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(lut->table + 16 * k)));
+    }
+
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i in = _mm256_loadu_si256((const __m256i*)(pixels + i));
+        __m256i low = _mm256_and_si256(in, nibble);
+        __m256i high = _mm256_and_si256(_mm256_srli_epi16(in, 4), nibble);
+        __m256i result = _mm256_setzero_si256();
+        for (int k = 0; k < 16; k++) {
+            __m256i select = _mm256_cmpeq_epi8(high, _mm256_set1_epi8((char)k));
+            result = _mm256_or_si256(result, _mm256_and_si256(select, _mm256_shuffle_epi8(slices[k], low)));
+        }
+        _mm256_storeu_si256((__m256i*)(pixels + i), result);
+    }
+
+    apply_lut_scalar(pixels + i, count - i, lut);
+}
+
+#endif // CPU_FEATURES_X86
+
+// Pick the LUT kernel; SSSE3 shuffles are not faster than scalar table
+// loads, so only AVX2 gets a vector path
+static LutRowFunc select_lut_kernel(void) {
+#ifdef CPU_FEATURES_X86
+    if (get_cpu_isa() == CPU_ISA_AVX2) {
+        return apply_lut_avx2;
+    }
+#endif
+    return apply_lut_scalar;
+}
+
+typedef struct {
+    GrayscaleImage* image;
+    const PointLut* lut;
+    LutRowFunc kernel;
+} LutJob;
+
+static void lut_band(void* context, int band, int row_begin, int row_end) {
+    LutJob* job = (LutJob*)context;
+    size_t width = (size_t)job->image->width;
+    (void)band;
+
+    job->kernel(job->image->pixels + row_begin * width, (size_t)(row_end - row_begin) * width, job->lut);
+}
+
+bool apply_point_lut(GrayscaleImage* grayscale_image, const PointLut* lut) {
+    if (!grayscale_image || !grayscale_image->pixels || !lut) {
+        return false;
+    }
+    if (lut_is_identity(lut)) {
+        return true;
+    }
+
+    LutJob job;
+    job.image = grayscale_image;
+    job.lut = lut;
+    job.kernel = select_lut_kernel();
+
+    PROFILE_START(filter_start);
+    thread_pool_run_bands(get_analysis_pool(), grayscale_image->height, lut_band, &job);
+    PROFILE_STOP(PROFILE_STAGE_FILTER, filter_start, grayscale_image->data_size);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Chains
+// ---------------------------------------------------------------------------
+
+static bool point_op_needs_histogram(PointOpType type) {
+    return type == POINT_OP_STRETCH || type == POINT_OP_EQUALIZE;
+}
+
+bool point_op_chain_add(PointOpChain* chain, PointOpType type, double value) {
+    if (!chain || chain->count >= POINT_OPS_MAX) {
+        return false;
+    }
+    if (type == POINT_OP_GAMMA && !(value > 0.0)) {
+        return false;
+    }
+    if (type == POINT_OP_THRESHOLD && (value < 0.0 || value > 256.0)) {
+        return false;
+    }
+
+    chain->ops[chain->count].type = type;
+    chain->ops[chain->count].value = value;
+    chain->count++;
+    return true;
+}
+
+bool build_point_op_lut(const PointOpChain* chain, const GrayscaleHistogram* histogram, PointLut* lut) {
+    if (!chain || !lut) {
+        return false;
+    }
+
+    lut_identity(lut);
+    for (int i = 0; i < chain->count; i++) {
+        const PointOp* op = &chain->ops[i];
+        PointLut step;
+        GrayscaleHistogram mapped;
+
+        if (point_op_needs_histogram(op->type)) {
+            if (!histogram) {
+                return false;
+            }
+            lut_map_histogram(histogram, lut, &mapped);
+        }
+
+        switch (op->type) {
+            case POINT_OP_STRETCH: {
+                HistogramStats stats;
+                if (!histogram_get_stats(&mapped, &stats) || !lut_contrast_stretch(&step, stats.min, stats.max)) {
+                    lut_identity(&step);
+                }
+                break;
+            }
+            case POINT_OP_GAMMA:
+                lut_gamma(&step, op->value);
+                break;
+            case POINT_OP_EQUALIZE:
+                lut_equalize(&step, &mapped);
+                break;
+            case POINT_OP_THRESHOLD:
+                lut_threshold(&step, (int)op->value);
+                break;
+            case POINT_OP_INVERT:
+                lut_invert(&step);
+                break;
+            default:
+                lut_identity(&step);
+                break;
+        }
+        lut_compose(lut, &step);
+    }
+    return true;
+}
+
+bool apply_point_op_chain(GrayscaleImage* grayscale_image, const PointOpChain* chain) {
+    if (!grayscale_image || !grayscale_image->pixels || !chain) {
+        return false;
+    }
+
+    bool needs_histogram = false;
+    for (int i = 0; i < chain->count; i++) {
+        needs_histogram = needs_histogram || point_op_needs_histogram(chain->ops[i].type);
+    }
+
+    GrayscaleHistogram histogram;
+    if (needs_histogram && !calculate_grayscale_histogram(grayscale_image, &histogram)) {
+        return false;
+    }
+
+    PointLut lut;
+    if (!build_point_op_lut(chain, needs_histogram ? &histogram : NULL, &lut)) {
+        return false;
+    }
+    return apply_point_lut(grayscale_image, &lut);
+}
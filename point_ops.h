@@ -0,0 +1,137 @@
+#ifndef POINT_OPS_H
+#define POINT_OPS_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include "image_analysis.h"
+#include "histogram.h"
+
+// Most operations in one chain
+#define POINT_OPS_MAX 16
+
+// Intensity mapping applied to every pixel (out = table[in])
+typedef struct {
+    Uint8 table[256];
+} PointLut;
+
+// Point operations that can be chained
+typedef enum {
+    POINT_OP_STRETCH = 0,   // Linear stretch of [min, max] to [0, 255]
+    POINT_OP_GAMMA,         // out = 255 * (in / 255)^value
+    POINT_OP_EQUALIZE,      // Histogram equalization
+    POINT_OP_THRESHOLD,     // 255 if in >= value, else 0
+    POINT_OP_INVERT         // 255 - in
+} PointOpType;
+
+typedef struct {
+    PointOpType type;
+    double value;           // Gamma exponent or threshold (unused otherwise)
+} PointOp;
+
+// Operations applied in order; the whole chain becomes one LUT
+typedef struct {
+    PointOp ops[POINT_OPS_MAX];
+    int count;
+} PointOpChain;
+
+/**
+ * Fill a LUT with the identity mapping
+ * @param lut LUT to fill
+ */
+void lut_identity(PointLut* lut);
+
+/**
+ * Fill a LUT with a linear stretch of [low, high] to [0, 255]
+ * Values below low map to 0 and above high to 255
+ * @param lut LUT to fill
+ * @param low Input mapped to 0
+ * @param high Input mapped to 255
+ * @return true on success, false if the range is invalid (identity is left in lut)
+ */
+bool lut_contrast_stretch(PointLut* lut, int low, int high);
+
+/**
+ * Fill a LUT with a gamma curve (exponent below 1 brightens, above 1 darkens)
+ * @param lut LUT to fill
+ * @param gamma Exponent (> 0)
+ * @return true on success, false if gamma is not positive
+ */
+bool lut_gamma(PointLut* lut, double gamma);
+
+/**
+ * Fill a LUT that equalizes a histogram (spreads the cumulative distribution over [0, 255])
+ * @param lut LUT to fill
+ * @param histogram Histogram of the image to equalize
+ * @return true on success, false if the histogram is empty
+ */
+bool lut_equalize(PointLut* lut, const GrayscaleHistogram* histogram);
+
+/**
+ * Fill a LUT with a binary threshold
+ * @param lut LUT to fill
+ * @param threshold Smallest input mapped to 255
+ */
+void lut_threshold(PointLut* lut, int threshold);
+
+/**
+ * Fill a LUT with the inverse mapping (negative)
+ * @param lut LUT to fill
+ */
+void lut_invert(PointLut* lut);
+
+/**
+ * Compose two LUTs: lut becomes next(lut(x))
+ * @param lut LUT applied first, replaced by the composition
+ * @param next LUT applied second
+ */
+void lut_compose(PointLut* lut, const PointLut* next);
+
+/**
+ * Map a histogram through a LUT, giving the histogram of the mapped image
+ * without touching its pixels
+ * @param histogram Histogram before the mapping
+ * @param lut Mapping
+ * @param mapped Pointer to store the mapped histogram
+ */
+void lut_map_histogram(const GrayscaleHistogram* histogram, const PointLut* lut, GrayscaleHistogram* mapped);
+
+/**
+ * Apply a LUT to the pixels of an image in place
+ * Rows are split in bands over the analysis thread pool; the lookups use
+ * AVX2 byte shuffles when available
+ * @param grayscale_image Image to modify
+ * @param lut Mapping
+ * @return true on success, false on invalid input
+ */
+bool apply_point_lut(GrayscaleImage* grayscale_image, const PointLut* lut);
+
+/**
+ * Append an operation to a chain
+ * @param chain Chain to extend
+ * @param type Operation
+ * @param value Gamma exponent or threshold (ignored by the other operations)
+ * @return true on success, false if the chain is full or value is invalid
+ */
+bool point_op_chain_add(PointOpChain* chain, PointOpType type, double value);
+
+/**
+ * Build the LUT of a whole chain for an image
+ * Data-dependent steps (stretch, equalize) use the histogram of the image as
+ * transformed by the previous steps, obtained by mapping its histogram, so
+ * the pixels are read once whatever the chain length
+ * @param chain Operations
+ * @param histogram Histogram of the image (may be NULL if no step needs it)
+ * @param lut Pointer to store the composed LUT
+ * @return true on success, false if a step needs a histogram and none was given
+ */
+bool build_point_op_lut(const PointOpChain* chain, const GrayscaleHistogram* histogram, PointLut* lut);
+
+/**
+ * Apply a chain to an image in place (one histogram pass if needed, one LUT pass)
+ * @param grayscale_image Image to modify
+ * @param chain Operations
+ * @return true on success, false on failure
+ */
+bool apply_point_op_chain(GrayscaleImage* grayscale_image, const PointOpChain* chain);
+
+#endif // POINT_OPS_H
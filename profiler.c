@@ -0,0 +1,187 @@
+#include "profiler.h"
+#include <stdio.h>
+#include <string.h>
+
+static bool g_enabled = false;
+
+// Process totals, guarded by g_lock (probes fire per pass, not per pixel)
+static ProfileReport g_totals;
+static Uint64 g_bytes_in_use = 0;
+static SDL_SpinLock g_lock = 0;
+
+// Report the calling thread collects into, if any
+static SDL_TLSID g_current_report = 0;
+
+static const char* g_stage_names[PROFILE_STAGE_COUNT] = {
+    "E/S de arquivo",
+    "Decodificacao",
+    "Analise",
+    "Conversao",
+    "Estatisticas",
+    "Codificacao",
+    "Filtros",
+};
+
+void profile_set_enabled(bool enabled) {
+    SDL_AtomicLock(&g_lock);
+    if (enabled && g_current_report == 0) {
+        g_current_report = SDL_TLSCreate();
+    }
+    g_enabled = enabled;
+    SDL_AtomicUnlock(&g_lock);
+}
+
+bool profile_is_enabled(void) {
+    return g_enabled;
+}
+
+Uint64 profile_now(void) {
+    return g_enabled ? SDL_GetPerformanceCounter() : 0;
+}
+
+static ProfileReport* current_report(void) {
+    return g_current_report ? (ProfileReport*)SDL_TLSGet(g_current_report) : NULL;
+}
+
+static void add_stage(ProfileStageStats* stats, Uint64 ticks, Uint64 bytes, Uint64 calls) {
+    stats->calls += calls;
+    stats->ticks += ticks;
+    stats->bytes += bytes;
+}
+
+void profile_add(ProfileStage stage, Uint64 ticks, Uint64 bytes, Uint64 calls) {
+    if (!g_enabled || (unsigned)stage >= PROFILE_STAGE_COUNT) {
+        return;
+    }
+
+    ProfileReport* report = current_report();
+
+    SDL_AtomicLock(&g_lock);
+    add_stage(&g_totals.stages[stage], ticks, bytes, calls);
+    if (report) {
+        add_stage(&report->stages[stage], ticks, bytes, calls);
+    }
+    SDL_AtomicUnlock(&g_lock);
+}
+
+void profile_record(ProfileStage stage, Uint64 start, Uint64 bytes) {
+    if (!g_enabled) {
+        return;
+    }
+    profile_add(stage, SDL_GetPerformanceCounter() - start, bytes, 1);
+}
+
+void profile_track_alloc(Uint64 bytes) {
+    if (!g_enabled) {
+        return;
+    }
+
+    ProfileReport* report = current_report();
+
+    SDL_AtomicLock(&g_lock);
+    g_bytes_in_use += bytes;
+    if (g_bytes_in_use > g_totals.peak_bytes) {
+        g_totals.peak_bytes = g_bytes_in_use;
+    }
+    if (report && g_bytes_in_use > report->peak_bytes) {
+        report->peak_bytes = g_bytes_in_use;
+    }
+    SDL_AtomicUnlock(&g_lock);
+}
+
+void profile_track_free(Uint64 bytes) {
+    if (!g_enabled) {
+        return;
+    }
+
+    SDL_AtomicLock(&g_lock);
+    // Buffers allocated before profiling was enabled were never counted
+    g_bytes_in_use = (bytes < g_bytes_in_use) ? g_bytes_in_use - bytes : 0;
+    SDL_AtomicUnlock(&g_lock);
+}
+
+void profile_resume_image(ProfileReport* report) {
+    if (!g_enabled || !report) {
+        return;
+    }
+
+    SDL_TLSSet(g_current_report, report, NULL);
+
+    SDL_AtomicLock(&g_lock);
+    if (g_bytes_in_use > report->peak_bytes) {
+        report->peak_bytes = g_bytes_in_use;
+    }
+    SDL_AtomicUnlock(&g_lock);
+}
+
+void profile_begin_image(ProfileReport* report) {
+    if (!g_enabled || !report) {
+        return;
+    }
+
+    memset(report, 0, sizeof(ProfileReport));
+    report->images = 1;
+
+    SDL_AtomicLock(&g_lock);
+    g_totals.images++;
+    SDL_AtomicUnlock(&g_lock);
+
+    profile_resume_image(report);
+}
+
+void profile_end_image(void) {
+    if (!g_enabled) {
+        return;
+    }
+    SDL_TLSSet(g_current_report, NULL, NULL);
+}
+
+void profile_get_totals(ProfileReport* report) {
+    if (!report) {
+        return;
+    }
+
+    SDL_AtomicLock(&g_lock);
+    *report = g_totals;
+    SDL_AtomicUnlock(&g_lock);
+}
+
+void profile_reset_totals(void) {
+    SDL_AtomicLock(&g_lock);
+    memset(&g_totals, 0, sizeof(ProfileReport));
+    g_totals.peak_bytes = g_bytes_in_use;
+    SDL_AtomicUnlock(&g_lock);
+}
+
+void print_profile_report(const char* title, const ProfileReport* report) {
+    if (!report) {
+        return;
+    }
+
+    double frequency = (double)SDL_GetPerformanceFrequency();
+    Uint64 total_ticks = 0;
+    for (int i = 0; i < PROFILE_STAGE_COUNT; i++) {
+        total_ticks += report->stages[i].ticks;
+    }
+
+    printf("\n=== Perfil: %s ===\n", title ? title : "");
+    printf("%-16s %8s %12s %7s %12s %12s\n", "Etapa", "Chamadas", "Tempo (ms)", "%", "MB", "MB/s");
+
+    for (int i = 0; i < PROFILE_STAGE_COUNT; i++) {
+        const ProfileStageStats* stats = &report->stages[i];
+        double seconds = stats->ticks / frequency;
+        double megabytes = stats->bytes / (1024.0 * 1024.0);
+        double share = total_ticks > 0 ? 100.0 * stats->ticks / total_ticks : 0.0;
+
+        printf("%-16s %8llu %12.3f %6.1f%% %12.2f %12.1f\n", g_stage_names[i],
+               (unsigned long long)stats->calls, seconds * 1000.0, share, megabytes,
+               seconds > 0 ? megabytes / seconds : 0.0);
+    }
+
+    printf("%-16s %8s %12.3f\n", "Total", "", total_ticks / frequency * 1000.0);
+    if (report->images > 1) {
+        printf("Imagens: %d\n", report->images);
+    }
+    printf("Pico de memoria: %.2f MB\n", report->peak_bytes / (1024.0 * 1024.0));
+    printf("================================\n");
+}
@@ -0,0 +1,139 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Lightweight instrumentation for the hot paths
+// Stages are timed with the monotonic performance counter and only recorded
+// while profiling is enabled at run time (--profile); build with
+// -DIMAGE_PROFILE_DISABLED to compile every probe out
+
+typedef enum {
+    PROFILE_STAGE_FILE_IO = 0,  // File reads/writes outside the codecs
+    PROFILE_STAGE_DECODE,       // Image decoding (IMG_Load, libpng/libjpeg reads)
+    PROFILE_STAGE_ANALYZE,      // Color analysis
+    PROFILE_STAGE_CONVERT,      // Grayscale conversion (including the fused pass)
+    PROFILE_STAGE_STATS,        // Histogram and statistics
+    PROFILE_STAGE_ENCODE,       // PNG encoding
+    PROFILE_STAGE_FILTER,       // Filters (convolution, blur, point operations)
+    PROFILE_STAGE_COUNT
+} ProfileStage;
+
+// Counters for one stage
+typedef struct {
+    Uint64 calls;
+    Uint64 ticks;           // Performance counter ticks spent in the stage
+    Uint64 bytes;           // Bytes produced or consumed by the stage
+} ProfileStageStats;
+
+// Per-image or aggregated profile
+typedef struct {
+    ProfileStageStats stages[PROFILE_STAGE_COUNT];
+    Uint64 peak_bytes;      // Peak of tracked heap bytes in use while recording
+    int images;             // Images covered by the report
+} ProfileReport;
+
+#ifndef IMAGE_PROFILE_DISABLED
+
+// Start a scoped timer named var
+#define PROFILE_START(var) Uint64 var = profile_now()
+// Stop the timer var and charge it (and a byte count) to a stage
+#define PROFILE_STOP(stage, var, bytes) profile_record((stage), (var), (Uint64)(bytes))
+// Add already measured ticks to a stage
+#define PROFILE_ADD(stage, ticks, bytes) profile_add((stage), (ticks), (Uint64)(bytes), 1)
+// Track large heap buffers for the peak-allocation figure
+#define PROFILE_ALLOC(bytes) profile_track_alloc((Uint64)(bytes))
+#define PROFILE_FREE(bytes) profile_track_free((Uint64)(bytes))
+
+#else
+
+#define PROFILE_START(var) ((void)0)
+#define PROFILE_STOP(stage, var, bytes) ((void)0)
+#define PROFILE_ADD(stage, ticks, bytes) ((void)0)
+#define PROFILE_ALLOC(bytes) ((void)0)
+#define PROFILE_FREE(bytes) ((void)0)
+
+#endif // IMAGE_PROFILE_DISABLED
+
+/**
+ * Enable or disable recording (disabled by default)
+ * @param enabled Whether probes record
+ */
+void profile_set_enabled(bool enabled);
+
+/**
+ * Check whether recording is enabled
+ * @return true if probes record
+ */
+bool profile_is_enabled(void);
+
+/**
+ * Read the monotonic clock for a timer
+ * @return Performance counter value, or 0 while profiling is disabled
+ */
+Uint64 profile_now(void);
+
+/**
+ * Charge the time elapsed since start to a stage
+ * @param stage Stage to charge
+ * @param start Value returned by profile_now
+ * @param bytes Bytes processed
+ */
+void profile_record(ProfileStage stage, Uint64 start, Uint64 bytes);
+
+/**
+ * Add measured ticks to a stage
+ * @param stage Stage to charge
+ * @param ticks Performance counter ticks
+ * @param bytes Bytes processed
+ * @param calls Number of calls the ticks cover
+ */
+void profile_add(ProfileStage stage, Uint64 ticks, Uint64 bytes, Uint64 calls);
+
+/**
+ * Record a heap allocation / release for peak tracking
+ * @param bytes Size of the buffer
+ */
+void profile_track_alloc(Uint64 bytes);
+void profile_track_free(Uint64 bytes);
+
+/**
+ * Start collecting the probes of the calling thread into a report
+ * (in addition to the process totals); the report is cleared first
+ * @param report Report for the image being processed
+ */
+void profile_begin_image(ProfileReport* report);
+
+/**
+ * Resume collecting into a report without clearing it
+ * Used when an image moves between threads (e.g. batch pipeline stages)
+ * @param report Report to continue
+ */
+void profile_resume_image(ProfileReport* report);
+
+/**
+ * Stop collecting into the calling thread's report
+ */
+void profile_end_image(void);
+
+/**
+ * Get the totals recorded since start (or the last reset)
+ * @param report Pointer to store the totals
+ */
+void profile_get_totals(ProfileReport* report);
+
+/**
+ * Clear the totals
+ */
+void profile_reset_totals(void);
+
+/**
+ * Print a per-stage breakdown
+ * @param title Heading (e.g. the image name)
+ * @param report Report to print
+ */
+void print_profile_report(const char* title, const ProfileReport* report);
+
+#endif // PROFILER_H
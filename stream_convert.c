@@ -0,0 +1,371 @@
+#include "stream_convert.h"
+#include "grayscale_simd.h"
+#include "gray_png.h"
+#include "profiler.h"
+#include <png.h>
+#include <jpeglib.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+    STREAM_FORMAT_UNKNOWN = 0,
+    STREAM_FORMAT_PNG,
+    STREAM_FORMAT_JPEG
+} StreamFormat;
+
+typedef struct {
+    struct jpeg_error_mgr pub;
+    jmp_buf jump;
+} JpegErrorManager;
+
+// Row source for one decoder; rows come out as 8-bit gray (1 channel) or RGB (3)
+typedef struct {
+    StreamFormat format;
+    FILE* file;
+    int width;
+    int height;
+    int channels;
+    ColorType color_type;       // Of the source file, before expansion and alpha stripping
+    bool has_transparency;      // Alpha channel or tRNS chunk in the source
+    png_structp png;
+    png_infop png_info;
+    struct jpeg_decompress_struct jpeg;
+    JpegErrorManager jpeg_error;
+    bool jpeg_created;
+} StreamReader;
+
+static void jpeg_error_exit(j_common_ptr cinfo) {
+    JpegErrorManager* error = (JpegErrorManager*)cinfo->err;
+    char message[JMSG_LENGTH_MAX];
+
+    (*cinfo->err->format_message)(cinfo, message);
+    fprintf(stderr, "Erro JPEG: %s\n", message);
+    longjmp(error->jump, 1);
+}
+
+static StreamFormat detect_format(FILE* file) {
+    unsigned char header[8];
+    size_t read = fread(header, 1, sizeof(header), file);
+    rewind(file);
+
+    if (read == sizeof(header) && png_sig_cmp(header, 0, sizeof(header)) == 0) {
+        return STREAM_FORMAT_PNG;
+    }
+    if (read >= 3 && header[0] == 0xFF && header[1] == 0xD8 && header[2] == 0xFF) {
+        return STREAM_FORMAT_JPEG;
+    }
+    return STREAM_FORMAT_UNKNOWN;
+}
+
+// ---------------------------------------------------------------------------
+// Reader
+// ---------------------------------------------------------------------------
+
+static bool open_png_reader(StreamReader* reader) {
+    reader->png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    if (!reader->png) {
+        return false;
+    }
+    reader->png_info = png_create_info_struct(reader->png);
+    if (!reader->png_info) {
+        return false;
+    }
+
+    if (setjmp(png_jmpbuf(reader->png))) {
+        return false;
+    }
+
+    png_init_io(reader->png, reader->file);
+    png_read_info(reader->png, reader->png_info);
+
+    // Interlaced rows only become final after the last pass
+    if (png_get_interlace_type(reader->png, reader->png_info) != PNG_INTERLACE_NONE) {
+        fprintf(stderr, "PNG entrelacado nao suportado no modo streaming\n");
+        return false;
+    }
+
+    // Report the source layout the way analyze_image sees the surface
+    // SDL_image loads: alpha channels and palettes with more than one
+    // transparent or any translucent entry become RGBA, other palettes stay
+    // indexed (gray when every entry is gray)
+    int png_color_type = png_get_color_type(reader->png, reader->png_info);
+    png_bytep trans_alpha = NULL;
+    int trans_count = 0;
+    bool has_trns = png_get_valid(reader->png, reader->png_info, PNG_INFO_tRNS) &&
+                    png_get_tRNS(reader->png, reader->png_info, &trans_alpha, &trans_count, NULL);
+
+    if (png_color_type & PNG_COLOR_MASK_ALPHA) {
+        reader->color_type = COLOR_TYPE_RGBA;
+        reader->has_transparency = true;
+    } else if (png_color_type == PNG_COLOR_TYPE_PALETTE) {
+        png_colorp palette = NULL;
+        int palette_count = 0;
+        bool gray_palette = png_get_PLTE(reader->png, reader->png_info, &palette, &palette_count) != 0;
+        for (int i = 0; gray_palette && i < palette_count; i++) {
+            gray_palette = palette[i].red == palette[i].green && palette[i].green == palette[i].blue;
+        }
+
+        int transparent = 0;
+        bool translucent = false;
+        for (int i = 0; has_trns && trans_alpha && i < trans_count; i++) {
+            transparent += trans_alpha[i] == 0;
+            translucent = translucent || (trans_alpha[i] != 0 && trans_alpha[i] != 255);
+        }
+
+        if (transparent > 1 || translucent) {
+            reader->color_type = COLOR_TYPE_RGBA;
+        } else {
+            reader->color_type = gray_palette ? COLOR_TYPE_GRAYSCALE : COLOR_TYPE_INDEXED;
+        }
+        reader->has_transparency = transparent > 0 || translucent;
+    } else {
+        // tRNS on gray or RGB is a single transparent color
+        reader->color_type = (png_color_type == PNG_COLOR_TYPE_GRAY) ? COLOR_TYPE_GRAYSCALE : COLOR_TYPE_RGB;
+        reader->has_transparency = has_trns;
+    }
+
+    // Normalize to 8-bit gray or RGB: expand palettes and low bit depths,
+    // drop 16-bit precision and alpha (ignored by the luminance formula)
+    png_set_expand(reader->png);
+    png_set_strip_16(reader->png);
+    png_set_strip_alpha(reader->png);
+    png_read_update_info(reader->png, reader->png_info);
+
+    reader->width = (int)png_get_image_width(reader->png, reader->png_info);
+    reader->height = (int)png_get_image_height(reader->png, reader->png_info);
+    reader->channels = png_get_channels(reader->png, reader->png_info);
+    return reader->channels == 1 || reader->channels == 3;
+}
+
+static bool open_jpeg_reader(StreamReader* reader) {
+    reader->jpeg.err = jpeg_std_error(&reader->jpeg_error.pub);
+    reader->jpeg_error.pub.error_exit = jpeg_error_exit;
+
+    if (setjmp(reader->jpeg_error.jump)) {
+        return false;
+    }
+
+    jpeg_create_decompress(&reader->jpeg);
+    reader->jpeg_created = true;
+    jpeg_stdio_src(&reader->jpeg, reader->file);
+    jpeg_read_header(&reader->jpeg, TRUE);
+
+    // Progressive scans refine the whole image several times, so libjpeg
+    // keeps every coefficient in memory (O(width x height)) before any row
+    // is final; those files go through the regular path instead
+    if (reader->jpeg.progressive_mode) {
+        fprintf(stderr, "JPEG progressivo nao suportado no modo streaming\n");
+        return false;
+    }
+
+    if (reader->jpeg.jpeg_color_space == JCS_GRAYSCALE) {
+        reader->jpeg.out_color_space = JCS_GRAYSCALE;
+    } else if (reader->jpeg.jpeg_color_space == JCS_CMYK || reader->jpeg.jpeg_color_space == JCS_YCCK) {
+        fprintf(stderr, "JPEG CMYK nao suportado no modo streaming\n");
+        return false;
+    } else {
+        reader->jpeg.out_color_space = JCS_RGB;
+    }
+
+    jpeg_start_decompress(&reader->jpeg);
+
+    reader->width = (int)reader->jpeg.output_width;
+    reader->height = (int)reader->jpeg.output_height;
+    reader->channels = reader->jpeg.output_components;
+    reader->color_type = (reader->channels == 1) ? COLOR_TYPE_GRAYSCALE : COLOR_TYPE_RGB;
+    reader->has_transparency = false;
+    return true;
+}
+
+static void close_reader(StreamReader* reader) {
+    if (reader->png) {
+        png_destroy_read_struct(&reader->png, reader->png_info ? &reader->png_info : NULL, NULL);
+    }
+    if (reader->jpeg_created) {
+        jpeg_destroy_decompress(&reader->jpeg);
+        reader->jpeg_created = false;
+    }
+    if (reader->file) {
+        fclose(reader->file);
+        reader->file = NULL;
+    }
+}
+
+static bool open_reader(StreamReader* reader, const char* filename) {
+    memset(reader, 0, sizeof(StreamReader));
+
+    reader->file = fopen(filename, "rb");
+    if (!reader->file) {
+        return false;
+    }
+
+    bool ok = false;
+    reader->format = detect_format(reader->file);
+    if (reader->format == STREAM_FORMAT_PNG) {
+        ok = open_png_reader(reader);
+    } else if (reader->format == STREAM_FORMAT_JPEG) {
+        ok = open_jpeg_reader(reader);
+    }
+
+    if (!ok) {
+        close_reader(reader);
+    }
+    return ok;
+}
+
+// Decode the next rows into consecutive entries of row_pointers
+static bool read_rows(StreamReader* reader, Uint8** row_pointers, int rows) {
+    if (reader->format == STREAM_FORMAT_PNG) {
+        if (setjmp(png_jmpbuf(reader->png))) {
+            return false;
+        }
+        png_read_rows(reader->png, row_pointers, NULL, (png_uint_32)rows);
+        return true;
+    }
+
+    if (setjmp(reader->jpeg_error.jump)) {
+        return false;
+    }
+    int done = 0;
+    while (done < rows) {
+        JDIMENSION read = jpeg_read_scanlines(&reader->jpeg, row_pointers + done, (JDIMENSION)(rows - done));
+        if (read == 0) {
+            return false;
+        }
+        done += (int)read;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Conversion
+// ---------------------------------------------------------------------------
+
+bool is_streamable_image(const char* filename) {
+    StreamReader reader;
+    if (!filename || !open_reader(&reader, filename)) {
+        return false;
+    }
+    close_reader(&reader);
+    return true;
+}
+
+bool stream_convert_image(const char* input_path, const char* output_path, int strip_rows, ImageAnalysis* analysis) {
+    if (!input_path || !output_path) {
+        return false;
+    }
+    if (strip_rows <= 0) {
+        strip_rows = STREAM_DEFAULT_STRIP_ROWS;
+    }
+
+    StreamReader reader;
+    if (!open_reader(&reader, input_path)) {
+        fprintf(stderr, "Nao foi possivel abrir %s para streaming\n", input_path);
+        return false;
+    }
+
+    int width = reader.width;
+    int height = reader.height;
+    int channels = reader.channels;
+    ColorType color_type = reader.color_type;
+    bool has_transparency = reader.has_transparency;
+
+    // RGB strips go through the regular row kernels
+    SDL_PixelFormat* rgb_format = NULL;
+    GrayscaleConverter converter;
+    if (channels == 3) {
+        rgb_format = SDL_AllocFormat(SDL_PIXELFORMAT_RGB24);
+        if (!rgb_format || !init_grayscale_converter(&converter, rgb_format)) {
+            if (rgb_format) {
+                SDL_FreeFormat(rgb_format);
+            }
+            close_reader(&reader);
+            return false;
+        }
+    }
+
+    // Only one decoded strip and one gray strip are ever held in memory
+    size_t src_stride = (size_t)width * channels;
+    Uint8* src_strip = malloc(src_stride * strip_rows);
+    Uint8* gray_strip = (channels == 3) ? malloc((size_t)width * strip_rows) : src_strip;
+    Uint8** src_rows = malloc(sizeof(Uint8*) * strip_rows);
+    Uint8** gray_rows = malloc(sizeof(Uint8*) * strip_rows);
+
+    GrayPngWriter* writer = NULL;
+    bool ok = src_strip && gray_strip && src_rows && gray_rows &&
+              (writer = gray_png_open(output_path, width, height)) != NULL;
+
+    GrayscaleHistogram histogram;
+    HistogramAccumulator accumulator;
+    histogram_reset(&histogram);
+    histogram_accumulator_reset(&accumulator);
+    bool is_grayscale = true;
+
+    for (int y = 0; ok && y < height; y += strip_rows) {
+        int rows = (height - y < strip_rows) ? height - y : strip_rows;
+
+        for (int i = 0; i < rows; i++) {
+            src_rows[i] = src_strip + i * src_stride;
+            gray_rows[i] = gray_strip + (size_t)i * width;
+        }
+
+        PROFILE_START(decode_start);
+        bool read_ok = read_rows(&reader, src_rows, rows);
+        PROFILE_STOP(PROFILE_STAGE_DECODE, decode_start, src_stride * rows);
+        if (!read_ok) {
+            ok = false;
+            break;
+        }
+
+        PROFILE_START(convert_start);
+        for (int i = 0; i < rows; i++) {
+            if (channels == 3) {
+                if (is_grayscale && !converter.check(&converter, src_rows[i], width, GRAYSCALE_DEFAULT_TOLERANCE)) {
+                    is_grayscale = false;
+                }
+                converter.kernel(&converter, src_rows[i], gray_rows[i], width);
+            }
+
+            histogram_accumulator_add(&accumulator, &histogram, gray_rows[i], (size_t)width);
+        }
+        PROFILE_STOP(PROFILE_STAGE_CONVERT, convert_start, src_stride * rows);
+
+        PROFILE_START(encode_start);
+        ok = gray_png_write_rows(writer, gray_rows, rows);
+        PROFILE_STOP(PROFILE_STAGE_ENCODE, encode_start, (size_t)width * rows);
+    }
+
+    if (ok) {
+        ok = gray_png_finish(writer);
+    }
+    gray_png_close(writer);
+    if (!ok) {
+        remove(output_path);
+    }
+
+    if (gray_strip != src_strip) {
+        free(gray_strip);
+    }
+    free(src_strip);
+    free(src_rows);
+    free(gray_rows);
+    if (rgb_format) {
+        SDL_FreeFormat(rgb_format);
+    }
+    close_reader(&reader);
+
+    if (ok && analysis) {
+        memset(analysis, 0, sizeof(ImageAnalysis));
+        analysis->width = width;
+        analysis->height = height;
+        analysis->color_type = color_type;
+        analysis->is_grayscale = is_grayscale;
+        analysis->has_transparency = has_transparency;
+        histogram_accumulator_flush(&accumulator, &histogram);
+        apply_histogram_stats(&histogram, analysis);
+    }
+
+    return ok;
+}
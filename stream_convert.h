@@ -0,0 +1,36 @@
+#ifndef STREAM_CONVERT_H
+#define STREAM_CONVERT_H
+
+#include <stdbool.h>
+#include "image_analysis.h"
+
+// Rows decoded per step when no strip height is given
+#define STREAM_DEFAULT_STRIP_ROWS 16
+
+/**
+ * Check if a file can be converted by the streaming path
+ * Supported inputs are non-interlaced PNG and baseline JPEG (RGB or
+ * grayscale); progressive JPEGs are rejected, since libjpeg buffers their
+ * whole coefficient image. Only the file header is read
+ * @param filename Path to the image file
+ * @return true if stream_convert_image can handle the file
+ */
+bool is_streamable_image(const char* filename);
+
+/**
+ * Convert an image file to a grayscale PNG with bounded memory
+ * Rows are decoded strip by strip with libpng/libjpeg, converted with the
+ * luminance formula and written straight to an 8-bit grayscale PNG, so memory
+ * use is O(width x strip_rows) whatever the image height. Statistics matching
+ * calculate_grayscale_stats are computed on the fly.
+ * @param input_path Source PNG or JPEG file
+ * @param output_path Path of the grayscale PNG to write
+ * @param strip_rows Rows decoded per step (0 for STREAM_DEFAULT_STRIP_ROWS)
+ * Color type and transparency describe the source file (alpha is dropped
+ * before conversion) and match what analyze_image reports for it
+ * @param analysis Pointer to store analysis and intensity statistics (may be NULL)
+ * @return true on success, false on failure
+ */
+bool stream_convert_image(const char* input_path, const char* output_path, int strip_rows, ImageAnalysis* analysis);
+
+#endif // STREAM_CONVERT_H
@@ -0,0 +1,204 @@
+#include "thread_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+struct ThreadPool {
+    SDL_Thread** workers;
+    int worker_count;
+    SDL_mutex* mutex;
+    SDL_cond* work_ready;
+    SDL_cond* work_done;
+    bool shutting_down;
+    bool busy;
+
+    // Current job, protected by mutex
+    ThreadPoolBandFunc func;
+    void* context;
+    int rows;
+    int band_count;
+    int next_band;
+    int bands_remaining;
+};
+
+static void band_rows(int rows, int band_count, int band, int* row_begin, int* row_end) {
+    *row_begin = (int)((long long)rows * band / band_count);
+    *row_end = (int)((long long)rows * (band + 1) / band_count);
+}
+
+// Take and execute bands of the current job until none are left
+// Must be called with the mutex held; returns with it held
+static void drain_bands(ThreadPool* pool) {
+    while (pool->func && pool->next_band < pool->band_count) {
+        int band = pool->next_band++;
+        ThreadPoolBandFunc func = pool->func;
+        void* context = pool->context;
+        int row_begin, row_end;
+        band_rows(pool->rows, pool->band_count, band, &row_begin, &row_end);
+
+        SDL_UnlockMutex(pool->mutex);
+        func(context, band, row_begin, row_end);
+        SDL_LockMutex(pool->mutex);
+
+        if (--pool->bands_remaining == 0) {
+            SDL_CondSignal(pool->work_done);
+        }
+    }
+}
+
+static int worker_main(void* data) {
+    ThreadPool* pool = (ThreadPool*)data;
+
+    SDL_LockMutex(pool->mutex);
+    while (!pool->shutting_down) {
+        if (!pool->func || pool->next_band >= pool->band_count) {
+            SDL_CondWait(pool->work_ready, pool->mutex);
+            continue;
+        }
+        drain_bands(pool);
+    }
+    SDL_UnlockMutex(pool->mutex);
+    return 0;
+}
+
+ThreadPool* thread_pool_create(int thread_count) {
+    if (thread_count <= 0) {
+        thread_count = SDL_GetCPUCount();
+    }
+    if (thread_count <= 0) {
+        thread_count = 1;
+    }
+
+    ThreadPool* pool = calloc(1, sizeof(ThreadPool));
+    if (!pool) {
+        return NULL;
+    }
+
+    pool->mutex = SDL_CreateMutex();
+    pool->work_ready = SDL_CreateCond();
+    pool->work_done = SDL_CreateCond();
+    if (!pool->mutex || !pool->work_ready || !pool->work_done) {
+        thread_pool_destroy(pool);
+        return NULL;
+    }
+
+    if (thread_count > 1) {
+        pool->workers = calloc((size_t)(thread_count - 1), sizeof(SDL_Thread*));
+        if (!pool->workers) {
+            thread_pool_destroy(pool);
+            return NULL;
+        }
+
+        for (int i = 0; i < thread_count - 1; i++) {
+            pool->workers[i] = SDL_CreateThread(worker_main, "band_worker", pool);
+            if (!pool->workers[i]) {
+                // Keep whatever workers did start
+                fprintf(stderr, "Could not create worker thread: %s\n", SDL_GetError());
+                break;
+            }
+            pool->worker_count++;
+        }
+    }
+
+    return pool;
+}
+
+void thread_pool_destroy(ThreadPool* pool) {
+    if (!pool) {
+        return;
+    }
+
+    if (pool->mutex) {
+        SDL_LockMutex(pool->mutex);
+        pool->shutting_down = true;
+        SDL_CondBroadcast(pool->work_ready);
+        SDL_UnlockMutex(pool->mutex);
+    }
+
+    for (int i = 0; i < pool->worker_count; i++) {
+        SDL_WaitThread(pool->workers[i], NULL);
+    }
+    free(pool->workers);
+
+    if (pool->work_done) {
+        SDL_DestroyCond(pool->work_done);
+    }
+    if (pool->work_ready) {
+        SDL_DestroyCond(pool->work_ready);
+    }
+    if (pool->mutex) {
+        SDL_DestroyMutex(pool->mutex);
+    }
+    free(pool);
+}
+
+int thread_pool_get_thread_count(const ThreadPool* pool) {
+    return pool ? pool->worker_count + 1 : 1;
+}
+
+int thread_pool_get_band_count(const ThreadPool* pool, int rows) {
+    int threads = thread_pool_get_thread_count(pool);
+    if (threads <= 1 || rows <= 0) {
+        return 1;
+    }
+
+    // A few bands per thread keeps the load balanced when bands differ in cost
+    int bands = threads * 4;
+    int max_by_rows = rows / THREAD_POOL_MIN_BAND_ROWS;
+
+    if (bands > max_by_rows) {
+        bands = max_by_rows;
+    }
+    if (bands > THREAD_POOL_MAX_BANDS) {
+        bands = THREAD_POOL_MAX_BANDS;
+    }
+    return bands > 0 ? bands : 1;
+}
+
+int thread_pool_run_bands(ThreadPool* pool, int rows, ThreadPoolBandFunc func, void* context) {
+    if (!func || rows <= 0) {
+        return 0;
+    }
+
+    int band_count = thread_pool_get_band_count(pool, rows);
+
+    bool run_inline = (band_count == 1);
+    if (!run_inline) {
+        SDL_LockMutex(pool->mutex);
+        run_inline = pool->busy;
+        if (run_inline) {
+            SDL_UnlockMutex(pool->mutex);
+        }
+    }
+
+    if (run_inline) {
+        // Same band layout as the threaded path so partial results line up
+        for (int band = 0; band < band_count; band++) {
+            int row_begin, row_end;
+            band_rows(rows, band_count, band, &row_begin, &row_end);
+            func(context, band, row_begin, row_end);
+        }
+        return band_count;
+    }
+
+    pool->busy = true;
+    pool->func = func;
+    pool->context = context;
+    pool->rows = rows;
+    pool->band_count = band_count;
+    pool->next_band = 0;
+    pool->bands_remaining = band_count;
+    SDL_CondBroadcast(pool->work_ready);
+
+    // The caller works on bands too instead of just waiting
+    drain_bands(pool);
+    while (pool->bands_remaining > 0) {
+        SDL_CondWait(pool->work_done, pool->mutex);
+    }
+
+    pool->func = NULL;
+    pool->context = NULL;
+    pool->busy = false;
+    SDL_UnlockMutex(pool->mutex);
+
+    return band_count;
+}
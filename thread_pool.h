@@ -0,0 +1,65 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+
+// Upper bound on the number of bands a single job is split into, so callers
+// can keep per-band partial results in a fixed-size array
+#define THREAD_POOL_MAX_BANDS 64
+
+// Bands smaller than this are not worth the hand-off to another thread
+#define THREAD_POOL_MIN_BAND_ROWS 16
+
+typedef struct ThreadPool ThreadPool;
+
+/**
+ * Work callback for one band of rows
+ * @param context User pointer passed to thread_pool_run_bands
+ * @param band Index of the band (0 to band_count-1)
+ * @param row_begin First row of the band
+ * @param row_end One past the last row of the band
+ */
+typedef void (*ThreadPoolBandFunc)(void* context, int band, int row_begin, int row_end);
+
+/**
+ * Create a pool of worker threads
+ * The calling thread also executes bands, so thread_count-1 workers are spawned
+ * @param thread_count Total number of threads, or 0 to use the CPU count
+ * @return New pool, or NULL on failure
+ */
+ThreadPool* thread_pool_create(int thread_count);
+
+/**
+ * Stop all workers and free the pool
+ * @param pool Pool to destroy (may be NULL)
+ */
+void thread_pool_destroy(ThreadPool* pool);
+
+/**
+ * Get the number of threads executing bands, including the caller
+ * @param pool Thread pool (NULL means single-threaded)
+ * @return Thread count
+ */
+int thread_pool_get_thread_count(const ThreadPool* pool);
+
+/**
+ * Get the number of bands thread_pool_run_bands will use for an image height
+ * @param pool Thread pool (NULL means single-threaded)
+ * @param rows Number of rows to split
+ * @return Band count (1 to THREAD_POOL_MAX_BANDS)
+ */
+int thread_pool_get_band_count(const ThreadPool* pool, int rows);
+
+/**
+ * Split rows into bands and run func on each of them, blocking until all finish
+ * If the pool is NULL or already running a job, bands run on the calling thread
+ * @param pool Thread pool
+ * @param rows Number of rows to split
+ * @param func Band callback
+ * @param context User pointer passed to func
+ * @return Number of bands executed
+ */
+int thread_pool_run_bands(ThreadPool* pool, int rows, ThreadPoolBandFunc func, void* context);
+
+#endif // THREAD_POOL_H